@@ -20,6 +20,12 @@ int main(int argc, char **argv)
     int print_stats = 0, parser_dump = 0;
     int parser_hash = 0, parser_types = 0;
     int help_exit = 0;
+    int num_threads = 1;
+    int precision = -1;
+    int subtree_index = 0, subtree = -1;
+    int style_classes = 0;
+    int write_buffers = -1;
+    int stream = 0;
 
     int i = 1;
     while (i < argc) {
@@ -31,6 +37,20 @@ int main(int argc, char **argv)
             input_format = musvg_parse_format(argv[++i]);
         } else if (check_opt(argv[i],"-o","--output-format") && i + 1 < argc) {
             output_format = musvg_parse_format(argv[++i]);
+        } else if (check_opt(argv[i],"-j","--threads") && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (check_opt(argv[i],"-p","--precision") && i + 1 < argc) {
+            precision = atoi(argv[++i]);
+        } else if (check_opt(argv[i],"-n","--index")) {
+            subtree_index = 1;
+        } else if (check_opt(argv[i],"-c","--classes")) {
+            style_classes = 1;
+        } else if (check_opt(argv[i],"-w","--write-buffers") && i + 1 < argc) {
+            write_buffers = atoi(argv[++i]);
+        } else if (check_opt(argv[i],"-t","--subtree") && i + 1 < argc) {
+            subtree = atoi(argv[++i]);
+        } else if (check_opt(argv[i],"-S","--stream")) {
+            stream = 1;
         } else if (check_opt(argv[i],"-s","--stats")) {
             print_stats = 1;
         } else if (check_opt(argv[i],"-x","--dump")) {
@@ -74,8 +94,15 @@ int main(int argc, char **argv)
             "\n"
             "-if,--input-file (<filename>|-)\n"
             "-of,--output-file (<filename>|-)\n"
-            "-i,--input-format (xml|svgv|svgb)\n"
-            "-o,--output-format (xml|svgv|svgb|text)\n"
+            "-i,--input-format (xml|svgv|svgb|svgd|svgc|svgi|svgr)\n"
+            "-o,--output-format (xml|svgv|svgb|svgd|svgc|svgi|svgr|text)\n"
+            "-j,--threads <count>\n"
+            "-p,--precision <digits> (svgd coordinate grid)\n"
+            "-n,--index (svgv|svgb|svgd subtree index)\n"
+            "-c,--classes (svgv|svgb|svgd style class table)\n"
+            "-t,--subtree <index> (decode one subtree of an indexed file)\n"
+            "-w,--write-buffers <count> (background write buffers, 0 to write inline)\n"
+            "-S,--stream (transcode xml|svgv|svgb|svgd without building the document)\n"
             "-s,--stats\n"
             "-x,--dump\n"
             "-y,--types\n"
@@ -85,9 +112,57 @@ int main(int argc, char **argv)
         exit(1);
     }
 
-    p = musvg_parser_create();
-    musvg_parse_file(p, input_format, input_filename);
-    musvg_emit_file(p, output_format, output_filename);
+    /* images are mapped in place unless they are read from a pipe */
+    int mapped = input_format == musvg_format_image && strcmp(input_filename, "-") != 0;
+    if (mapped) {
+        if (!(p = musvg_parser_open_image(input_filename))) {
+            fprintf(stderr, "*** error: cannot open image: %s\n", input_filename);
+            exit(1);
+        }
+    } else {
+        p = musvg_parser_create();
+    }
+    musvg_parser_set_threads(p, num_threads);
+    musvg_parser_set_precision(p, precision);
+    musvg_parser_set_index(p, subtree_index);
+    musvg_parser_set_classes(p, style_classes);
+    if (write_buffers >= 0) {
+        musvg_parser_set_write_buffers(p, 0, write_buffers);
+    }
+    if (stream) {
+        int ret = musvg_transcode_file(p, input_format, input_filename,
+                                       output_format, output_filename);
+        if (ret < 0) {
+            fprintf(stderr, "*** error: cannot transcode %s: %s\n",
+                input_filename, musvg_error_name(ret));
+            exit(1);
+        }
+    } else if (subtree >= 0) {
+        musvg_span span = musvg_read_file(input_filename);
+        mu_buf *buf = mu_buf_memory_new(span.data, span.size);
+        int ret = musvg_parse_subtree(p, input_format, buf, subtree);
+        mu_buf_destroy(buf);
+        free(span.data);
+        if (ret < 0) {
+            fprintf(stderr, "*** error: cannot decode subtree %d: %s\n", subtree, input_filename);
+            exit(1);
+        }
+    } else if (!mapped) {
+        int ret = musvg_parse_file(p, input_format, input_filename);
+        if (ret < 0) {
+            fprintf(stderr, "*** error: cannot parse %s: %s\n",
+                input_filename, musvg_error_name(ret));
+            exit(1);
+        }
+    }
+    if (!stream) {
+        int ret = musvg_emit_file(p, output_format, output_filename);
+        if (ret < 0) {
+            fprintf(stderr, "*** error: cannot emit %s: %s\n",
+                output_filename, musvg_error_name(ret));
+            exit(1);
+        }
+    }
     if (parser_dump) {
         printf("\n");
         musvg_parser_dump(p);
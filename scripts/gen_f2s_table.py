@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+# generate the 64-bit power of five tables used by the shortest binary32
+# to decimal conversion in src/musvg.c.
+#
+# the algorithm is Ryu by Ulf Adams. entry i of the split table holds
+# 5^i truncated to its top 61 bits and entry q of the inverse table holds
+# 2^(ceil(log2(5^q)) - 1 + 59) / 5^q rounded up. the sizes cover every
+# finite binary32 exponent.
+#
+# usage: python3 scripts/gen_f2s_table.py
+
+pow5_inv_bitcount, pow5_bitcount = 59, 61
+inv_count, split_count = 31, 48
+
+def pow5bits(e):
+    return ((e * 1217359) >> 19) + 1
+
+def pow5_split(i):
+    p = 5 ** i
+    shift = pow5bits(i) - pow5_bitcount
+    return p >> shift if shift >= 0 else p << -shift
+
+def pow5_inv_split(q):
+    return (1 << (pow5bits(q) - 1 + pow5_inv_bitcount)) // (5 ** q) + 1
+
+def main():
+    print("static const ullong musvg_f2s_pow5_inv_split[%d] = {" % inv_count)
+    for q in range(inv_count):
+        print("    0x%016xull, /* 5^-%d */" % (pow5_inv_split(q), q))
+    print("};")
+    print("static const ullong musvg_f2s_pow5_split[%d] = {" % split_count)
+    for i in range(split_count):
+        print("    0x%016xull, /* 5^%d */" % (pow5_split(i), i))
+    print("};")
+
+if __name__ == "__main__":
+    main()
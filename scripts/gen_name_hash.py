@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+
+# generate perfect hash slot tables for the name tables in src/musvg.c.
+#
+# names are hashed on their first, second, middle and last characters
+# and their length. for each table we search for the smallest power of two table
+# size and a multiplier seed such that no two names share a slot. the
+# output is pasted into src/musvg.c between the "perfect hash tables"
+# markers and must be regenerated whenever a name table changes.
+#
+# color keywords such as darkgray and darkgrey differ only in the second
+# to last character, so the color key adds it to the other characters.
+#
+# usage: python3 scripts/gen_name_hash.py [src/musvg.c]
+
+import re
+import sys
+
+tables = [
+    "element", "attribute", "linecap", "linejoin", "fillrule",
+    "display", "spread_method", "gradient_unit",
+]
+
+def parse_colors(src):
+    m = re.search(r"musvg_named_color musvg_colors\[\] =\s*\{(.*?)\};", src, re.S)
+    return list(enumerate(re.findall(r"MSVG_RGB\([^)]*\),\s*\"(\w+)\"", m.group(1))))
+
+def parse_names(src, table):
+    m = re.search(r"static const char \* musvg_%s_names\[\] = \{(.*?)\};"
+                  % table, src, re.S)
+    return re.findall(r"\[(\w+)\]\s*=\s*\"([^\"]*)\"", m.group(1))
+
+def name_key(s):
+    b = s.encode()
+    n = len(b)
+    return b[0] | b[n > 1] << 8 | b[n >> 1] << 16 | b[n - 1] << 24 | n << 32
+
+def color_key(s):
+    b = s.encode()
+    n = len(b)
+    return (b[0] | b[1] << 8 | b[n >> 1] << 16 | b[n - 2] << 24 |
+            b[n - 1] << 32 | n << 40)
+
+def name_hash(s, seed, bits, key=name_key):
+    return ((key(s) * seed) & 0xffffffffffffffff) >> (64 - bits)
+
+def search(names, key=name_key):
+    bits = max(1, (len(names) - 1).bit_length())
+    while bits <= 12:
+        for i in range(1, 1 << 16):
+            seed = (i * 0x9e3779b97f4a7c15) & 0xffffffffffffffff | 1
+            slots = set(name_hash(s, seed, bits, key) for _, s in names)
+            if len(slots) == len(names):
+                return seed, bits
+        bits += 1
+    raise Exception("no perfect hash found")
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "src/musvg.c"
+    src = open(path).read()
+    for table in tables:
+        names = parse_names(src, table)
+        seed, bits = search(names)
+        slots = {}
+        for enum, s in names:
+            slots[name_hash(s, seed, bits)] = enum
+        print("static const musvg_small musvg_%s_slots[%d] = {" % (table, 1 << bits))
+        for h in sorted(slots):
+            print("    [%d] = %s," % (h, slots[h]))
+        print("};")
+        print("static const musvg_name_table musvg_%s_table = {" % table)
+        print("    musvg_%s_names, musvg_%s_slots, 0x%016xull, %d" % (table, table, seed, bits))
+        print("};")
+        print()
+    colors = parse_colors(src)
+    seed, bits = search(colors, color_key)
+    slots = {}
+    for idx, s in colors:
+        slots[name_hash(s, seed, bits, color_key)] = (idx, s)
+    print("static const unsigned char musvg_color_slots[%d] = {" % (1 << bits))
+    for h in sorted(slots):
+        print("    [%d] = %d, /* %s */" % (h, slots[h][0], slots[h][1]))
+    print("};")
+    print("static const ullong musvg_color_seed = 0x%016xull;" % seed)
+    print("static const uint musvg_color_bits = %d;" % bits)
+    print()
+
+if __name__ == "__main__":
+    main()
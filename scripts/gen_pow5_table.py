@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+
+# generate the 128-bit power of five table used by the Eisel-Lemire
+# binary32 decimal to float conversion in src/musvg.c.
+#
+# entry q holds 5^q normalized so that the most significant bit of the
+# 128-bit value is set. positive powers are truncated and negative powers
+# are reciprocals rounded up, matching the table used by fast_float.
+#
+# usage: python3 scripts/gen_pow5_table.py
+
+min_q, max_q = -64, 38
+
+def pow5_128(q):
+    if q >= 0:
+        p = 5 ** q
+        while p < (1 << 127):
+            p *= 2
+        while p >= (1 << 128):
+            p //= 2
+        return p
+    p = 5 ** -q
+    z = p.bit_length()
+    if q >= -27:
+        return (1 << (z + 127)) // p + 1
+    c = (1 << (2 * z + 128)) // p + 1
+    while c >= (1 << 128):
+        c //= 2
+    return c
+
+def main():
+    print("static const ullong musvg_pow5_128[][2] = {")
+    for q in range(min_q, max_q + 1):
+        c = pow5_128(q)
+        print("    { 0x%016xull, 0x%016xull }, /* 5^%d */"
+              % (c >> 64, c & ((1 << 64) - 1), q))
+    print("};")
+
+if __name__ == "__main__":
+    main()
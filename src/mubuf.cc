@@ -8,10 +8,21 @@
 #include <string>
 #include <limits>
 
+#include <threads.h>
+#include <limits.h>
+#include <sys/uio.h>
+
 #include "mubuf.h"
 #include "ztdbits.h"
 #include "ztdendian.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #define DEBUG_ENCODING 0
 
 int debug = 0;
@@ -1244,7 +1255,7 @@ int mu_vf128_f64_read(mu_buf *buf, double *value)
                  * of the point hence 59 = (63 - 4) then left-justify
                  * the mantissa and truncate the leading 1. */
                 vp_exp = f64_exp_bias + 59 - lz;
-                vp_man = ((u64)vf_man << (lz + 1)) >> (f64_exp_size + 1);
+                vp_man = ((u64)vf_man << lz << 1) >> (f64_exp_size + 1);
             } else {
                 /* Zero */
                 vp_exp = 0;
@@ -1264,6 +1275,12 @@ int mu_vf128_f64_read(mu_buf *buf, double *value)
             vp_man = (u64)vf_man << (f64_mant_size - 4);
         }
     }
+    /* out-of-line exponent without mantissa bits - a power of two, or
+     * zero below the normal range, with nothing to left-justify. */
+    else if (vr_man == 0) {
+        vp_exp = vr_exp <= -(s64)f64_exp_bias ? 0 : f64_exp_bias + vr_exp;
+        vp_man = 0;
+    }
     /* out-of-line little-endian exponent and mantissa */
     else {
         size_t lz = clz(vr_man), tz = ctz(vr_man);
@@ -1346,7 +1363,7 @@ f64_result mu_vf128_f64_read_byval(mu_buf *buf)
                  * of the point hence 59 = (63 - 4) then left-justify
                  * the mantissa and truncate the leading 1. */
                 vp_exp = f64_exp_bias + 59 - lz;
-                vp_man = ((u64)vf_man << (lz + 1)) >> (f64_exp_size + 1);
+                vp_man = ((u64)vf_man << lz << 1) >> (f64_exp_size + 1);
             } else {
                 /* Zero */
                 vp_exp = 0;
@@ -1366,6 +1383,12 @@ f64_result mu_vf128_f64_read_byval(mu_buf *buf)
             vp_man = (u64)vf_man << (f64_mant_size - 4);
         }
     }
+    /* out-of-line exponent without mantissa bits - a power of two, or
+     * zero below the normal range, with nothing to left-justify. */
+    else if (vr_man == 0) {
+        vp_exp = vr_exp <= -(s64)f64_exp_bias ? 0 : f64_exp_bias + vr_exp;
+        vp_man = 0;
+    }
     /* out-of-line little-endian exponent and mantissa */
     else {
         size_t lz = clz(vr_man), tz = ctz(vr_man);
@@ -1716,7 +1739,7 @@ int mu_vf128_f32_read(mu_buf *buf, float *value)
                  * of the point hence 27 = (31 - 4) then left-justify
                  * the mantissa and truncate the leading 1. */
                 vp_exp = f32_exp_bias + 27 - (u32)lz;
-                vp_man = ((u32)vf_man << (lz + 1)) >> (f32_exp_size + 1);
+                vp_man = ((u32)vf_man << lz << 1) >> (f32_exp_size + 1);
             } else {
                 /* Zero */
                 vp_exp = 0;
@@ -1736,6 +1759,12 @@ int mu_vf128_f32_read(mu_buf *buf, float *value)
             vp_man = (u32)vf_man << (f32_mant_size - 4);
         }
     }
+    /* out-of-line exponent without mantissa bits - a power of two, or
+     * zero below the normal range, with nothing to left-justify. */
+    else if (vr_man == 0) {
+        vp_exp = vr_exp <= -(s32)f32_exp_bias ? 0 : f32_exp_bias + vr_exp;
+        vp_man = 0;
+    }
     /* out-of-line little-endian exponent and mantissa */
     else {
         size_t lz = clz(vr_man), tz = ctz(vr_man);
@@ -1823,7 +1852,7 @@ f32_result mu_vf128_f32_read_byval(mu_buf *buf)
                  * of the point hence 27 = (31 - 4) then left-justify
                  * the mantissa and truncate the leading 1. */
                 vp_exp = f32_exp_bias + 27 - (u32)lz;
-                vp_man = ((u32)vf_man << (lz + 1)) >> (f32_exp_size + 1);
+                vp_man = ((u32)vf_man << lz << 1) >> (f32_exp_size + 1);
             } else {
                 /* Zero */
                 vp_exp = 0;
@@ -1843,6 +1872,12 @@ f32_result mu_vf128_f32_read_byval(mu_buf *buf)
             vp_man = (u32)vf_man << (f32_mant_size - 4);
         }
     }
+    /* out-of-line exponent without mantissa bits - a power of two, or
+     * zero below the normal range, with nothing to left-justify. */
+    else if (vr_man == 0) {
+        vp_exp = vr_exp <= -(s32)f32_exp_bias ? 0 : f32_exp_bias + vr_exp;
+        vp_man = 0;
+    }
     /* out-of-line little-endian exponent and mantissa */
     else {
         size_t lz = clz(vr_man), tz = ctz(vr_man);
@@ -2101,9 +2136,317 @@ int mu_vf128_f64_write_vec(mu_buf *buf, const double *value, size_t count)
     return 0;
 }
 
-int mu_vf128_f32_read_vec(mu_buf *buf, float *value, size_t count)
+/*
+ * vf8 compressed float - f32 batch codec
+ *
+ * runs of floats are encoded into and decoded from buffer memory in
+ * batches, so capacity is checked once per batch instead of once per
+ * field. the encoding is byte-identical to mu_vf128_f32_write. with SSE2
+ * the sign, exponent and fraction of four floats are split at once and
+ * runs of inline prefix bytes are found sixteen at a time. anything the
+ * batch codec does not handle falls back to the scalar functions.
+ */
+
+enum : size_t {
+    vf128_f32_max_length = 7, /* prefix, 2 exponent and 4 fraction bytes */
+    vf128_f32_batch_count = 64,
+    vf128_f32_batch_slack = 16,
+    vf128_f32_batch_length = vf128_f32_batch_count * vf128_f32_max_length
+                           + vf128_f32_batch_slack
+};
+
+/*
+ * inline floats are fully described by their prefix byte. subnormal
+ * inline values are the 4-bit mantissa in sixteenths, the others are
+ * packed with the exponent bias adjusted as in mu_vf128_f32_read.
+ */
+static const struct mu_vf128_f32_inline_table
+{
+    float value[128];
+
+    mu_vf128_f32_inline_table()
+    {
+        for (u32 pre = 0; pre < 128; pre++) {
+            u32 vf_sgn = (pre >> 6) & 1, vf_exp = (pre >> 4) & 3, vf_man = pre & 15;
+            if (vf_exp == 0) {
+                value[pre] = (vf_sgn ? -1.0f : 1.0f) * (float)vf_man / 16.0f;
+            } else {
+                u32 vp_exp = vf_exp == 3 ? (u32)f32_exp_mask : f32_exp_bias + vf_exp - 1;
+                value[pre] = f32_pack_float(f32_struct{
+                    vf_man << (f32_mant_size - 4), vp_exp, vf_sgn });
+            }
+        }
+    }
+} mu_vf128_f32_inline;
+
+/* store len little-endian bytes, writing a whole word into the slack */
+static inline u8* mu_vf128_store_le(u8 *out, size_t len, u64 value)
+{
+    u64 o = le64(value);
+    memcpy(out, &o, sizeof(o));
+    return out + len;
+}
+
+/* load len little-endian bytes, reading a whole word from the slack */
+static inline u64 mu_vf128_load_le(const u8 *in, size_t len)
+{
+    u64 o;
+    memcpy(&o, in, sizeof(o));
+    return le64(o) & (~0ull >> (64 - len * 8));
+}
+
+static inline u8* mu_vf128_f32_encode(u8 *out, bool sign, s32 sexp, u32 frac)
+{
+    u8 pre;
+    int vf_exp = 0;
+    int vf_man = 0;
+    u32 vw_man = 0;
+    s32 vw_exp = 0;
+
+    // Inf/NaN
+    if (sexp == f32_exp_bias + 1) {
+        *out++ = (sign << 6) | (3 << 4) | ((frac != 0) << 3);
+        return out;
+    }
+    // Zero
+    else if (sexp == -(s32)f32_exp_bias && frac == 0) {
+        *out++ = (sign << 6);
+        return out;
+    }
+    // Inline (normal)
+    else if (sexp <= 1 && sexp >= 0 && (frac & u32_msn) == frac) {
+        *out++ = (sign << 6) | (u8)((sexp+1) << 4) | (u8)(frac >> 28);
+        return out;
+    }
+    // Inline (subnormal)
+    else if (sexp <= -1 && sexp >= -4 &&
+             ((frac >> -sexp) & u32_msn) == (frac >> -sexp)) {
+        *out++ = (sign << 6) | (u8)((0x10 | (frac >> 28)) >> -sexp);
+        return out;
+    }
+
+    // Out-of-line, see mu_vf128_f32_write
+    size_t tz = ctz(frac), lz = clz(frac);
+    if (sexp == -(s32)f32_exp_bias) {
+        vw_man = frac >> tz;
+        vw_exp = sexp - (u32)lz - 1;
+        vf_exp = (u8)mu_le_ber_integer_s64_length_byval(vw_exp);
+        vf_man = (u8)mu_le_ber_integer_u64_length_byval(vw_man);
+    }
+    else if (frac == 0) {
+        vw_exp = sexp;
+        vf_exp = (u8)mu_le_ber_integer_s64_length_byval(vw_exp);
+    }
+    else if (sexp < 0 && sexp >= -8) {
+        size_t sh = -sexp - 1;
+        u32 vw_man_a = (frac >> tz) | (u32_msb >> (tz - 1));
+        u32 vw_man_b = ((frac >> tz) << sh) | ((u32_msb >> (tz - 1)) << sh);
+        int vf_exp_a = (u8)mu_le_ber_integer_s64_length_byval(sexp);
+        int vf_man_a = (u8)mu_le_ber_integer_u64_length_byval(vw_man_a);
+        int vf_man_b = (u8)mu_le_ber_integer_u64_length_byval(vw_man_b);
+        if (vf_man_a + vf_exp_a < vf_man_b) {
+            vw_man = vw_man_a;
+            vw_exp = sexp;
+            vf_exp = vf_exp_a;
+            vf_man = vf_man_a;
+        } else {
+            vw_man = vw_man_b;
+            vf_man = vf_man_b;
+        }
+    }
+    else {
+        vw_man = (frac >> tz) | (u32_msb >> (tz - 1));
+        vw_exp = sexp;
+        vf_exp = (u8)mu_le_ber_integer_s64_length_byval(vw_exp);
+        vf_man = (u8)mu_le_ber_integer_u64_length_byval(vw_man);
+    }
+
+    pre = 0x80 | (sign << 6) | (vf_exp << 4) | vf_man;
+    *out++ = pre;
+    if (vf_exp) out = mu_vf128_store_le(out, vf_exp, (u64)(s64)vw_exp);
+    if (vf_man) out = mu_vf128_store_le(out, vf_man, vw_man);
+
+    return out;
+}
+
+/*
+ * returns NULL for prefixes longer than vf128_f32_max_length which are
+ * left to mu_vf128_f32_read.
+ */
+static inline const u8* mu_vf128_f32_decode(const u8 *in, float *value)
 {
+    u8 pre = *in;
+    bool vf_sgn = (pre >> 6) & 1;
+    int vf_exp =  (pre >> 4) & 3;
+    int vf_man =   pre       & 15;
+    u32 vr_man = 0;
+    s32 vr_exp = 0;
+    u32 vp_man = 0;
+    s32 vp_exp = 0;
+
+    if (!(pre & 0x80)) {
+        *value = mu_vf128_f32_inline.value[pre];
+        return in + 1;
+    }
+    if (vf_exp > 2 || vf_man > 4) {
+        return NULL;
+    }
+
+    in++;
+    if (vf_exp) {
+        u64 e = mu_vf128_load_le(in, vf_exp);
+        vr_exp = (s32)_sign_extend_s64(e, 64 - (vf_exp << 3));
+        in += vf_exp;
+    }
+    if (vf_man) {
+        vr_man = (u32)mu_vf128_load_le(in, vf_man);
+        in += vf_man;
+    }
+
+    /* out-of-line little-endian exponent and mantissa, see mu_vf128_f32_read */
+    if (vr_man == 0) {
+        vp_exp = vr_exp <= -(s32)f32_exp_bias ? 0 : f32_exp_bias + vr_exp;
+    } else if (vr_exp <= -(s32)f32_exp_bias) {
+        size_t lz = clz(vr_man);
+        assert(vr_exp >= -(s32)f32_exp_bias - f32_mant_size);
+        size_t sh = f32_exp_bias + vr_exp + (u32)lz - f32_exp_size;
+        vp_exp = 0;
+        vp_man = (u32)vr_man << sh;
+    } else {
+        size_t lz = clz(vr_man), tz = ctz(vr_man);
+        if (vf_exp == 0) vr_exp = -(s32)tz - 1;
+        vp_exp = f32_exp_bias + vr_exp;
+        vp_man = (u32)vr_man << (lz + 1) >> (f32_exp_size + 1);
+    }
+
+    *value = f32_pack_float(f32_struct{vp_man, (u32)vp_exp, vf_sgn});
+
+    return in;
+}
+
+/*
+ * returns the length of the float at in, or zero if it is cut short by
+ * len or is not an encoding the f32 decoders accept. this lets untrusted
+ * input be checked before it is decoded.
+ */
+static inline size_t mu_vf128_f32_check_one(const u8 *in, size_t len)
+{
+    u8 pre = in[0];
+    int vf_exp = (pre >> 4) & 3;
+    int vf_man =  pre       & 15;
+    u64 e = 0, m = 0;
+
+    if (!(pre & 0x80)) return 1;
+    if (vf_exp > 2 || vf_man > 4 || (vf_exp | vf_man) == 0) return 0;
+    if (len < 1 + (size_t)vf_exp + vf_man) return 0;
+
+    /* whole words when the input is long enough, as in the decoder */
+    if (len > sizeof(u64) * 2) {
+        e = vf_exp ? mu_vf128_load_le(in + 1, vf_exp) : 0;
+        m = vf_man ? mu_vf128_load_le(in + 1 + vf_exp, vf_man) : 0;
+    } else {
+        memcpy(&e, in + 1, vf_exp);
+        memcpy(&m, in + 1 + vf_exp, vf_man);
+        e = le64(e);
+        m = le64(m);
+    }
+    s32 vr_exp = vf_exp ? (s32)_sign_extend_s64(e, 64 - (vf_exp << 3)) : 0;
+    u32 vr_man = (u32)m;
+
+    /* the writer stores the mantissa in as few bytes as it needs */
+    if (vf_man && (m >> ((vf_man - 1) << 3)) == 0) return 0;
+
+    /* the exponent ranges of mu_vf128_f32_decode */
+    if (vr_exp > (s32)f32_exp_bias) return 0;
+    if (vf_exp && vr_exp <= -(s32)f32_exp_bias) {
+        s32 sh = (s32)f32_exp_bias + vr_exp + (s32)clz(vr_man) - (s32)f32_exp_size;
+        if (vr_exp < -(s32)(f32_exp_bias + f32_mant_size) || sh < 0 || sh > 31) return 0;
+    }
+    return 1 + vf_exp + vf_man;
+}
+
+size_t mu_vf128_f32_check(const char *in, size_t len)
+{
+    return len < 1 ? 0 : mu_vf128_f32_check_one((const u8*)in, len);
+}
+
+/*
+ * float lengths by prefix byte, zero for prefixes the decoders reject.
+ * floats with an out-of-line exponent also need their range checked.
+ */
+static const struct mu_vf128_f32_length_table
+{
+    enum { exponent = 0x80 };
+
+    u8 length[256];
+
+    mu_vf128_f32_length_table()
+    {
+        for (u32 pre = 0; pre < 256; pre++) {
+            int vf_exp = (pre >> 4) & 3, vf_man = pre & 15;
+            if (!(pre & 0x80)) length[pre] = 1;
+            else if (vf_exp > 2 || vf_man > 4 || (vf_exp | vf_man) == 0) length[pre] = 0;
+            else length[pre] = (u8)(1 + vf_exp + vf_man) | (vf_exp ? exponent : 0);
+        }
+    }
+} mu_vf128_f32_length;
+
+/* returns the length of count floats, or zero if any fails the check */
+size_t mu_vf128_f32_check_vec(const char *in, size_t len, size_t count)
+{
+    const u8 *start = (const u8*)in, *p = start, *end = start + len;
+
     for (size_t i = 0; i < count; i++) {
+        if (p == end) return 0;
+        size_t n = mu_vf128_f32_length.length[*p];
+        if (n & mu_vf128_f32_length.exponent) {
+            n = mu_vf128_f32_check_one(p, end - p);
+            if (n == 0) return 0;
+        } else {
+            if (n == 0 || n > (size_t)(end - p)) return 0;
+            /* a mantissa alone ends with its most significant byte */
+            if (n > 1 && p[n - 1] == 0) return 0;
+        }
+        p += n;
+    }
+    return p - start;
+}
+
+int mu_vf128_f32_read_vec(mu_buf *buf, float *value, size_t count)
+{
+    size_t i = 0;
+
+    while (i < count) {
+        size_t n = count - i < vf128_f32_batch_count ? count - i : vf128_f32_batch_count;
+        if (buf->read_check(buf, n * vf128_f32_max_length + vf128_f32_batch_slack)) {
+            break;
+        }
+        const u8 *start = (const u8*)buf->data + buf->read_marker, *in = start;
+        size_t j = 0;
+        while (j < n) {
+#if defined(__SSE2__)
+            if (!(*in & 0x80)) {
+                __m128i pre = _mm_loadu_si128((const __m128i*)in);
+                size_t run = ctz((u32)_mm_movemask_epi8(pre) | 0x10000u);
+                if (run > n - j) run = n - j;
+                for (size_t k = 0; k < run; k++) {
+                    value[i + j + k] = mu_vf128_f32_inline.value[in[k]];
+                }
+                in += run;
+                j += run;
+                continue;
+            }
+#endif
+            const u8 *next = mu_vf128_f32_decode(in, value + i + j);
+            if (!next) break;
+            in = next;
+            j++;
+        }
+        buf->read_marker += in - start;
+        i += j;
+        if (j < n) break;
+    }
+    for (; i < count; i++) {
         if (mu_vf128_f32_read(buf, value + i) < 0) return -1;
     }
     return 0;
@@ -2111,7 +2454,39 @@ int mu_vf128_f32_read_vec(mu_buf *buf, float *value, size_t count)
 
 int mu_vf128_f32_write_vec(mu_buf *buf, const float *value, size_t count)
 {
-    for (size_t i = 0; i < count; i++) {
+    size_t i = 0;
+
+    while (i < count) {
+        size_t n = count - i < vf128_f32_batch_count ? count - i : vf128_f32_batch_count;
+        if (buf->write_check(buf, n * vf128_f32_max_length + vf128_f32_batch_slack)) {
+            break;
+        }
+        u8 *start = (u8*)buf->data + buf->write_marker, *out = start;
+        const float *v = value + i;
+        size_t j = 0;
+#if defined(__SSE2__)
+        const __m128i exp_mask = _mm_set1_epi32(f32_exp_mask);
+        const __m128i exp_bias = _mm_set1_epi32(f32_exp_bias);
+        for (; j + 4 <= n; j += 4) {
+            alignas(16) u32 sign[4], sexp[4], frac[4];
+            __m128i x = _mm_loadu_si128((const __m128i*)(v + j));
+            _mm_store_si128((__m128i*)sign, _mm_srli_epi32(x, 31));
+            _mm_store_si128((__m128i*)sexp, _mm_sub_epi32(_mm_and_si128(
+                _mm_srli_epi32(x, f32_mant_size), exp_mask), exp_bias));
+            _mm_store_si128((__m128i*)frac, _mm_slli_epi32(x, f32_exp_size + 1));
+            for (size_t k = 0; k < 4; k++) {
+                out = mu_vf128_f32_encode(out, sign[k], (s32)sexp[k], frac[k]);
+            }
+        }
+#endif
+        for (; j < n; j++) {
+            mu_vf128_f32_resultdata d = mu_vf128_f32_resultdata_get(v[j]);
+            out = mu_vf128_f32_encode(out, d.sign, d.sexp, d.frac);
+        }
+        buf->write_marker += out - start;
+        i += n;
+    }
+    for (; i < count; i++) {
         if (mu_vf128_f32_write(buf, value + i) < 0) return -1;
     }
     return 0;
@@ -2221,14 +2596,55 @@ int mu_ieee754_f32_write_vec(mu_buf *buf, const float *value, size_t count)
 
 /*
  * LEB128
+ *
+ * values are limited to 56 bits so an encoding is at most eight bytes.
+ * when eight bytes are buffered, the decoders load them as one word and
+ * find the end from the continuation bits instead of checking capacity
+ * for each byte.
  */
 
+static inline u64 mu_load_le64(const char *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return le64(v);
+}
+
+/* gather the low seven bits of each byte */
+static inline u64 mu_leb_compact(u64 x)
+{
+#if defined(__BMI2__)
+    return _pext_u64(x, 0x7f7f7f7f7f7f7f7full);
+#else
+    x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+    x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+    x = (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
+    return x;
+#endif
+}
+
+/* decode from eight readable bytes, returning the encoded length */
+static inline size_t mu_leb_u64_decode(const char *p, u64 *value)
+{
+    u64 x = mu_load_le64(p);
+    u64 stop = ~x & 0x8080808080808080ull;
+    size_t len = stop ? ctz(stop) / 8 + 1 : 8;
+    if (len < 8) x &= (1ull << (len * 8)) - 1;
+    *value = mu_leb_compact(x);
+    return len;
+}
+
 int mu_leb_u64_read(mu_buf *buf, u64 *value)
 {
     int8_t b;
     size_t w = 0;
     u64 v = 0;
 
+    if (mu_buf_avaiable_read(buf) >= 8) {
+        buf->read_marker += mu_leb_u64_decode(buf->data + buf->read_marker, value);
+        return 0;
+    }
+
     do {
         if (mu_buf_read_i8(buf, &b) != 1) {
             goto err;
@@ -2254,6 +2670,11 @@ u64_result mu_leb_u64_read_byval(mu_buf *buf)
     size_t w = 0;
     u64 v = 0;
 
+    if (mu_buf_avaiable_read(buf) >= 8) {
+        buf->read_marker += mu_leb_u64_decode(buf->data + buf->read_marker, &v);
+        return u64_result { v, 0 };
+    }
+
     do {
         if (mu_buf_read_i8(buf, &b) != 1) {
             return u64_result { 0, -1 };
@@ -2323,16 +2744,54 @@ int mu_leb_u64_write_byval(mu_buf *buf, const u64 value)
     return 0;
 }
 
+int mu_leb_u64_read_vec(mu_buf *buf, u64 *value, size_t count)
+{
+    const char *p = buf->data + buf->read_marker;
+    const char *end = buf->data + buf->write_marker;
+    size_t i = 0;
+
+    for (; i < count && end - p >= 8; i++) {
+        p += mu_leb_u64_decode(p, value + i);
+    }
+    buf->read_marker = p - buf->data;
+    for (; i < count; i++) {
+        if (mu_leb_u64_read(buf, value + i) < 0) return -1;
+    }
+    return 0;
+}
+
 /*
  * VLU
+ *
+ * the count of trailing one bits in the first byte gives the length, so
+ * with eight bytes buffered a value is one load, shift and mask.
  */
 
+/* decode from eight readable bytes, returning the length or zero */
+static inline size_t mu_vlu_u64_decode(const char *p, u64 *value)
+{
+    u64 x = mu_load_le64(p);
+    size_t len = ctz(~x) + 1;
+    if (len > 8) return 0;
+    if (len < 8) x &= (1ull << (len * 8)) - 1;
+    *value = x >> len;
+    return len;
+}
+
 int mu_vlu_u64_read(mu_buf *buf, u64 *value)
 {
     size_t len;
     int8_t b;
     u64 v = 0;
 
+    if (mu_buf_avaiable_read(buf) >= 8) {
+        if (!(len = mu_vlu_u64_decode(buf->data + buf->read_marker, value))) {
+            goto err;
+        }
+        buf->read_marker += len;
+        return 0;
+    }
+
     if (mu_buf_read_i8(buf, &b) != 1) {
         goto err;
     }
@@ -2360,6 +2819,14 @@ u64_result mu_vlu_u64_read_byval(mu_buf *buf)
     u64_result r;
     u64 v = 0;
 
+    if (mu_buf_avaiable_read(buf) >= 8) {
+        if (!(len = mu_vlu_u64_decode(buf->data + buf->read_marker, &v))) {
+            return u64_result { 0, -1 };
+        }
+        buf->read_marker += len;
+        return u64_result { v, 0 };
+    }
+
     if (mu_buf_read_i8(buf, &b) != 1) {
         return u64_result { 0, -1 };
     }
@@ -2417,3 +2884,367 @@ int mu_vlu_u64_write_byval(mu_buf *buf, const u64 value)
 
     return 0;
 }
+
+int mu_vlu_u64_read_vec(mu_buf *buf, u64 *value, size_t count)
+{
+    const char *p = buf->data + buf->read_marker;
+    const char *end = buf->data + buf->write_marker;
+    size_t i = 0, len;
+
+    for (; i < count && end - p >= 8; i++) {
+        if (!(len = mu_vlu_u64_decode(p, value + i))) break;
+        p += len;
+    }
+    buf->read_marker = p - buf->data;
+    for (; i < count; i++) {
+        if (mu_vlu_u64_read(buf, value + i) < 0) return -1;
+    }
+    return 0;
+}
+
+/*
+ * adaptive binary range coder
+ *
+ * bytes are coded most significant bit first as eight binary decisions
+ * down a 256 entry bit tree. the tree is selected by the preceding byte
+ * and by the byte lane within fixed size records, so with one lane it is
+ * an order-1 byte model. the probabilities are 11-bit and the carry and
+ * flush logic is the same as the LZMA range coder.
+ */
+
+enum {
+    rc_prob_bits = 11,
+    rc_prob_init = 1 << (rc_prob_bits - 1),
+    rc_move_bits = 5,
+    rc_top = 1 << 24,
+    rc_max_lanes = 8,
+};
+
+struct mu_rc_encoder
+{
+    mu_buf *buf;
+    u64 low;
+    u32 range;
+    u8 cache;
+    u64 cache_size;
+    int error;
+};
+
+struct mu_rc_decoder
+{
+    mu_buf *buf;
+    u32 range;
+    u32 code;
+    int error;
+};
+
+static u16* mu_rc_probs_new(size_t lanes)
+{
+    size_t count = lanes << 16;
+    u16 *probs = (u16*)malloc(count * sizeof(u16));
+    for (size_t i = 0; i < count; i++) {
+        probs[i] = rc_prob_init;
+    }
+    return probs;
+}
+
+static inline void mu_rc_shift_low(mu_rc_encoder *e)
+{
+    if ((u32)e->low < 0xff000000u || (e->low >> 32) != 0) {
+        u8 carry = (u8)(e->low >> 32), temp = e->cache;
+        do {
+            if (mu_buf_write_i8(e->buf, (int8_t)(u8)(temp + carry)) != 1) {
+                e->error = -1;
+            }
+            temp = 0xff;
+        } while (--e->cache_size != 0);
+        e->cache = (u8)(e->low >> 24);
+    }
+    e->cache_size++;
+    e->low = (e->low & 0x00ffffffu) << 8;
+}
+
+static inline void mu_rc_encode_bit(mu_rc_encoder *e, u16 *prob, u32 bit)
+{
+    u32 bound = (e->range >> rc_prob_bits) * *prob;
+    if (bit) {
+        e->low += bound;
+        e->range -= bound;
+        *prob -= *prob >> rc_move_bits;
+    } else {
+        e->range = bound;
+        *prob += ((1 << rc_prob_bits) - *prob) >> rc_move_bits;
+    }
+    while (e->range < rc_top) {
+        e->range <<= 8;
+        mu_rc_shift_low(e);
+    }
+}
+
+static inline u32 mu_rc_next(mu_rc_decoder *d)
+{
+    int8_t b;
+    if (mu_buf_read_i8(d->buf, &b) != 1) {
+        d->error = -1;
+        return 0;
+    }
+    return (u8)b;
+}
+
+static inline u32 mu_rc_decode_bit(mu_rc_decoder *d, u16 *prob)
+{
+    u32 bound = (d->range >> rc_prob_bits) * *prob;
+    u32 bit;
+    if (d->code < bound) {
+        d->range = bound;
+        *prob += ((1 << rc_prob_bits) - *prob) >> rc_move_bits;
+        bit = 0;
+    } else {
+        d->code -= bound;
+        d->range -= bound;
+        *prob -= *prob >> rc_move_bits;
+        bit = 1;
+    }
+    if (d->range < rc_top) {
+        d->range <<= 8;
+        d->code = (d->code << 8) | mu_rc_next(d);
+    }
+    return bit;
+}
+
+int mu_rc_encode_bytes(mu_buf *buf, const char *data, size_t len, size_t lanes)
+{
+    if (lanes < 1 || lanes > rc_max_lanes) return -1;
+    if (len == 0) return 0;
+
+    u16 *probs = mu_rc_probs_new(lanes);
+    mu_rc_encoder e = { buf, 0, 0xffffffffu, 0, 1, 0 };
+    for (size_t i = 0, lane = 0; i < len; i++) {
+        u8 prev = i > 0 ? (u8)data[i - 1] : 0;
+        u16 *tree = probs + (((lane << 8) | prev) << 8);
+        u32 sym = (u8)data[i], node = 1;
+        for (int b = 7; b >= 0; b--) {
+            u32 bit = (sym >> b) & 1;
+            mu_rc_encode_bit(&e, tree + node, bit);
+            node = (node << 1) | bit;
+        }
+        if (++lane == lanes) lane = 0;
+    }
+    for (int i = 0; i < 5; i++) {
+        mu_rc_shift_low(&e);
+    }
+    free(probs);
+    return e.error;
+}
+
+int mu_rc_decode_bytes(mu_buf *buf, char *data, size_t len, size_t lanes)
+{
+    if (lanes < 1 || lanes > rc_max_lanes) return -1;
+    if (len == 0) return 0;
+
+    u16 *probs = mu_rc_probs_new(lanes);
+    mu_rc_decoder d = { buf, 0xffffffffu, 0, 0 };
+    for (int i = 0; i < 5; i++) {
+        d.code = (d.code << 8) | mu_rc_next(&d);
+    }
+    for (size_t i = 0, lane = 0; i < len && !d.error; i++) {
+        u8 prev = i > 0 ? (u8)data[i - 1] : 0;
+        u16 *tree = probs + (((lane << 8) | prev) << 8);
+        u32 node = 1;
+        for (int b = 0; b < 8; b++) {
+            node = (node << 1) | mu_rc_decode_bit(&d, tree + node);
+        }
+        data[i] = (char)(u8)node;
+        if (++lane == lanes) lane = 0;
+    }
+    free(probs);
+    return d.error;
+}
+
+/*
+ * asynchronous writer
+ *
+ * the emitter fills one buffer while a background thread writes the
+ * others. sync queues the full buffer and swaps in a free one, waiting
+ * only when all of them are queued. the thread gathers every queued
+ * buffer into one writev call. close queues the last buffer, waits for
+ * the thread to drain the queue and closes the file.
+ */
+
+enum { async_writer_min_size = 4096, async_writer_max_iov = 64 };
+
+struct mu_async_chunk { char *data; size_t offset; size_t length; };
+
+struct mu_async_writer
+{
+    mtx_t lock;
+    cnd_t cond;
+    thrd_t thread;
+    mu_async_chunk *queue;     /* ring of full buffers */
+    char **pool;               /* free buffers */
+    size_t count;              /* buffers in total */
+    size_t head;               /* first queued buffer */
+    size_t queued;             /* queued buffers */
+    size_t free;               /* free buffers */
+    int fd;
+    int error;
+    int done;
+};
+
+/* writes the chunks, resuming after short writes */
+static int mu_async_writev(int fd, mu_async_chunk *chunk, size_t n)
+{
+    struct iovec iov[async_writer_max_iov];
+    size_t i = 0;
+
+    while (i < n) {
+        size_t m = 0;
+        for (size_t j = i; j < n && m < async_writer_max_iov && m < IOV_MAX; j++, m++) {
+            iov[m].iov_base = chunk[j].data + chunk[j].offset;
+            iov[m].iov_len = chunk[j].length;
+        }
+        ssize_t nwritten = writev(fd, iov, (int)m);
+        if (nwritten < 0) return -1;
+        debugf("mu_async_writev: %zu buffers: wrote %zd bytes\n", m, nwritten);
+        while (i < n && (size_t)nwritten >= chunk[i].length) {
+            nwritten -= chunk[i].length;
+            chunk[i++].length = 0;
+        }
+        if (i < n) {
+            chunk[i].offset += nwritten;
+            chunk[i].length -= nwritten;
+        }
+    }
+    return 0;
+}
+
+static int mu_async_writer_thread(void *arg)
+{
+    mu_async_writer *w = (mu_async_writer*)arg;
+    mu_async_chunk *batch = (mu_async_chunk*)malloc(w->count * sizeof(mu_async_chunk));
+
+    mtx_lock(&w->lock);
+    for (;;) {
+        while (w->queued == 0 && !w->done) cnd_wait(&w->cond, &w->lock);
+        if (w->queued == 0) break;
+
+        /* take the queued buffers, writing them without the lock */
+        size_t n = w->queued;
+        for (size_t i = 0; i < n; i++) {
+            batch[i] = w->queue[(w->head + i) % w->count];
+        }
+        mtx_unlock(&w->lock);
+        int ret = w->error ? -1 : mu_async_writev(w->fd, batch, n);
+        mtx_lock(&w->lock);
+
+        if (ret < 0) w->error = 1;
+        for (size_t i = 0; i < n; i++) {
+            w->pool[w->free++] = batch[i].data;
+        }
+        w->head = (w->head + n) % w->count;
+        w->queued -= n;
+        cnd_broadcast(&w->cond);
+    }
+    mtx_unlock(&w->lock);
+    free(batch);
+    return 0;
+}
+
+static int mu_async_writer_sync(mu_buf *buf)
+{
+    mu_async_writer *w = (mu_async_writer*)buf->userdata;
+    size_t bytes_to_write = buf->write_marker - buf->read_marker;
+    if (bytes_to_write == 0) return 0;
+
+    /* after a failed write the output is discarded, as in mu_buf_writer_sync */
+    mtx_lock(&w->lock);
+    while (w->free == 0 && !w->error) cnd_wait(&w->cond, &w->lock);
+    if (w->error) {
+        mtx_unlock(&w->lock);
+        buf->read_marker = buf->write_marker = 0;
+        return 0;
+    }
+    w->queue[(w->head + w->queued++) % w->count] =
+        mu_async_chunk { buf->data, buf->read_marker, bytes_to_write };
+    buf->data = w->pool[--w->free];
+    cnd_broadcast(&w->cond);
+    mtx_unlock(&w->lock);
+
+    buf->read_marker = buf->write_marker = 0;
+    return 0;
+}
+
+static void mu_async_writer_free(mu_async_writer *w)
+{
+    for (size_t i = 0; i < w->free; i++) {
+        free(w->pool[i]);
+    }
+    mtx_destroy(&w->lock);
+    cnd_destroy(&w->cond);
+    free(w->queue);
+    free(w->pool);
+    free(w);
+}
+
+/* returns -1 if any queued buffer could not be written */
+static int mu_async_writer_close(mu_buf *buf)
+{
+    mu_async_writer *w = (mu_async_writer*)buf->userdata;
+
+    mu_async_writer_sync(buf);
+    mtx_lock(&w->lock);
+    w->done = 1;
+    cnd_broadcast(&w->cond);
+    mtx_unlock(&w->lock);
+    thrd_join(w->thread, NULL);
+
+    int ret = close(w->fd) < 0 || w->error ? -1 : 0;
+    mu_async_writer_free(w);
+    buf->fd = -1;
+    buf->userdata = NULL;
+    return ret;
+}
+
+mu_buf* mu_async_writer_fd(int fd, size_t size, size_t count)
+{
+    if (size < async_writer_min_size) size = async_writer_min_size;
+    if (count < 2) count = 2;
+
+    mu_async_writer *w = (mu_async_writer*)calloc(1, sizeof(mu_async_writer));
+    w->queue = (mu_async_chunk*)malloc(count * sizeof(mu_async_chunk));
+    w->pool = (char**)malloc(count * sizeof(char*));
+    w->count = count;
+    w->fd = fd;
+    for (size_t i = 0; i < count - 1; i++) {
+        w->pool[w->free++] = (char*)malloc(size);
+    }
+    mtx_init(&w->lock, mtx_plain);
+    cnd_init(&w->cond);
+    if (thrd_create(&w->thread, mu_async_writer_thread, w) != thrd_success) {
+        mu_async_writer_free(w);
+        return mu_buffered_writer_fd(fd);
+    }
+
+    mu_buf *buf = (mu_buf*)malloc(sizeof(mu_buf));
+    mu_buf b = {
+        .data = (char*)malloc(size),
+        .read_marker = 0,
+        .write_marker = 0,
+        .buffer_size = size,
+        .read_check = mu_buf_capacity_error,
+        .write_check = mu_buf_writer_check_capacity,
+        .sync = mu_async_writer_sync,
+        .close = mu_async_writer_close,
+        .fd = fd,
+        .retain = 0,
+        .error = 0,
+        .userdata = w
+    };
+    *buf = b;
+    return buf;
+}
+
+mu_buf* mu_async_writer_new(const char* filename, size_t size, size_t count)
+{
+    return mu_async_writer_fd(open(filename, O_CREAT|O_TRUNC|O_WRONLY, 0666), size, count);
+}
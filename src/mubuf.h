@@ -42,6 +42,7 @@ typedef struct mu_buf mu_buf;
 
 typedef int (*check_fn)(mu_buf*,size_t);
 typedef int (*sync_fn)(mu_buf*);
+typedef int (*close_fn)(mu_buf*);
 
 static mu_buf* mu_buffered_reader_fd(int fd);
 static mu_buf* mu_buffered_writer_fd(int fd);
@@ -56,7 +57,10 @@ static void mu_buf_set_fd(mu_buf *buf, int fd);
 static void* mu_buf_get_userdata(mu_buf *buf);
 static void mu_buf_set_userdata(mu_buf *buf, void *userdata);
 static void mu_buf_reset(mu_buf* buf);
-static void mu_buf_destroy(mu_buf* buf);
+static int mu_buf_destroy(mu_buf* buf);
+
+mu_buf* mu_async_writer_fd(int fd, size_t size, size_t count);
+mu_buf* mu_async_writer_new(const char* filename, size_t size, size_t count);
 
 static size_t mu_buf_avaiable_read(mu_buf* buf);
 static size_t mu_buf_avaiable_write(mu_buf* buf);
@@ -84,6 +88,12 @@ static size_t mu_buf_read_vec_i16(mu_buf* buf, int16_t *val, size_t count);
 static size_t mu_buf_read_vec_i32(mu_buf* buf, int32_t *val, size_t count);
 static size_t mu_buf_read_vec_i64(mu_buf* buf, int64_t *val, size_t count);
 
+static char* mu_buf_write_reserve(mu_buf* buf, size_t len);
+static void mu_buf_write_commit(mu_buf* buf, char *cur);
+static const char* mu_buf_read_reserve(mu_buf* buf, size_t len);
+static const char* mu_buf_read_end(mu_buf* buf);
+static void mu_buf_read_commit(mu_buf* buf, const char *cur);
+
 /*
  * floating point helpers
  */
@@ -218,6 +228,8 @@ int mu_vf128_f32_write_byval(mu_buf *buf, const float value);
 
 int mu_vf128_f32_read_vec(mu_buf *buf, float *value, size_t count);
 int mu_vf128_f32_write_vec(mu_buf *buf, const float *value, size_t count);
+size_t mu_vf128_f32_check(const char *in, size_t len);
+size_t mu_vf128_f32_check_vec(const char *in, size_t len, size_t count);
 
 int mu_ieee754_f64_read(mu_buf *buf, float *value);
 int mu_ieee754_f64_write(mu_buf *buf, const float *value);
@@ -240,12 +252,23 @@ int mu_leb_u64_write(mu_buf *buf, const u64 *value);
 
 struct u64_result mu_leb_u64_read_byval(mu_buf *buf);
 int mu_leb_u64_write_byval(mu_buf *buf, const u64 value);
+int mu_leb_u64_read_vec(mu_buf *buf, u64 *value, size_t count);
 
 int mu_vlu_u64_read(mu_buf *buf, u64 *value);
 int mu_vlu_u64_write(mu_buf *buf, const u64 *value);
 
 struct u64_result mu_vlu_u64_read_byval(mu_buf *buf);
 int mu_vlu_u64_write_byval(mu_buf *buf, const u64 value);
+int mu_vlu_u64_read_vec(mu_buf *buf, u64 *value, size_t count);
+
+/*
+ * probabilities saturate at 2017/2048, so each decoded byte costs at
+ * least 0.176 bits and a coded byte decodes to at most 46 bytes.
+ */
+enum { mu_rc_max_expansion = 64 };
+
+int mu_rc_encode_bytes(mu_buf *buf, const char *data, size_t len, size_t lanes);
+int mu_rc_decode_bytes(mu_buf *buf, char *data, size_t len, size_t lanes);
 
 /*
  * buffer implementation
@@ -260,8 +283,10 @@ struct mu_buf
     check_fn read_check;  /* read underflow check */
     check_fn write_check; /* write overflow check */
     sync_fn  sync;        /* buffer read/write */
+    close_fn close;       /* flush and release, returning -1 on error */
     int fd;               /* file descriptor */
     int retain;           /* buffer ownership */
+    int error;            /* write failed, later output is discarded */
     void *userdata;       /* user data */
 };
 
@@ -312,18 +337,29 @@ static inline int mu_buf_resizable_check_write_capacity(mu_buf *buf, size_t len)
     return 0;
 }
 
+/*
+ * refills until len bytes are buffered or the input ends. short reads
+ * from pipes are retried and a full buffer doubles, so a read larger
+ * than the buffer grows it to no more than the input that is there.
+ */
 static inline int mu_buf_reader_check_capacity(mu_buf *buf, size_t len)
 {
-    if (buf->read_marker + len > buf->write_marker) {
+    if (len > buf->write_marker - buf->read_marker) {
         if (buf->read_marker > 0) {
             memmove(buf->data, buf->data + buf->read_marker,
                     buf->write_marker - buf->read_marker);
             buf->write_marker -= buf->read_marker;
             buf->read_marker = 0;
         }
-        if (buf->sync && buf->sync(buf) < 0) return -1;
+        while (buf->sync && len > buf->write_marker) {
+            size_t filled = buf->write_marker;
+            if (filled == buf->buffer_size &&
+                mu_buf_resize(buf, buf->buffer_size * 2) < 0) return -1;
+            if (buf->sync(buf) < 0) return -1;
+            if (buf->write_marker == filled) break;
+        }
     }
-    return (buf->read_marker + len > buf->write_marker) ? -1 : 0;
+    return (len > buf->write_marker - buf->read_marker) ? -1 : 0;
 }
 
 static inline int mu_buf_writer_check_capacity(mu_buf *buf, size_t len)
@@ -354,17 +390,25 @@ static inline int mu_buf_reader_sync(mu_buf *buf)
     return 0;
 }
 
+/*
+ * a failed write is recorded and the output that follows is discarded,
+ * so writers see the failure when the buffer is destroyed.
+ */
 static inline int mu_buf_writer_sync(mu_buf *buf)
 {
     /* buf ----- read_marker <===> write_marker ----- buffer_size */
-    size_t bytes_to_write = buf->write_marker - buf->read_marker;
-    if (bytes_to_write > 0) {
+    while (buf->write_marker > buf->read_marker && !buf->error) {
+        size_t bytes_to_write = buf->write_marker - buf->read_marker;
         ssize_t nwritten = write(buf->fd, buf->data + buf->read_marker, bytes_to_write);
-        if (nwritten < 0) return -1;
+        if (nwritten < 0) {
+            buf->error = 1;
+            break;
+        }
         buf->read_marker += nwritten;
         debugf("mu_buf_writer_sync: read_marker=%zu write_marker=%zu buffer_size=%zu: wrote %zu bytes\n",
             buf->read_marker, buf->write_marker, buf->buffer_size, nwritten);
     }
+    if (buf->error) buf->read_marker = buf->write_marker;
     return 0;
 }
 
@@ -380,8 +424,10 @@ static inline mu_buf* mu_buffered_reader_fd(int fd)
         .read_check = mu_buf_reader_check_capacity,
         .write_check = mu_buf_capacity_error,
         .sync = mu_buf_reader_sync,
+        .close = NULL,
         .fd = fd,
         .retain = 0,
+        .error = 0,
         .userdata = NULL
     };
     *buf = b;
@@ -400,8 +446,10 @@ static inline mu_buf* mu_buffered_writer_fd(int fd)
         .read_check = mu_buf_capacity_error,
         .write_check = mu_buf_writer_check_capacity,
         .sync = mu_buf_writer_sync,
+        .close = NULL,
         .fd = fd,
         .retain = 0,
+        .error = 0,
         .userdata = NULL
     };
     *buf = b;
@@ -429,8 +477,10 @@ static inline mu_buf* mu_buf_new(size_t size)
         .read_check = mu_buf_fixed_check_read_capacity,
         .write_check = mu_buf_fixed_check_write_capacity,
         .sync = NULL,
+        .close = NULL,
         .fd = -1,
         .retain = 0,
+        .error = 0,
         .userdata = NULL
     };
     *buf = b;
@@ -448,8 +498,10 @@ static inline mu_buf* mu_buf_memory_new(char *data, size_t size)
         .read_check = mu_buf_fixed_check_read_capacity,
         .write_check = mu_buf_fixed_check_write_capacity,
         .sync = NULL,
+        .close = NULL,
         .fd = -1,
         .retain = 1,
+        .error = 0,
         .userdata = NULL
     };
     *buf = b;
@@ -468,8 +520,10 @@ static inline mu_buf* mu_resizable_buf_new()
         .read_check = mu_buf_fixed_check_read_capacity,
         .write_check = mu_buf_resizable_check_write_capacity,
         .sync = NULL,
+        .close = NULL,
         .fd = -1,
         .retain = 0,
+        .error = 0,
         .userdata = NULL
     };
     *buf = b;
@@ -502,18 +556,25 @@ static void mu_buf_reset(mu_buf* buf)
     buf->write_marker = 0;
 }
 
-static inline void mu_buf_destroy(mu_buf* buf)
+/* returns -1 if buffered output could not be written */
+static inline int mu_buf_destroy(mu_buf* buf)
 {
+    int ret = 0;
+    if (buf->close) {
+        ret = buf->close(buf);
+    }
     if (buf->fd >= 0) {
         if (buf->write_marker > buf->read_marker && buf->sync) buf->sync(buf);
-        close(buf->fd);
+        if (close(buf->fd) < 0) ret = -1;
         buf->fd = -1;
     }
+    if (buf->error) ret = -1;
     if (!buf->retain && buf->data) {
         free(buf->data);
         buf->data = NULL;
     }
     free(buf);
+    return ret;
 }
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64)
@@ -751,6 +812,126 @@ static inline size_t mu_buf_read_bytes_unchecked(mu_buf* buf, char *dst, size_t
     return len;
 }
 
+/*
+ * cursor interface
+ *
+ * reserve returns a raw cursor into the buffer with room for len bytes,
+ * or NULL. the check function is only called when the buffer is short,
+ * so a reservation that fits is a compare. the cursor accessors below
+ * advance the cursor without checks and commit moves the marker up to
+ * the cursor. a write reservation is an upper bound on the bytes put
+ * before the commit. bounded read accessors may read on up to
+ * mu_buf_read_end. other buffer calls between reserve and commit may
+ * move the data, so cursors must not be held across them.
+ */
+
+enum { mu_leb_max_length = 8 };
+
+static inline char* mu_buf_write_reserve(mu_buf *buf, size_t len)
+{
+    if (buf->buffer_size - buf->write_marker < len && buf->write_check(buf, len)) {
+        return NULL;
+    }
+    return buf->data + buf->write_marker;
+}
+
+static inline void mu_buf_write_commit(mu_buf *buf, char *cur)
+{
+    buf->write_marker = cur - buf->data;
+}
+
+static inline const char* mu_buf_read_reserve(mu_buf *buf, size_t len)
+{
+    if (buf->write_marker - buf->read_marker < len && buf->read_check(buf, len)) {
+        return NULL;
+    }
+    return buf->data + buf->read_marker;
+}
+
+static inline const char* mu_buf_read_end(mu_buf *buf)
+{
+    return buf->data + buf->write_marker;
+}
+
+static inline void mu_buf_read_commit(mu_buf *buf, const char *cur)
+{
+    buf->read_marker = cur - buf->data;
+}
+
+static inline char* mu_cur_put_i8(char *cur, int8_t val)
+{
+    *cur = (char)val;
+    return cur + 1;
+}
+
+static inline char* mu_cur_put_i32(char *cur, int32_t val)
+{
+    uint32_t t = le32((uint32_t)val);
+    memcpy(cur, &t, sizeof(t));
+    return cur + sizeof(t);
+}
+
+static inline char* mu_cur_put_f32(char *cur, float val)
+{
+    uint32_t t;
+    memcpy(&t, &val, sizeof(t));
+    return mu_cur_put_i32(cur, (int32_t)t);
+}
+
+static inline char* mu_cur_put_bytes(char *cur, const char *src, size_t len)
+{
+    memcpy(cur, src, len);
+    return cur + len;
+}
+
+/* values are limited to 56 bits, the same as mu_leb_u64_write */
+static inline char* mu_cur_put_leb(char *cur, u64 val)
+{
+    while (val >= 0x80) {
+        *cur++ = (char)((val & 0x7f) | 0x80);
+        val >>= 7;
+    }
+    *cur++ = (char)val;
+    return cur;
+}
+
+static inline const char* mu_cur_get_i8(const char *cur, int8_t *val)
+{
+    *val = (int8_t)*cur;
+    return cur + 1;
+}
+
+static inline const char* mu_cur_get_i32(const char *cur, int32_t *val)
+{
+    uint32_t t;
+    memcpy(&t, cur, sizeof(t));
+    *val = (int32_t)le32(t);
+    return cur + sizeof(t);
+}
+
+static inline const char* mu_cur_get_f32(const char *cur, float *val)
+{
+    int32_t t;
+    cur = mu_cur_get_i32(cur, &t);
+    memcpy(val, &t, sizeof(t));
+    return cur;
+}
+
+/* returns NULL if the encoding is truncated by end or is too long */
+static inline const char* mu_cur_get_leb(const char *cur, const char *end, u64 *val)
+{
+    u64 v = 0;
+    for (size_t w = 0; cur < end && w < 56; w += 7) {
+        u8 b = (u8)*cur++;
+        v |= (u64)(b & 0x7f) << w;
+        if (!(b & 0x80)) {
+            *val = v;
+            return cur;
+        }
+    }
+    return NULL;
+}
+
 #ifdef __cplusplus
 }
 #endif
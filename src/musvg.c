@@ -33,11 +33,24 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <float.h>
+#include <locale.h>
 #include <ctype.h>
+#include <errno.h>
 #include <threads.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifndef _WIN32
 #include <alloca.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #else
 #define alloca _alloca
 #endif
@@ -102,6 +115,19 @@ static void array_buffer_destroy(array_buffer *sb)
     sb->data = NULL;
 }
 
+/* mapped buffers point at memory owned by the caller and must not grow */
+static void array_buffer_map(array_buffer *sb, size_t stride, void *data, size_t count)
+{
+    sb->capacity = count;
+    sb->count = count;
+    sb->data = (char*)data;
+}
+
+static void array_buffer_unmap(array_buffer *sb)
+{
+    sb->data = NULL;
+}
+
 static size_t array_buffer_count(array_buffer *sb)
 {
     return sb->count;
@@ -122,6 +148,11 @@ static void* array_buffer_get(array_buffer *sb, size_t stride, size_t idx)
     return sb->data + idx * stride;
 }
 
+static void array_buffer_truncate(array_buffer *sb, size_t count)
+{
+    if (count < sb->count) sb->count = count;
+}
+
 static int array_buffer_linear(array_buffer *sb, size_t idx, size_t count)
 {
     return 1;
@@ -139,6 +170,13 @@ static void array_buffer_resize(array_buffer *sb, size_t stride, size_t count)
     }
 }
 
+static void* array_buffer_span(array_buffer *sb, size_t stride, size_t idx, size_t *count)
+{
+    array_buffer_resize(sb, stride, idx + 1);
+    *count = sb->capacity - idx;
+    return sb->data + idx * stride;
+}
+
 static size_t array_buffer_alloc(array_buffer *sb, size_t stride, size_t count)
 {
     array_buffer_resize(sb, stride, sb->count + count);
@@ -181,6 +219,18 @@ static void storage_buffer_destroy(storage_buffer *sb)
     sb->data = NULL;
 }
 
+static void storage_buffer_map(storage_buffer *sb, void *data, size_t size)
+{
+    sb->capacity = size;
+    sb->offset = size;
+    sb->data = (char*)data;
+}
+
+static void storage_buffer_unmap(storage_buffer *sb)
+{
+    sb->data = NULL;
+}
+
 static size_t storage_buffer_size(storage_buffer *sb)
 {
     return sb->offset;
@@ -208,12 +258,20 @@ static void storage_buffer_resize(storage_buffer *sb, size_t offset)
     }
 }
 
+static void storage_buffer_truncate(storage_buffer *sb, size_t offset)
+{
+    if (offset < sb->offset) sb->offset = offset;
+}
+
 static musvg_index storage_buffer_alloc(storage_buffer *sb, size_t size, size_t align)
 {
     size_t offset = sb->offset, max_align = align > 8 ? 8 : align;
     size_t our_offset = (offset + max_align - 1) & ~(max_align - 1);
     size_t align_size = (size   + max_align - 1) & ~(max_align - 1);
     storage_buffer_resize(sb, our_offset + align_size);
+    /* zero the padding so that images of the storage are reproducible */
+    memset(sb->data + offset, 0, our_offset - offset);
+    memset(sb->data + our_offset + size, 0, align_size - size);
     sb->offset = our_offset + align_size;
     return our_offset;
 }
@@ -225,26 +283,34 @@ static musvg_index storage_buffer_alloc(storage_buffer *sb, size_t size, size_t
 #define vec_init(p,stride,size)      mu_vec_init(p,stride,size)
 #define vec_resize(p,stride,count)   mu_vec_resize(p,stride,count)
 #define vec_destroy(p)               mu_vec_destroy(p)
+#define vec_map(p,stride,data,count) mu_vec_map(p,stride,data,count)
+#define vec_unmap(p)                 mu_vec_unmap(p)
 #define vec_count(p)                 mu_vec_count(p)
 #define vec_size(p,stride)           mu_vec_size(p,stride)
 #define vec_capacity(p,stride)       mu_vec_capacity(p,stride)
 #define vec_linear(p,idx,count)      mu_vec_linear(p,idx,count)
 #define vec_get(p,stride,idx)        mu_vec_get(p,stride,idx)
+#define vec_span(p,stride,idx,count) mu_vec_span(p,stride,idx,count)
 #define vec_set(p,stride,idx,ptr)    mu_vec_set(p,stride,idx,ptr)
 #define vec_add(p,stride,ptr)        mu_vec_add_relaxed(p,stride,ptr)
 #define vec_alloc(p,stride,count)    mu_vec_alloc_relaxed(p,stride,count)
+#define vec_truncate(p,count)        mu_vec_truncate(p,count)
 #else
 #define vec array_buffer
 #define vec_init(p,stride,size)      array_buffer_init(p,stride,size)
 #define vec_resize(p,stride,count)   array_buffer_resize(p,stride,count)
 #define vec_destroy(p)               array_buffer_destroy(p)
+#define vec_map(p,stride,data,count) array_buffer_map(p,stride,data,count)
+#define vec_unmap(p)                 array_buffer_unmap(p)
 #define vec_count(p)                 array_buffer_count(p)
 #define vec_size(p,stride)           array_buffer_size(p,stride)
 #define vec_capacity(p,stride)       array_buffer_capacity(p,stride)
 #define vec_linear(p,idx,count)      array_buffer_linear(p,idx,count)
 #define vec_get(p,stride,idx)        array_buffer_get(p,stride,idx)
+#define vec_span(p,stride,idx,count) array_buffer_span(p,stride,idx,count)
 #define vec_add(p,stride,ptr)        array_buffer_add(p,stride,ptr)
 #define vec_alloc(p,stride,count)    array_buffer_alloc(p,stride,count)
+#define vec_truncate(p,count)        array_buffer_truncate(p,count)
 #endif
 
 #define points_init(p) vec_init(&p->points,sizeof(float),16)
@@ -273,6 +339,76 @@ static musvg_index storage_buffer_alloc(storage_buffer *sb, size_t size, size_t
 #define path_points_get(p,idx) ((musvg_points*)vec_get(&p->path_points,sizeof(musvg_points),idx))
 #define path_points_add(p,ptr) vec_add(&p->path_points,sizeof(musvg_points),ptr)
 
+/*
+ * append cursor. elements are written in place at the end of a vector
+ * one contiguous run at a time, so there is one compare per element and
+ * an extent lookup only when a run is exhausted. the elements become
+ * visible when the cursor is committed, which advances the count.
+ */
+
+typedef struct musvg_cursor musvg_cursor;
+
+struct musvg_cursor
+{
+    vec *v;
+    size_t stride, count;
+    char *ptr, *limit;
+};
+
+static inline void musvg_cursor_init(musvg_cursor *c, vec *v, size_t stride)
+{
+    c->v = v;
+    c->stride = stride;
+    c->count = 0;
+    c->ptr = c->limit = NULL;
+}
+
+static inline size_t musvg_cursor_index(musvg_cursor *c)
+{
+    return vec_count(c->v) + c->count;
+}
+
+static inline void* musvg_cursor_run(musvg_cursor *c, size_t *count)
+{
+    if (c->ptr == c->limit) {
+        size_t run;
+        c->ptr = (char*)vec_span(c->v, c->stride, musvg_cursor_index(c), &run);
+        c->limit = c->ptr + run * c->stride;
+    }
+    *count = (c->limit - c->ptr) / c->stride;
+    return c->ptr;
+}
+
+static inline void musvg_cursor_advance(musvg_cursor *c, size_t count)
+{
+    c->ptr += count * c->stride;
+    c->count += count;
+}
+
+static inline void* musvg_cursor_next(musvg_cursor *c)
+{
+    size_t run;
+    void *elem = musvg_cursor_run(c, &run);
+    musvg_cursor_advance(c, 1);
+    return elem;
+}
+
+static inline void musvg_cursor_rewind(musvg_cursor *c, size_t count)
+{
+    if (count == 0) return;
+    c->count -= count;
+    c->ptr = c->limit = NULL;
+}
+
+static inline size_t musvg_cursor_commit(musvg_cursor *c)
+{
+    if (c->count == 0) return vec_count(c->v);
+    size_t idx = vec_alloc(c->v, c->stride, c->count);
+    c->count = 0;
+    c->ptr = c->limit = NULL;
+    return idx;
+}
+
 #define brushes_init(p) vec_init(&p->brushes,sizeof(musvg_brush),16)
 #define brushes_destroy(p) vec_destroy(&p->brushes)
 #define brushes_count(p) vec_count(&p->brushes)
@@ -322,12 +458,19 @@ static musvg_index storage_buffer_alloc(storage_buffer *sb, size_t size, size_t
 static inline musvg_attr as_attr(int i) { return (musvg_attr)i; }
 
 enum { musvg_max_depth = 256 };
+enum { musvg_write_buffer_size = 1 << 18, musvg_write_buffers = 2 };
+enum { musvg_read_block_size = 1 << 16 };
 
 // SVG parser
 
 typedef struct musvg_slot musvg_slot;
 typedef struct musvg_node musvg_node;
 typedef struct musvg_hash musvg_hash;
+typedef struct musvg_chunk musvg_chunk;
+typedef struct musvg_columns musvg_columns;
+typedef struct musvg_string_table musvg_string_table;
+typedef struct musvg_class_table musvg_class_table;
+typedef struct musvg_transcoder musvg_transcoder;
 
 struct musvg_slot
 {
@@ -363,6 +506,7 @@ struct musvg_parser
     storage_buffer strings;    /* variable length string storage */
 
     mu_mule mule;
+    musvg_chunk *chunks;       /* parallel parse work items */
     mu_hash_ctx hash_ctx;
     mu_buf *hash_buf;
 
@@ -373,13 +517,32 @@ struct musvg_parser
     int (*f32_write)(mu_buf *buf, const float value);
     int (*f32_read_vec)(mu_buf *buf, float *value, size_t n);
     int (*f32_write_vec)(mu_buf *buf, const float *value, size_t n);
+
+    musvg_columns *columns;    /* svgc section buffers */
+    musvg_string_table *string_table; /* svgv, svgb and svgd strings */
+    musvg_class_table *class_table; /* svgv, svgb and svgd style classes */
+    int grid_digits;           /* svgd coordinate grid digits or -1 */
+    int grid_precision;        /* requested svgd grid digits or -1 */
+    musvg_span image;          /* read-only mapped image or empty */
+    int subtree_index;         /* emit binary subtree index footer */
+    int style_classes;         /* emit binary style class table */
+    size_t write_buffer_size;  /* emit file buffer size */
+    size_t write_buffers;      /* emit file buffers, fewer than two is synchronous */
+    musvg_transcoder *transcoder; /* streaming transcode output or NULL */
 };
 
+static musvg_index musvg_transcode_node_add(musvg_parser *p, musvg_element type);
+static void musvg_transcode_open(musvg_parser *p, musvg_index node_idx);
+static void musvg_transcode_close(musvg_parser *p);
+static void musvg_transcode_keep(musvg_parser *p);
+static void musvg_transcode_fail(musvg_parser *p, int error);
+
 // parser common
 
-static int musvg_isspace(char c)
+static inline int musvg_isspace(char c)
 {
-    return strchr(" \t\n\v\f\r", c) != 0;
+    /* matches " \t\n\v\f\r" */
+    return c == ' ' || (c >= '\t' && c <= '\r');
 }
 
 static int musvg_isdigit(char c)
@@ -565,6 +728,323 @@ static const char* musvg_type_names[] = {
     [musvg_type_points]                       = "points",
 };
 
+// SVG name lookup
+
+/*
+ * element, attribute and keyword names are resolved using perfect hash
+ * tables. the key packs the first, second, middle and last characters
+ * with the length, which is multiplied by a per-table seed and the top
+ * bits select a slot holding the name index. one compare confirms the
+ * match, so unknown names and empty slots return -1.
+ */
+
+typedef struct musvg_name_table musvg_name_table;
+
+struct musvg_name_table
+{
+    const char ** names;
+    const musvg_small * slots;
+    ullong seed;
+    uint bits;
+};
+
+static inline int musvg_strneq(const char* s, size_t len, const char* lit)
+{
+    return strncmp(s, lit, len) == 0 && lit[len] == '\0';
+}
+
+static inline ullong musvg_name_key(const char* s, size_t len)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    return (ullong)u[0] | (ullong)u[len > 1] << 8 | (ullong)u[len >> 1] << 16 |
+           (ullong)u[len - 1] << 24 | (ullong)len << 32;
+}
+
+static inline int musvg_name_lookup(const musvg_name_table *t, const char* s, size_t len)
+{
+    if (len == 0) return -1;
+    size_t slot = (size_t)((musvg_name_key(s, len) * t->seed) >> (64 - t->bits));
+    int idx = t->slots[slot];
+    const char *name = t->names[idx];
+    return name && musvg_strneq(s, len, name) ? idx : -1;
+}
+
+/* perfect hash tables generated by scripts/gen_name_hash.py */
+
+static const musvg_small musvg_element_slots[16] = {
+    [1] = musvg_element_line,
+    [2] = musvg_element_radial_gradient,
+    [3] = musvg_element_polygon,
+    [4] = musvg_element_defs,
+    [5] = musvg_element_svg,
+    [6] = musvg_element_g,
+    [9] = musvg_element_linear_gradient,
+    [10] = musvg_element_ellipse,
+    [11] = musvg_element_path,
+    [12] = musvg_element_circle,
+    [13] = musvg_element_stop,
+    [14] = musvg_element_rect,
+    [15] = musvg_element_polyline,
+};
+static const musvg_name_table musvg_element_table = {
+    musvg_element_names, musvg_element_slots, 0x5008779d57514ec1ull, 4
+};
+
+static const musvg_small musvg_attribute_slots[128] = {
+    [2] = musvg_attr_y2,
+    [7] = musvg_attr_font_size,
+    [8] = musvg_attr_r,
+    [10] = musvg_attr_x,
+    [12] = musvg_attr_xmlns,
+    [14] = musvg_attr_rx,
+    [16] = musvg_attr_width,
+    [17] = musvg_attr_fy,
+    [19] = musvg_attr_xlink_href,
+    [22] = musvg_attr_stroke_opacity,
+    [23] = musvg_attr_x1,
+    [24] = musvg_attr_stroke_dasharray,
+    [26] = musvg_attr_height,
+    [27] = musvg_attr_preserve_aspect_ratio,
+    [30] = musvg_attr_display,
+    [31] = musvg_attr_stroke_width,
+    [32] = musvg_attr_gradient_units,
+    [39] = musvg_attr_id,
+    [40] = musvg_attr_xmlns_xlink,
+    [45] = musvg_attr_d,
+    [48] = musvg_attr_stroke_miterlimit,
+    [51] = musvg_attr_cx,
+    [52] = musvg_attr_stop_opacity,
+    [59] = musvg_attr_transform,
+    [64] = musvg_attr_ry,
+    [65] = musvg_attr_stroke_linecap,
+    [69] = musvg_attr_gradient_transform,
+    [73] = musvg_attr_x2,
+    [80] = musvg_attr_y1,
+    [83] = musvg_attr_points,
+    [92] = musvg_attr_fill_opacity,
+    [95] = musvg_attr_fx,
+    [99] = musvg_attr_stroke,
+    [100] = musvg_attr_style,
+    [101] = musvg_attr_cy,
+    [104] = musvg_attr_view_box,
+    [109] = musvg_attr_fill_rule,
+    [110] = musvg_attr_stroke_linejoin,
+    [115] = musvg_attr_spread_method,
+    [116] = musvg_attr_fill,
+    [117] = musvg_attr_y,
+    [120] = musvg_attr_offset,
+    [121] = musvg_attr_stop_color,
+    [127] = musvg_attr_stroke_dashoffset,
+};
+static const musvg_name_table musvg_attribute_table = {
+    musvg_attribute_names, musvg_attribute_slots, 0x7288ac2eb7d4d1cdull, 7
+};
+
+static const musvg_small musvg_linecap_slots[4] = {
+    [0] = musvg_linecap_butt,
+    [2] = musvg_linecap_square,
+    [3] = musvg_linecap_round,
+};
+static const musvg_name_table musvg_linecap_table = {
+    musvg_linecap_names, musvg_linecap_slots, 0x8ff34785799e5cbdull, 2
+};
+
+static const musvg_small musvg_linejoin_slots[4] = {
+    [0] = musvg_linejoin_miter,
+    [1] = musvg_linejoin_round,
+    [3] = musvg_linejoin_bevel,
+};
+static const musvg_name_table musvg_linejoin_table = {
+    musvg_linejoin_names, musvg_linejoin_slots, 0xdaa66d2c7ddf743full, 2
+};
+
+static const musvg_small musvg_fillrule_slots[2] = {
+    [0] = musvg_fillrule_evenodd,
+    [1] = musvg_fillrule_nonzero,
+};
+static const musvg_name_table musvg_fillrule_table = {
+    musvg_fillrule_names, musvg_fillrule_slots, 0x9e3779b97f4a7c15ull, 1
+};
+
+static const musvg_small musvg_display_slots[2] = {
+    [0] = musvg_display_none,
+    [1] = musvg_display_inline,
+};
+static const musvg_name_table musvg_display_table = {
+    musvg_display_names, musvg_display_slots, 0x3c6ef372fe94f82bull, 1
+};
+
+static const musvg_small musvg_spread_method_slots[4] = {
+    [1] = musvg_spread_method_reflect,
+    [2] = musvg_spread_method_pad,
+    [3] = musvg_spread_method_repeat,
+};
+static const musvg_name_table musvg_spread_method_table = {
+    musvg_spread_method_names, musvg_spread_method_slots, 0x3c6ef372fe94f82bull, 2
+};
+
+static const musvg_small musvg_gradient_unit_slots[2] = {
+    [0] = musvg_gradient_unit_user,
+    [1] = musvg_gradient_unit_obb,
+};
+static const musvg_name_table musvg_gradient_unit_table = {
+    musvg_gradient_unit_names, musvg_gradient_unit_slots, 0x9e3779b97f4a7c15ull, 1
+};
+
+static const unsigned char musvg_color_slots[1024] = {
+    [0] = 45, /* darkturquoise */
+    [5] = 113, /* paleturquoise */
+    [9] = 42, /* darkslateblue */
+    [10] = 104, /* navy */
+    [23] = 37, /* darkorange */
+    [26] = 90, /* mediumaquamarine */
+    [28] = 140, /* thistle */
+    [30] = 36, /* darkolivegreen */
+    [39] = 83, /* lightslategrey */
+    [43] = 20, /* burlywood */
+    [45] = 129, /* sienna */
+    [53] = 141, /* tomato */
+    [71] = 10, /* aliceblue */
+    [78] = 132, /* slateblue */
+    [88] = 38, /* darkorchid */
+    [89] = 85, /* lightyellow */
+    [90] = 91, /* mediumblue */
+    [99] = 87, /* limegreen */
+    [103] = 109, /* orangered */
+    [106] = 57, /* ghostwhite */
+    [108] = 115, /* papayawhip */
+    [139] = 5, /* magenta */
+    [164] = 19, /* brown */
+    [165] = 74, /* lightgoldenrodyellow */
+    [186] = 106, /* olive */
+    [188] = 50, /* dimgrey */
+    [192] = 8, /* gray */
+    [198] = 64, /* indigo */
+    [213] = 117, /* peru */
+    [224] = 22, /* chartreuse */
+    [231] = 101, /* mistyrose */
+    [233] = 84, /* lightsteelblue */
+    [235] = 46, /* darkviolet */
+    [259] = 76, /* lightgreen */
+    [263] = 43, /* darkslategray */
+    [269] = 21, /* cadetblue */
+    [278] = 48, /* deepskyblue */
+    [283] = 11, /* antiquewhite */
+    [295] = 96, /* mediumspringgreen */
+    [307] = 54, /* forestgreen */
+    [310] = 60, /* greenyellow */
+    [316] = 18, /* blueviolet */
+    [327] = 53, /* floralwhite */
+    [332] = 133, /* slategray */
+    [375] = 144, /* wheat */
+    [381] = 145, /* whitesmoke */
+    [385] = 29, /* darkcyan */
+    [389] = 2, /* blue */
+    [393] = 31, /* darkgray */
+    [394] = 95, /* mediumslateblue */
+    [410] = 30, /* darkgoldenrod */
+    [415] = 111, /* palegoldenrod */
+    [434] = 59, /* goldenrod */
+    [442] = 123, /* royalblue */
+    [445] = 72, /* lightcoral */
+    [462] = 12, /* aqua */
+    [468] = 102, /* moccasin */
+    [469] = 16, /* bisque */
+    [474] = 63, /* indianred */
+    [477] = 108, /* orange */
+    [480] = 77, /* lightgrey */
+    [481] = 139, /* teal */
+    [487] = 47, /* deeppink */
+    [490] = 40, /* darksalmon */
+    [497] = 79, /* lightsalmon */
+    [509] = 97, /* mediumturquoise */
+    [515] = 55, /* fuchsia */
+    [524] = 24, /* coral */
+    [528] = 94, /* mediumseagreen */
+    [530] = 143, /* violet */
+    [540] = 122, /* rosybrown */
+    [547] = 41, /* darkseagreen */
+    [548] = 82, /* lightslategray */
+    [550] = 86, /* lime */
+    [552] = 128, /* seashell */
+    [554] = 25, /* cornflowerblue */
+    [570] = 119, /* plum */
+    [573] = 105, /* oldlace */
+    [578] = 13, /* aquamarine */
+    [596] = 70, /* lemonchiffon */
+    [598] = 0, /* red */
+    [600] = 124, /* saddlebrown */
+    [617] = 114, /* palevioletred */
+    [625] = 66, /* khaki */
+    [626] = 118, /* pink */
+    [629] = 3, /* yellow */
+    [630] = 61, /* honeydew */
+    [631] = 56, /* gainsboro */
+    [635] = 110, /* orchid */
+    [645] = 7, /* grey */
+    [647] = 17, /* blanchedalmond */
+    [649] = 67, /* lavender */
+    [653] = 135, /* snow */
+    [659] = 69, /* lawngreen */
+    [660] = 89, /* maroon */
+    [675] = 58, /* gold */
+    [676] = 26, /* cornsilk */
+    [678] = 107, /* olivedrab */
+    [679] = 65, /* ivory */
+    [690] = 92, /* mediumorchid */
+    [694] = 125, /* salmon */
+    [697] = 49, /* dimgray */
+    [709] = 121, /* purple */
+    [713] = 103, /* navajowhite */
+    [720] = 99, /* midnightblue */
+    [721] = 6, /* black */
+    [729] = 28, /* darkblue */
+    [734] = 1, /* green */
+    [736] = 71, /* lightblue */
+    [737] = 39, /* darkred */
+    [741] = 93, /* mediumpurple */
+    [745] = 34, /* darkkhaki */
+    [748] = 98, /* mediumvioletred */
+    [751] = 23, /* chocolate */
+    [770] = 80, /* lightseagreen */
+    [778] = 44, /* darkslategrey */
+    [785] = 136, /* springgreen */
+    [798] = 146, /* yellowgreen */
+    [819] = 100, /* mintcream */
+    [820] = 142, /* turquoise */
+    [824] = 4, /* cyan */
+    [830] = 116, /* peachpuff */
+    [838] = 35, /* darkmagenta */
+    [844] = 81, /* lightskyblue */
+    [845] = 51, /* dodgerblue */
+    [847] = 134, /* slategrey */
+    [850] = 120, /* powderblue */
+    [851] = 27, /* crimson */
+    [875] = 52, /* firebrick */
+    [886] = 88, /* linen */
+    [888] = 14, /* azure */
+    [894] = 9, /* white */
+    [899] = 131, /* skyblue */
+    [905] = 127, /* seagreen */
+    [908] = 33, /* darkgrey */
+    [919] = 73, /* lightcyan */
+    [945] = 137, /* steelblue */
+    [954] = 68, /* lavenderblush */
+    [958] = 15, /* beige */
+    [987] = 138, /* tan */
+    [989] = 75, /* lightgray */
+    [990] = 78, /* lightpink */
+    [993] = 62, /* hotpink */
+    [998] = 32, /* darkgreen */
+    [999] = 126, /* sandybrown */
+    [1002] = 112, /* palegreen */
+    [1013] = 130, /* silver */
+};
+static const ullong musvg_color_seed = 0x556e7c20302805dbull;
+static const uint musvg_color_bits = 10;
+
+/* end of generated perfect hash tables */
+
 static const musvg_type_t musvg_attr_types[] =
 {
     /* common attributes */
@@ -615,12 +1095,12 @@ static const musvg_type_t musvg_attr_types[] =
     [musvg_attr_xlink_href]                   = musvg_type_id,
 };
 
-musvg_small musvg_parse_linecap(const char* str);
-musvg_small musvg_parse_linejoin(const char* str);
-musvg_small musvg_parse_fillrule(const char* str);
-musvg_small musvg_parse_display(const char* str);
-musvg_small musvg_parse_spread_method(const char* str);
-musvg_small musvg_parse_gradient_units(const char* str);
+musvg_small musvg_parse_linecap(const char* str, size_t len);
+musvg_small musvg_parse_linejoin(const char* str, size_t len);
+musvg_small musvg_parse_fillrule(const char* str, size_t len);
+musvg_small musvg_parse_display(const char* str, size_t len);
+musvg_small musvg_parse_spread_method(const char* str, size_t len);
+musvg_small musvg_parse_gradient_units(const char* str, size_t len);
 
 static const musvg_typeinfo_enum musvg_type_info_enum[] =
 {
@@ -698,38 +1178,130 @@ static inline uint musvg_parse_opcode(char c)
 #define CONTENT 2
 #define MAX_ATTRIBS 256
 
-static void musvg_parse_content(char* s,
-                         void (*content_cb)(void* ud, const char* s),
+typedef struct musvg_slice musvg_slice;
+
+struct musvg_slice
+{
+    const char* data;
+    size_t size;
+};
+
+/*
+ * XML structural character scanner
+ *
+ * the tokenizer classifies structural characters in 32-byte blocks,
+ * producing a bitmask with one bit per input byte that is then walked
+ * using ctz. AVX2 classifies a block with one compare per character,
+ * SSE2 uses two 16-byte halves, and the portable fallback uses SWAR
+ * on 64-bit words. blocks at the end of the input are copied into a
+ * zero-padded temporary so that loads never cross the end of input.
+ */
+
+enum { musvg_xml_block_size = 32 };
+
+#if defined(__AVX2__)
+static inline uint musvg_xml_match_block(const char *s, char c0, char c1)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*)s);
+    __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c0)),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c1)));
+    return (uint)_mm256_movemask_epi8(m);
+}
+#elif defined(__SSE2__)
+static inline uint musvg_xml_match_block(const char *s, char c0, char c1)
+{
+    __m128i k0 = _mm_set1_epi8(c0), k1 = _mm_set1_epi8(c1);
+    __m128i v0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)(s + 16));
+    __m128i m0 = _mm_or_si128(_mm_cmpeq_epi8(v0, k0), _mm_cmpeq_epi8(v0, k1));
+    __m128i m1 = _mm_or_si128(_mm_cmpeq_epi8(v1, k0), _mm_cmpeq_epi8(v1, k1));
+    return (uint)_mm_movemask_epi8(m0) | ((uint)_mm_movemask_epi8(m1) << 16);
+}
+#else
+static inline uint musvg_xml_match_word(ullong w, char c)
+{
+    /* exact per-byte equality: the high bit of each byte of t is set
+     * if and only if the byte equals c, then gather the high bits. */
+    const ullong lo7 = 0x7f7f7f7f7f7f7f7full;
+    ullong x = w ^ (0x0101010101010101ull * (unsigned char)c);
+    ullong t = ~(((x & lo7) + lo7) | x | lo7);
+    return (uint)(((t >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+static inline uint musvg_xml_match_block(const char *s, char c0, char c1)
+{
+    uint mask = 0;
+    for (size_t i = 0; i < musvg_xml_block_size; i += 8) {
+        ullong w;
+        memcpy(&w, s + i, 8);
+        w = le64(w);
+        mask |= (musvg_xml_match_word(w, c0) | musvg_xml_match_word(w, c1)) << i;
+    }
+    return mask;
+}
+#endif
+
+static inline uint musvg_xml_block_mask(const char *s, const char *end, char c0, char c1)
+{
+    size_t n = end - s;
+    if (n >= musvg_xml_block_size) {
+        return musvg_xml_match_block(s, c0, c1);
+    } else {
+        char tmp[musvg_xml_block_size] = { 0 };
+        memcpy(tmp, s, n);
+        return musvg_xml_match_block(tmp, c0, c1) & ((1u << n) - 1);
+    }
+}
+
+static inline const char* musvg_xml_find(const char *s, const char *end, char c)
+{
+    while (s < end) {
+        uint mask = musvg_xml_block_mask(s, end, c, c);
+        if (mask) return s + ctz(mask);
+        s += musvg_xml_block_size;
+    }
+    return end;
+}
+
+/*
+ * the tokenizer does not modify its input. element names, attribute
+ * names and values, and content are passed to the callbacks as slices
+ * of the source buffer which are not zero-terminated.
+ */
+
+static void musvg_parse_content(const char* s, const char* end,
+                         void (*content_cb)(void* ud, musvg_slice s),
                          void* ud)
 {
     // Trim start white spaces
-    while (*s && musvg_isspace(*s)) s++;
-    if (!*s) return;
+    while (s < end && musvg_isspace(*s)) s++;
+    if (s == end) return;
 
     if (content_cb) {
-        (*content_cb)(ud, s);
+        musvg_slice content = { s, (size_t)(end - s) };
+        (*content_cb)(ud, content);
     }
 }
 
-static void musvg_parse_element(char* s,
-                         void (*startel_cb)(void* ud, const char* el, const char** attr),
-                         void (*endel_cb)(void* ud, const char* el),
+static void musvg_parse_element(const char* s, const char* end,
+                         void (*startel_cb)(void* ud, musvg_slice el, const musvg_slice* attr, size_t nattr),
+                         void (*endel_cb)(void* ud, musvg_slice el),
                          void* ud)
 {
-    const char* attr[MAX_ATTRIBS];
-    int nattr = 0;
-    char* name;
+    musvg_slice attr[MAX_ATTRIBS];
+    musvg_slice name;
+    size_t nattr = 0;
     int start = 0;
-    int end = 0;
+    int end_tag = 0;
 
     // Skip white space after the '<'
-    while (*s && musvg_isspace(*s)) s++;
+    while (s < end && musvg_isspace(*s)) s++;
 
     // Check if the tag is end tag
-    if (*s == '/')
+    if (s < end && *s == '/')
     {
         s++;
-        end = 1;
+        end_tag = 1;
     }
     else
     {
@@ -737,84 +1309,139 @@ static void musvg_parse_element(char* s,
     }
 
     // Skip comments, data and preprocessor stuff.
-    if (!*s || *s == '?' || *s == '!')
+    if (s == end || *s == '?' || *s == '!')
         return;
 
     // Get tag name
-    name = s;
-    while (*s && !musvg_isspace(*s)) s++;
-    if (*s) { *s++ = '\0'; }
+    name.data = s;
+    while (s < end && !musvg_isspace(*s)) s++;
+    name.size = s - name.data;
+    if (s < end) s++;
 
     // Get attribs
-    while (!end && *s && nattr < MAX_ATTRIBS-1)
+    while (!end_tag && s < end && nattr < MAX_ATTRIBS-1)
     {
         // Skip white space before the attrib name
-        while (*s && musvg_isspace(*s)) s++;
-        if (!*s) break;
+        while (s < end && musvg_isspace(*s)) s++;
+        if (s == end) break;
         if (*s == '/')
         {
-            end = 1;
+            end_tag = 1;
             break;
         }
-        attr[nattr++] = s;
+        attr[nattr].data = s;
         // Find end of the attrib name.
-        while (*s && !musvg_isspace(*s) && *s != '=') s++;
-        if (*s) { *s++ = '\0'; }
+        while (s < end && !musvg_isspace(*s) && *s != '=') s++;
+        attr[nattr].size = s - attr[nattr].data;
+        if (s < end) s++;
         // Skip until the beginning of the value.
-        while (*s && *s != '\"') s++;
-        if (!*s) break;
+        s = musvg_xml_find(s, end, '\"');
+        if (s == end) break;
         s++;
         // Store value and find the end of it.
-        attr[nattr++] = s;
-        while (*s && *s != '\"') s++;
-        if (*s) { *s++ = '\0'; }
+        attr[nattr + 1].data = s;
+        s = musvg_xml_find(s, end, '\"');
+        attr[nattr + 1].size = s - attr[nattr + 1].data;
+        nattr += 2;
+        if (s < end) s++;
     }
 
-    // List terminator
-    attr[nattr++] = 0;
-    attr[nattr++] = 0;
-
     // Call callbacks.
     if (start && startel_cb) {
-        (*startel_cb)(ud, name, attr);
+        (*startel_cb)(ud, name, attr, nattr);
     }
-    if (end && endel_cb) {
+    if (end_tag && endel_cb) {
         (*endel_cb)(ud, name);
     }
 }
 
-static int musvg_parse_xml(char* input,
-             void (*startel_cb)(void* ud, const char* el, const char** attr),
-             void (*endel_cb)(void* ud, const char* el),
-             void (*content_cb)(void* ud, const char* s),
+/* tokenizes from blk to end and returns the start of the unfinished token */
+static const char* musvg_parse_xml_block(const char* blk, const char* end,
+             const char* mark, int* state,
+             void (*startel_cb)(void* ud, musvg_slice el, const musvg_slice* attr, size_t nattr),
+             void (*endel_cb)(void* ud, musvg_slice el),
+             void (*content_cb)(void* ud, musvg_slice s),
              void* ud)
 {
-    char* s = input;
-    char* mark = s;
-    int state = CONTENT;
-    while (*s)
+    /*
+     * '<' is only structural in content and '>' is only structural in a
+     * tag, so both are classified together and the state machine skips
+     * bits for the character that is not significant in the current state.
+     */
+    for (; blk < end; blk += musvg_xml_block_size)
     {
-        if (*s == '<' && state == CONTENT)
-        {
-            // Start of a tag
-            *s++ = '\0';
-            musvg_parse_content(mark, content_cb, ud);
-            mark = s;
-            state = TAG;
-        }
-        else if (*s == '>' && state == TAG)
+        uint mask = musvg_xml_block_mask(blk, end, '<', '>');
+        while (mask)
         {
-            // Start of a content or new tag.
-            *s++ = '\0';
-            musvg_parse_element(mark, startel_cb, endel_cb, ud);
-            mark = s;
-            state = CONTENT;
-        }
-        else {
-            s++;
+            const char* s = blk + ctz(mask);
+            mask &= mask - 1;
+            if (*s == '<' && *state == CONTENT)
+            {
+                // Start of a tag
+                musvg_parse_content(mark, s, content_cb, ud);
+                mark = s + 1;
+                *state = TAG;
+            }
+            else if (*s == '>' && *state == TAG)
+            {
+                // Start of a content or new tag.
+                musvg_parse_element(mark, s, startel_cb, endel_cb, ud);
+                mark = s + 1;
+                *state = CONTENT;
+            }
         }
     }
 
+    return mark;
+}
+
+static int musvg_parse_xml(const char* input, size_t length,
+             void (*startel_cb)(void* ud, musvg_slice el, const musvg_slice* attr, size_t nattr),
+             void (*endel_cb)(void* ud, musvg_slice el),
+             void (*content_cb)(void* ud, musvg_slice s),
+             void* ud)
+{
+    int state = CONTENT;
+
+    musvg_parse_xml_block(input, input + length, input, &state,
+                          startel_cb, endel_cb, content_cb, ud);
+
+    return 0;
+}
+
+/*
+ * streaming XML ingest
+ *
+ * input is tokenized as it is read from a buffer with a sync callback.
+ * the unfinished tag or content at the end of each read is moved to the
+ * front of the buffer before it is refilled, so the input side needs no
+ * more than the buffer unless one tag is larger, when the buffer grows.
+ */
+static int musvg_parse_xml_stream(mu_buf* buf,
+             void (*startel_cb)(void* ud, musvg_slice el, const musvg_slice* attr, size_t nattr),
+             void (*endel_cb)(void* ud, musvg_slice el),
+             void (*content_cb)(void* ud, musvg_slice s),
+             void* ud)
+{
+    int state = CONTENT;
+    size_t scan = buf->read_marker;
+
+    for (;;) {
+        const char* mark = musvg_parse_xml_block(buf->data + scan,
+            buf->data + buf->write_marker, buf->data + buf->read_marker,
+            &state, startel_cb, endel_cb, content_cb, ud);
+        size_t pending = buf->data + buf->write_marker - mark;
+
+        memmove(buf->data, mark, pending);
+        buf->read_marker = 0;
+        buf->write_marker = scan = pending;
+        if (pending == buf->buffer_size &&
+            mu_buf_resize(buf, buf->buffer_size * 2) < 0) return -musvg_error_invalid;
+        if (buf->sync(buf) < 0) return -musvg_error_io;
+        if (buf->write_marker == pending) break;
+    }
+    buf->read_marker = buf->write_marker;
+
     return 0;
 }
 
@@ -1039,396 +1666,993 @@ musvg_named_color musvg_colors[] =
     { MSVG_RGB(154, 205, 50 ), "yellowgreen" },
 };
 
-static inline musvg_color musvg_color_rgb(uint r, uint g, uint b)
+/*
+ * rgba colors hold the red, green and blue channels in the low 24 bits
+ * and 255 minus alpha in bits 24 to 31, so opaque colors are unchanged
+ * from colors without an alpha channel.
+ */
+
+static inline musvg_color musvg_color_rgba(uint r, uint g, uint b, uint a)
 {
     musvg_color color = {
-        musvg_color_type_rgba, ((r << 16) | (g << 8) | (b << 0))
+        musvg_color_type_rgba, (((255 - a) << 24) | (r << 16) | (g << 8) | (b << 0))
     };
     return color;
 }
 
+static inline musvg_color musvg_color_rgb(uint r, uint g, uint b)
+{
+    return musvg_color_rgba(r, g, b, 255);
+}
+
 static inline musvg_color musvg_color_none()
 {
     musvg_color color = { musvg_color_type_none, 0 };
     return color;
 }
 
-static musvg_color musvg_parse_color_name(const char* str)
+static inline int musvg_startswith(const char* s, const char* end, const char* lit)
 {
-    int i, ncolors = sizeof(musvg_colors) / sizeof(musvg_named_color);
+    size_t len = strlen(lit);
+    return (size_t)(end - s) >= len && memcmp(s, lit, len) == 0;
+}
 
-    for (i = 0; i < ncolors; i++) {
-        if (strcmp(musvg_colors[i].name, str) == 0) {
-            musvg_color color = {
-                musvg_color_type_rgba, musvg_colors[i].color
-            };
-            return color;
-        }
+static inline int musvg_contains(const char* s, size_t len, const char* lit)
+{
+    size_t n = strlen(lit);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(s + i, lit, n) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+ * color keywords are resolved with a perfect hash like element names,
+ * using a key that adds the second to last character to tell apart
+ * names such as darkgray and darkgrey. the names are at least three
+ * characters long.
+ */
+static inline ullong musvg_color_key(const char* s, size_t len)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    return (ullong)u[0] | (ullong)u[1] << 8 | (ullong)u[len >> 1] << 16 |
+           (ullong)u[len - 2] << 24 | (ullong)u[len - 1] << 32 | (ullong)len << 40;
+}
+
+static int musvg_color_lookup(const char* str, size_t len)
+{
+    if (len < 3) return -1;
+    size_t slot = (size_t)((musvg_color_key(str, len) * musvg_color_seed) >> (64 - musvg_color_bits));
+    int idx = musvg_color_slots[slot];
+    return musvg_strneq(str, len, musvg_colors[idx].name) ? idx : -1;
+}
+
+static musvg_color musvg_parse_color_name(const char* str, size_t len)
+{
+    while (len > 0 && musvg_isspace(str[len - 1])) len--;
+
+    int idx = musvg_color_lookup(str, len);
+    if (idx >= 0) {
+        musvg_color color = {
+            musvg_color_type_rgba, musvg_colors[idx].color
+        };
+        return color;
     }
 
     return musvg_color_rgb(128, 128, 128);
 }
 
-static musvg_color musvg_parse_color_hex(const char* str)
+static inline int musvg_hex_digit(char c)
 {
-    unsigned int c = 0, r = 0, g = 0, b = 0;
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* parses #rgb, #rgba, #rrggbb and #rrggbbaa. invalid colors are black */
+static musvg_color musvg_parse_color_hex(const char* str, const char* end)
+{
+    uint c = 0;
     int n = 0;
     str++; // skip #
     // Calculate number of characters.
-    while(str[n] && !musvg_isspace(str[n]))
+    while(str + n < end && !musvg_isspace(str[n]))
         n++;
-    if (n == 6) {
-        sscanf(str, "%x", &c);
-    } else if (n == 3) {
-        sscanf(str, "%x", &c);
-        c = (c&0xf) | ((c&0xf0) << 4) | ((c&0xf00) << 8);
-        c |= c<<4;
-    }
-    r = (c >> 16) & 0xff;
-    g = (c >> 8) & 0xff;
-    b = c & 0xff;
-    return musvg_color_rgb(r,g,b);
-}
-
-static musvg_color musvg_parse_color_rgb(const char* str)
-{
-    int r = -1, g = -1, b = -1;
-    char s1[32]="", s2[32]="";
-    sscanf(str + 4, "%d%[%%, \t]%d%[%%, \t]%d", &r, s1, &g, s2, &b);
-    if (strchr(s1, '%')) {
-        return musvg_color_rgb((r*255)/100,(g*255)/100,(b*255)/100);
+    if (n != 3 && n != 4 && n != 6 && n != 8)
+        return musvg_color_rgb(0, 0, 0);
+    for (int i = 0; i < n; i++) {
+        int d = musvg_hex_digit(str[i]);
+        if (d < 0) return musvg_color_rgb(0, 0, 0);
+        c = (c << 4) | d;
+    }
+    if (n == 3 || n == 6) {
+        c = (c << (n == 3 ? 4 : 8)) | (n == 3 ? 0xf : 0xff);
+    }
+    if (n <= 4) {
+        /* expand each digit of #rgba to two digits */
+        c = (c & 0xf) | ((c & 0xf0) << 4) | ((c & 0xf00) << 8) | ((c & 0xf000) << 12);
+        c |= c << 4;
+    }
+    return musvg_color_rgba((c >> 24) & 0xff, (c >> 16) & 0xff, (c >> 8) & 0xff, c & 0xff);
+}
+
+static const char* musvg_scan_float(const char* s, const char* end, float* value);
+
+/* scans a number or a percentage scaled to 0 to 255 */
+static const char* musvg_parse_color_channel(const char* s, const char* end,
+    float scale, uint *channel)
+{
+    float v = 0.0f;
+    while (s < end && (musvg_isspace(*s) || *s == ',' || *s == '/')) s++;
+    s = musvg_scan_float(s, end, &v);
+    if (s < end && *s == '%') {
+        v = v * 255.0f / 100.0f;
+        s++;
     } else {
-        return musvg_color_rgb(r,g,b);
+        v = v * scale;
+    }
+    *channel = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint)(v + 0.5f);
+    return s;
+}
+
+/* parses rgb(r,g,b) and rgba(r,g,b,a) with numbers or percentages */
+static musvg_color musvg_parse_color_rgb(const char* str, const char* end)
+{
+    uint r, g, b, a = 255;
+    str += str[3] == 'a' ? 5 : 4;
+    str = musvg_parse_color_channel(str, end, 1.0f, &r);
+    str = musvg_parse_color_channel(str, end, 1.0f, &g);
+    str = musvg_parse_color_channel(str, end, 1.0f, &b);
+    while (str < end && musvg_isspace(*str)) str++;
+    if (str < end && *str != ')') {
+        musvg_parse_color_channel(str, end, 255.0f, &a);
     }
+    return musvg_color_rgba(r, g, b, a);
 }
 
 static musvg_index alloc_string(musvg_parser *p, const char *str, size_t len);
 
-static musvg_index musvg_parse_url(musvg_parser *p, const char* str)
+static musvg_index musvg_parse_url(musvg_parser *p, const char* str, const char* end)
 {
-    char buf[128];
-    int len = 0;
+    const char* url;
     str += 4; // "url(";
-    if (*str == '#')
+    if (str < end && *str == '#')
         str++;
-    while (len < (sizeof(buf)-1) && *str != ')') {
-        buf[len++] = *str++;
-    }
-    buf[len] = '\0';
-    return alloc_string(p, buf, len);
+    url = str;
+    while (str < end && str - url < 127 && *str != ')') str++;
+    return alloc_string(p, url, str - url);
 }
 
-static musvg_color musvg_parse_color_url(musvg_parser *p, const char* str)
+static musvg_color musvg_parse_color_url(musvg_parser *p, const char* str, const char* end)
 {
-    musvg_color col = { musvg_color_type_url, musvg_parse_url(p, str) };
+    musvg_color col = { musvg_color_type_url, musvg_parse_url(p, str, end) };
     return col;
 }
 
-static musvg_color musvg_parse_color(musvg_parser *p, const char* str)
+static musvg_color musvg_parse_color(musvg_parser *p, const char* str, const char* end)
 {
     size_t len = 0;
-    while(*str == ' ') ++str;
-    len = strlen(str);
-    if (strcmp(str, "none") == 0)
+    while(str < end && *str == ' ') ++str;
+    len = end - str;
+    if (musvg_strneq(str, len, "none"))
         return musvg_color_none();
-    else if (strncmp(str, "url(", 4) == 0)
-        return musvg_parse_color_url(p, str);
+    else if (musvg_startswith(str, end, "url("))
+        return musvg_parse_color_url(p, str, end);
     else if (len >= 1 && *str == '#')
-        return musvg_parse_color_hex(str);
-    else if (len >= 4 && str[0] == 'r' && str[1] == 'g' && str[2] == 'b' && str[3] == '(')
-        return musvg_parse_color_rgb(str);
-    return musvg_parse_color_name(str);
+        return musvg_parse_color_hex(str, end);
+    else if (musvg_startswith(str, end, "rgb(") || musvg_startswith(str, end, "rgba("))
+        return musvg_parse_color_rgb(str, end);
+    return musvg_parse_color_name(str, len);
 }
 
 // SVG number parsing
 
-// We roll our own string to float because the std library one uses locale and messes things up.
-static double musvg_atof(const char* s)
-{
-    char* cur = (char*)s;
-    char* end = NULL;
-    double res = 0.0, sign = 1.0;
-    long long intPart = 0, fracPart = 0;
-    char hasIntPart = 0, hasFracPart = 0;
-
-    // Parse optional sign
-    if (*cur == '+') {
-        cur++;
-    } else if (*cur == '-') {
-        sign = -1;
-        cur++;
-    }
-
-    // Parse integer part
-    if (musvg_isdigit(*cur)) {
-        // Parse digit sequence
-        intPart = strtoll(cur, &end, 10);
-        if (cur != end) {
-            res = (double)intPart;
-            hasIntPart = 1;
-            cur = end;
-        }
-    }
-
-    // Parse fractional part.
-    if (*cur == '.') {
-        cur++; // Skip '.'
-        if (musvg_isdigit(*cur)) {
-            // Parse digit sequence
-            fracPart = strtoll(cur, &end, 10);
-            if (cur != end) {
-                res += (double)fracPart / pow(10.0, (double)(end - cur));
-                hasFracPart = 1;
-                cur = end;
-            }
-        }
-    }
+/*
+ * decimal to binary32 conversion
+ *
+ * we roll our own string to float because the std library one uses
+ * locale and messes things up. numbers are scanned into a decimal
+ * significand w of up to 19 digits and a power of ten q. when w fits
+ * in 24 bits and |q| <= 10 both operands are exact floats so a single
+ * multiply or divide is correctly rounded. otherwise the Eisel-Lemire
+ * algorithm multiplies w by a 128-bit approximation of 5^q and rounds
+ * the top bits to nearest even. if more than 19 digits were present,
+ * w+1 is also converted and if the results differ the number falls
+ * back to strtof on a copy using the locale decimal point.
+ */
 
-    // A valid number should have integer or fractional part.
-    if (!hasIntPart && !hasFracPart)
-        return 0.0;
+/* generated by scripts/gen_pow5_table.py */
+static const ullong musvg_pow5_128[][2] = {
+    { 0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull }, /* 5^-64 */
+    { 0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull }, /* 5^-63 */
+    { 0x83a3eeeef9153e89ull, 0x1953cf68300424acull }, /* 5^-62 */
+    { 0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull }, /* 5^-61 */
+    { 0xcdb02555653131b6ull, 0x3792f412cb06794dull }, /* 5^-60 */
+    { 0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull }, /* 5^-59 */
+    { 0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull }, /* 5^-58 */
+    { 0xc8de047564d20a8bull, 0xf245825a5a445275ull }, /* 5^-57 */
+    { 0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull }, /* 5^-56 */
+    { 0x9ced737bb6c4183dull, 0x55464dd69685606bull }, /* 5^-55 */
+    { 0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull }, /* 5^-54 */
+    { 0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull }, /* 5^-53 */
+    { 0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull }, /* 5^-52 */
+    { 0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull }, /* 5^-51 */
+    { 0xef73d256a5c0f77cull, 0x963e66858f6d4440ull }, /* 5^-50 */
+    { 0x95a8637627989aadull, 0xdde7001379a44aa8ull }, /* 5^-49 */
+    { 0xbb127c53b17ec159ull, 0x5560c018580d5d52ull }, /* 5^-48 */
+    { 0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull }, /* 5^-47 */
+    { 0x9226712162ab070dull, 0xcab3961304ca70e8ull }, /* 5^-46 */
+    { 0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull }, /* 5^-45 */
+    { 0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull }, /* 5^-44 */
+    { 0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull }, /* 5^-43 */
+    { 0xb267ed1940f1c61cull, 0x55f038b237591ed3ull }, /* 5^-42 */
+    { 0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull }, /* 5^-41 */
+    { 0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull }, /* 5^-40 */
+    { 0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull }, /* 5^-39 */
+    { 0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull }, /* 5^-38 */
+    { 0x881cea14545c7575ull, 0x7e50d64177da2e54ull }, /* 5^-37 */
+    { 0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull }, /* 5^-36 */
+    { 0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull }, /* 5^-35 */
+    { 0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull }, /* 5^-34 */
+    { 0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull }, /* 5^-33 */
+    { 0xcfb11ead453994baull, 0x67de18eda5814af2ull }, /* 5^-32 */
+    { 0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull }, /* 5^-31 */
+    { 0xa2425ff75e14fc31ull, 0xa1258379a94d028dull }, /* 5^-30 */
+    { 0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull }, /* 5^-29 */
+    { 0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull }, /* 5^-28 */
+    { 0x9e74d1b791e07e48ull, 0x775ea264cf55347eull }, /* 5^-27 */
+    { 0xc612062576589ddaull, 0x95364afe032a819eull }, /* 5^-26 */
+    { 0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull }, /* 5^-25 */
+    { 0x9abe14cd44753b52ull, 0xc4926a9672793543ull }, /* 5^-24 */
+    { 0xc16d9a0095928a27ull, 0x75b7053c0f178294ull }, /* 5^-23 */
+    { 0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull }, /* 5^-22 */
+    { 0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull }, /* 5^-21 */
+    { 0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull }, /* 5^-20 */
+    { 0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull }, /* 5^-19 */
+    { 0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull }, /* 5^-18 */
+    { 0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull }, /* 5^-17 */
+    { 0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull }, /* 5^-16 */
+    { 0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull }, /* 5^-15 */
+    { 0xb424dc35095cd80full, 0x538484c19ef38c95ull }, /* 5^-14 */
+    { 0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull }, /* 5^-13 */
+    { 0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull }, /* 5^-12 */
+    { 0xafebff0bcb24aafeull, 0xf78f69a51539d749ull }, /* 5^-11 */
+    { 0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull }, /* 5^-10 */
+    { 0x89705f4136b4a597ull, 0x31680a88f8953031ull }, /* 5^-9 */
+    { 0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull }, /* 5^-8 */
+    { 0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull }, /* 5^-7 */
+    { 0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull }, /* 5^-6 */
+    { 0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull }, /* 5^-5 */
+    { 0xd1b71758e219652bull, 0xd3c36113404ea4a9ull }, /* 5^-4 */
+    { 0x83126e978d4fdf3bull, 0x645a1cac083126eaull }, /* 5^-3 */
+    { 0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull }, /* 5^-2 */
+    { 0xccccccccccccccccull, 0xcccccccccccccccdull }, /* 5^-1 */
+    { 0x8000000000000000ull, 0x0000000000000000ull }, /* 5^0 */
+    { 0xa000000000000000ull, 0x0000000000000000ull }, /* 5^1 */
+    { 0xc800000000000000ull, 0x0000000000000000ull }, /* 5^2 */
+    { 0xfa00000000000000ull, 0x0000000000000000ull }, /* 5^3 */
+    { 0x9c40000000000000ull, 0x0000000000000000ull }, /* 5^4 */
+    { 0xc350000000000000ull, 0x0000000000000000ull }, /* 5^5 */
+    { 0xf424000000000000ull, 0x0000000000000000ull }, /* 5^6 */
+    { 0x9896800000000000ull, 0x0000000000000000ull }, /* 5^7 */
+    { 0xbebc200000000000ull, 0x0000000000000000ull }, /* 5^8 */
+    { 0xee6b280000000000ull, 0x0000000000000000ull }, /* 5^9 */
+    { 0x9502f90000000000ull, 0x0000000000000000ull }, /* 5^10 */
+    { 0xba43b74000000000ull, 0x0000000000000000ull }, /* 5^11 */
+    { 0xe8d4a51000000000ull, 0x0000000000000000ull }, /* 5^12 */
+    { 0x9184e72a00000000ull, 0x0000000000000000ull }, /* 5^13 */
+    { 0xb5e620f480000000ull, 0x0000000000000000ull }, /* 5^14 */
+    { 0xe35fa931a0000000ull, 0x0000000000000000ull }, /* 5^15 */
+    { 0x8e1bc9bf04000000ull, 0x0000000000000000ull }, /* 5^16 */
+    { 0xb1a2bc2ec5000000ull, 0x0000000000000000ull }, /* 5^17 */
+    { 0xde0b6b3a76400000ull, 0x0000000000000000ull }, /* 5^18 */
+    { 0x8ac7230489e80000ull, 0x0000000000000000ull }, /* 5^19 */
+    { 0xad78ebc5ac620000ull, 0x0000000000000000ull }, /* 5^20 */
+    { 0xd8d726b7177a8000ull, 0x0000000000000000ull }, /* 5^21 */
+    { 0x878678326eac9000ull, 0x0000000000000000ull }, /* 5^22 */
+    { 0xa968163f0a57b400ull, 0x0000000000000000ull }, /* 5^23 */
+    { 0xd3c21bcecceda100ull, 0x0000000000000000ull }, /* 5^24 */
+    { 0x84595161401484a0ull, 0x0000000000000000ull }, /* 5^25 */
+    { 0xa56fa5b99019a5c8ull, 0x0000000000000000ull }, /* 5^26 */
+    { 0xcecb8f27f4200f3aull, 0x0000000000000000ull }, /* 5^27 */
+    { 0x813f3978f8940984ull, 0x4000000000000000ull }, /* 5^28 */
+    { 0xa18f07d736b90be5ull, 0x5000000000000000ull }, /* 5^29 */
+    { 0xc9f2c9cd04674edeull, 0xa400000000000000ull }, /* 5^30 */
+    { 0xfc6f7c4045812296ull, 0x4d00000000000000ull }, /* 5^31 */
+    { 0x9dc5ada82b70b59dull, 0xf020000000000000ull }, /* 5^32 */
+    { 0xc5371912364ce305ull, 0x6c28000000000000ull }, /* 5^33 */
+    { 0xf684df56c3e01bc6ull, 0xc732000000000000ull }, /* 5^34 */
+    { 0x9a130b963a6c115cull, 0x3c7f400000000000ull }, /* 5^35 */
+    { 0xc097ce7bc90715b3ull, 0x4b9f100000000000ull }, /* 5^36 */
+    { 0xf0bdc21abb48db20ull, 0x1e86d40000000000ull }, /* 5^37 */
+    { 0x96769950b50d88f4ull, 0x1314448000000000ull }, /* 5^38 */
+};
 
-    // Parse optional exponent
-    if (*cur == 'e' || *cur == 'E') {
-        long expPart = 0;
-        cur++; // skip 'E'
-        expPart = strtol(cur, &end, 10); // Parse digit sequence with sign
-        if (cur != end) {
-            res *= pow(10.0, (double)expPart);
-        }
-    }
+enum {
+    musvg_f32_mantissa_bits = 23,
+    musvg_f32_min_exponent = -127,
+    musvg_f32_infinite_power = 0xff,
+    musvg_f32_min_pow10 = -64,
+    musvg_f32_max_pow10 = 38,
+    musvg_f32_min_round_even = -17,
+    musvg_f32_max_round_even = 10,
+    musvg_f32_max_digits = 19,
+};
+
+static const float musvg_pow10_f32[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
 
-    return res * sign;
+static inline ullong musvg_mul_u64(ullong a, ullong b, ullong *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *lo = (ullong)r;
+    return (ullong)(r >> 64);
+#else
+    ullong a0 = (uint)a, a1 = a >> 32, b0 = (uint)b, b1 = b >> 32;
+    ullong p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    ullong mid = (p00 >> 32) + (uint)p01 + (uint)p10;
+    *lo = (mid << 32) | (uint)p00;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
 }
 
-static const char* musvg_parse_number(const char* s, char* it, const int size)
+/* returns the binary32 bit pattern closest to w * 10^q without sign */
+static uint musvg_eisel_lemire_f32(ullong w, int q)
 {
-    const int last = size-1;
-    int i = 0;
+    ullong hi, lo, hi2, lo2, mantissa;
+    int lz, upperbit, shift, power2;
 
-    // sign
-    if (*s == '-' || *s == '+') {
-        if (i < last) it[i++] = *s;
-        s++;
+    if (w == 0 || q < musvg_f32_min_pow10) return 0;
+    if (q > musvg_f32_max_pow10) return (uint)musvg_f32_infinite_power << musvg_f32_mantissa_bits;
+
+    lz = (int)clz(w);
+    w <<= lz;
+
+    /* the low product is only needed when the high product is close
+     * to a rounding boundary at the precision we are interested in. */
+    const ullong *pow5 = musvg_pow5_128[q - musvg_f32_min_pow10];
+    const ullong mask = ~0ull >> (musvg_f32_mantissa_bits + 3);
+    hi = musvg_mul_u64(w, pow5[0], &lo);
+    if ((hi & mask) == mask) {
+        hi2 = musvg_mul_u64(w, pow5[1], &lo2);
+        lo += hi2;
+        if (hi2 > lo) hi++;
     }
-    // integer part
-    while (*s && musvg_isdigit(*s)) {
-        if (i < last) it[i++] = *s;
-        s++;
+
+    upperbit = (int)(hi >> 63);
+    shift = upperbit + 64 - musvg_f32_mantissa_bits - 3;
+    mantissa = hi >> shift;
+    /* floor(log2(10^q)) = floor(q * log2(10)) for |q| < 1500 */
+    power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz - musvg_f32_min_exponent;
+
+    if (power2 <= 0) {
+        /* subnormal */
+        if (-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = mantissa < (1ull << musvg_f32_mantissa_bits) ? 0 : 1;
+        return (uint)mantissa | (uint)power2 << musvg_f32_mantissa_bits;
     }
-    if (*s == '.') {
-        // decimal point
-        if (i < last) it[i++] = *s;
-        s++;
-        // fraction part
-        while (*s && musvg_isdigit(*s)) {
-            if (i < last) it[i++] = *s;
-            s++;
-        }
+
+    /* the product is exact for small powers so an exact halfway
+     * value must round to even rather than up. */
+    if (lo <= 1 && q >= musvg_f32_min_round_even && q <= musvg_f32_max_round_even &&
+        (mantissa & 3) == 1 && (mantissa << shift) == hi) {
+        mantissa &= ~1ull;
     }
-    // exponent
-    if ((*s == 'e' || *s == 'E') && (s[1] != 'm' && s[1] != 'x')) {
-        if (i < last) it[i++] = *s;
-        s++;
-        if (*s == '-' || *s == '+') {
-            if (i < last) it[i++] = *s;
-            s++;
-        }
-        while (*s && musvg_isdigit(*s)) {
-            if (i < last) it[i++] = *s;
-            s++;
-        }
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (2ull << musvg_f32_mantissa_bits)) {
+        mantissa = (1ull << musvg_f32_mantissa_bits);
+        power2++;
     }
-    it[i] = '\0';
-
-    return s;
+    mantissa &= ~(1ull << musvg_f32_mantissa_bits);
+    if (power2 >= musvg_f32_infinite_power) {
+        return (uint)musvg_f32_infinite_power << musvg_f32_mantissa_bits;
+    }
+    return (uint)mantissa | (uint)power2 << musvg_f32_mantissa_bits;
 }
 
-static const char* musvg_get_next_path_item(const char* s, char* it)
+static float musvg_strtof_slow(const char* s, size_t len)
 {
-    it[0] = '\0';
-    // Skip white spaces and commas
-    while (*s && (musvg_isspace(*s) || *s == ',')) s++;
-    if (!*s) return s;
-    if (*s == '-' || *s == '+' || *s == '.' || musvg_isdigit(*s)) {
-        s = musvg_parse_number(s, it, 64);
-    } else {
-        // Parse command
-        it[0] = *s++;
-        it[1] = '\0';
-        return s;
+    char buf[128], *tmp = len < sizeof(buf) ? buf : (char*)malloc(len + 1);
+    const char point = localeconv()->decimal_point[0];
+    for (size_t i = 0; i < len; i++) {
+        tmp[i] = s[i] == '.' ? point : s[i];
     }
-
-    return s;
+    tmp[len] = '\0';
+    float f = strtof(tmp, NULL);
+    if (tmp != buf) free(tmp);
+    return f;
 }
 
-static float musvg_parse_opacity(const char* str)
+/*
+ * scan a number with optional sign, fraction and exponent. returns a
+ * pointer to the character after the number, or s if there are no
+ * digits. an 'e' followed by 'm' or 'x' is a unit, not an exponent.
+ */
+static const char* musvg_scan_float(const char* s, const char* end, float* value)
 {
-    float val = (float)musvg_atof(str);
-    if (val < 0.0f) val = 0.0f;
-    if (val > 1.0f) val = 1.0f;
-    return val;
+    const char* p = s;
+    ullong w = 0;
+    int neg = 0, ndigits = 0, nsig = 0, q = 0, truncated = 0;
+    uint bits;
+    float f;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p++ == '-';
+    }
+    // integer part
+    while (p < end && musvg_isdigit(*p)) {
+        uint d = *p++ - '0';
+        ndigits++;
+        if (nsig < musvg_f32_max_digits) {
+            w = w * 10 + d;
+            nsig += w != 0;
+        } else {
+            truncated |= d != 0;
+            q++;
+        }
+    }
+    // fraction part
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && musvg_isdigit(*p)) {
+            uint d = *p++ - '0';
+            ndigits++;
+            if (nsig < musvg_f32_max_digits) {
+                w = w * 10 + d;
+                nsig += w != 0;
+                q--;
+            } else {
+                truncated |= d != 0;
+            }
+        }
+    }
+    // a valid number should have integer or fractional part.
+    if (ndigits == 0) {
+        *value = 0.0f;
+        return s;
+    }
+    // exponent
+    if (p < end && (*p == 'e' || *p == 'E') &&
+        (p + 1 == end || (p[1] != 'm' && p[1] != 'x'))) {
+        const char* e = p + 1;
+        int eneg = 0, exp = 0;
+        if (e < end && (*e == '-' || *e == '+')) {
+            eneg = *e++ == '-';
+        }
+        if (e < end && musvg_isdigit(*e)) {
+            while (e < end && musvg_isdigit(*e)) {
+                if (exp < 100000) exp = exp * 10 + (*e - '0');
+                e++;
+            }
+            q += eneg ? -exp : exp;
+            p = e;
+        }
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && w <= (1ull << 24) && q >= -10 && q <= 10) {
+        f = q < 0 ? (float)w / musvg_pow10_f32[-q] : (float)w * musvg_pow10_f32[q];
+        *value = neg ? -f : f;
+        return p;
+    }
+#endif
+
+    bits = musvg_eisel_lemire_f32(w, q);
+    if (truncated && bits != musvg_eisel_lemire_f32(w + 1, q)) {
+        *value = musvg_strtof_slow(s, p - s);
+        return p;
+    }
+    bits |= (uint)neg << 31;
+    memcpy(&f, &bits, sizeof(f));
+    *value = f;
+    return p;
 }
 
-static float musvg_parse_miterlimit(const char* str)
+/*
+ * scan a run of up to count numbers separated by white space and
+ * commas into a float array. stops at the first character that does
+ * not start a number and returns the number of values scanned.
+ */
+static size_t musvg_scan_floats(const char* s, const char* end, float* out,
+    size_t count, const char** next)
+{
+    size_t n = 0;
+    while (n < count) {
+        while (s < end && (musvg_isspace(*s) || *s == ',')) s++;
+        const char* e = musvg_scan_float(s, end, out + n);
+        if (e == s) break;
+        s = e;
+        n++;
+    }
+    if (next) *next = s;
+    return n;
+}
+
+static float musvg_parse_float(const char* str, const char* end)
 {
-    float val = (float)musvg_atof(str);
-    if (val < 0.0f) val = 0.0f;
-    return val;
+    float value;
+    while (str < end && *str == ' ') ++str;
+    musvg_scan_float(str, end, &value);
+    return value;
 }
 
-static float musvg_parse_float(const char* str)
+static float musvg_parse_opacity(const char* str, const char* end)
 {
-    while (*str == ' ') ++str;
-    return (float)musvg_atof(str);
+    float val = musvg_parse_float(str, end);
+    if (val < 0.0f) val = 0.0f;
+    if (val > 1.0f) val = 1.0f;
+    return val;
 }
 
-static int musvg_is_length(const char* s)
+static float musvg_parse_miterlimit(const char* str, const char* end)
 {
-    // optional sign
-    if (*s == '-' || *s == '+')
-        s++;
-    // must have at least one digit, or start by a dot
-    return (musvg_isdigit(*s) || *s == '.');
+    float val = musvg_parse_float(str, end);
+    if (val < 0.0f) val = 0.0f;
+    return val;
 }
 
-musvg_small musvg_parse_units(const char* units);
+musvg_small musvg_parse_units(const char* units, size_t len);
 
-static musvg_length musvg_parse_length(const char* str)
+static musvg_length musvg_parse_length(const char* str, const char* end)
 {
-    char buf[64];
     musvg_length length = { 0, musvg_unit_user };
-    length.units = musvg_parse_units(musvg_parse_number(str, buf, 64));
-    length.value = (float)musvg_atof(buf);
+    const char* units = musvg_scan_float(str, end, &length.value);
+    length.units = musvg_parse_units(units, end - units);
     return length;
 }
 
-static musvg_viewbox musvg_parse_viewbox(const char* s)
+static musvg_viewbox musvg_parse_viewbox(const char* s, const char* end)
 {
     musvg_viewbox viewbox = { 0, 0, 0, 0 };
-    char buf[64];
-    s = musvg_parse_number(s, buf, 64);
-    viewbox.x = (float)musvg_atof(buf);
-    while (*s && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
-    if (!*s) goto out;
-    s = musvg_parse_number(s, buf, 64);
-    viewbox.y = (float)musvg_atof(buf);
-    while (*s && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
-    if (!*s) goto out;
-    s = musvg_parse_number(s, buf, 64);
-    viewbox.width = (float)musvg_atof(buf);
-    while (*s && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
-    if (!*s) goto out;
-    s = musvg_parse_number(s, buf, 64);
-    viewbox.height = (float)musvg_atof(buf);
+    s = musvg_scan_float(s, end, &viewbox.x);
+    while (s < end && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
+    if (s == end) goto out;
+    s = musvg_scan_float(s, end, &viewbox.y);
+    while (s < end && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
+    if (s == end) goto out;
+    s = musvg_scan_float(s, end, &viewbox.width);
+    while (s < end && (musvg_isspace(*s) || *s == '%' || *s == ',')) s++;
+    if (s == end) goto out;
+    s = musvg_scan_float(s, end, &viewbox.height);
 out:
     return viewbox;
 }
 
+// SVG number formatting
+
+/*
+ * binary32 to shortest decimal conversion
+ *
+ * floats are written with the fewest significant digits that convert
+ * back to the same binary32 value, using the Ryu algorithm by Ulf Adams.
+ * the decimal interval of values that round to the float is computed
+ * with 64-bit multiplies by a power of five approximation and digits are
+ * removed while both ends of the interval still differ. the result is
+ * laid out like %g, switching to an exponent outside [1e-5, 1e9).
+ */
+
+/* generated by scripts/gen_f2s_table.py */
+static const ullong musvg_f2s_pow5_inv_split[31] = {
+    0x0800000000000001ull, /* 5^-0 */
+    0x0666666666666667ull, /* 5^-1 */
+    0x051eb851eb851eb9ull, /* 5^-2 */
+    0x04189374bc6a7efaull, /* 5^-3 */
+    0x068db8bac710cb2aull, /* 5^-4 */
+    0x053e2d6238da3c22ull, /* 5^-5 */
+    0x0431bde82d7b634eull, /* 5^-6 */
+    0x06b5fca6af2bd216ull, /* 5^-7 */
+    0x055e63b88c230e78ull, /* 5^-8 */
+    0x044b82fa09b5a52dull, /* 5^-9 */
+    0x06df37f675ef6eaeull, /* 5^-10 */
+    0x057f5ff85e592558ull, /* 5^-11 */
+    0x0465e6604b7a8447ull, /* 5^-12 */
+    0x0709709a125da071ull, /* 5^-13 */
+    0x05a126e1a84ae6c1ull, /* 5^-14 */
+    0x0480ebe7b9d58567ull, /* 5^-15 */
+    0x0734aca5f6226f0bull, /* 5^-16 */
+    0x05c3bd5191b525a3ull, /* 5^-17 */
+    0x049c97747490eae9ull, /* 5^-18 */
+    0x0760f253edb4ab0eull, /* 5^-19 */
+    0x05e72843249088d8ull, /* 5^-20 */
+    0x04b8ed0283a6d3e0ull, /* 5^-21 */
+    0x078e480405d7b966ull, /* 5^-22 */
+    0x060b6cd004ac9452ull, /* 5^-23 */
+    0x04d5f0a66a23a9dbull, /* 5^-24 */
+    0x07bcb43d769f762bull, /* 5^-25 */
+    0x063090312bb2c4efull, /* 5^-26 */
+    0x04f3a68dbc8f03f3ull, /* 5^-27 */
+    0x07ec3daf94180651ull, /* 5^-28 */
+    0x065697bfa9acd1daull, /* 5^-29 */
+    0x051212ffbaf0a7e2ull, /* 5^-30 */
+};
+static const ullong musvg_f2s_pow5_split[48] = {
+    0x1000000000000000ull, /* 5^0 */
+    0x1400000000000000ull, /* 5^1 */
+    0x1900000000000000ull, /* 5^2 */
+    0x1f40000000000000ull, /* 5^3 */
+    0x1388000000000000ull, /* 5^4 */
+    0x186a000000000000ull, /* 5^5 */
+    0x1e84800000000000ull, /* 5^6 */
+    0x1312d00000000000ull, /* 5^7 */
+    0x17d7840000000000ull, /* 5^8 */
+    0x1dcd650000000000ull, /* 5^9 */
+    0x12a05f2000000000ull, /* 5^10 */
+    0x174876e800000000ull, /* 5^11 */
+    0x1d1a94a200000000ull, /* 5^12 */
+    0x12309ce540000000ull, /* 5^13 */
+    0x16bcc41e90000000ull, /* 5^14 */
+    0x1c6bf52634000000ull, /* 5^15 */
+    0x11c37937e0800000ull, /* 5^16 */
+    0x16345785d8a00000ull, /* 5^17 */
+    0x1bc16d674ec80000ull, /* 5^18 */
+    0x1158e460913d0000ull, /* 5^19 */
+    0x15af1d78b58c4000ull, /* 5^20 */
+    0x1b1ae4d6e2ef5000ull, /* 5^21 */
+    0x10f0cf064dd59200ull, /* 5^22 */
+    0x152d02c7e14af680ull, /* 5^23 */
+    0x1a784379d99db420ull, /* 5^24 */
+    0x108b2a2c28029094ull, /* 5^25 */
+    0x14adf4b7320334b9ull, /* 5^26 */
+    0x19d971e4fe8401e7ull, /* 5^27 */
+    0x1027e72f1f128130ull, /* 5^28 */
+    0x1431e0fae6d7217cull, /* 5^29 */
+    0x193e5939a08ce9dbull, /* 5^30 */
+    0x1f8def8808b02452ull, /* 5^31 */
+    0x13b8b5b5056e16b3ull, /* 5^32 */
+    0x18a6e32246c99c60ull, /* 5^33 */
+    0x1ed09bead87c0378ull, /* 5^34 */
+    0x13426172c74d822bull, /* 5^35 */
+    0x1812f9cf7920e2b6ull, /* 5^36 */
+    0x1e17b84357691b64ull, /* 5^37 */
+    0x12ced32a16a1b11eull, /* 5^38 */
+    0x178287f49c4a1d66ull, /* 5^39 */
+    0x1d6329f1c35ca4bfull, /* 5^40 */
+    0x125dfa371a19e6f7ull, /* 5^41 */
+    0x16f578c4e0a060b5ull, /* 5^42 */
+    0x1cb2d6f618c878e3ull, /* 5^43 */
+    0x11efc659cf7d4b8dull, /* 5^44 */
+    0x166bb7f0435c9e71ull, /* 5^45 */
+    0x1c06a5ec5433c60dull, /* 5^46 */
+    0x118427b3b4a05bc8ull, /* 5^47 */
+};
+
+enum {
+    musvg_f2s_bias = 127,
+    musvg_f2s_pow5_inv_bitcount = 59,
+    musvg_f2s_pow5_bitcount = 61,
+    musvg_f2s_max_length = 16,
+};
+
+/* ceil(log2(5^e)), floor(log10(2^e)) and floor(log10(5^e)) */
+static inline int musvg_f2s_pow5bits(int e) { return (int)(((uint)e * 1217359) >> 19) + 1; }
+static inline int musvg_f2s_log10_pow2(int e) { return (int)(((uint)e * 78913) >> 18); }
+static inline int musvg_f2s_log10_pow5(int e) { return (int)(((uint)e * 732923) >> 20); }
+
+static inline int musvg_f2s_pow5_factor(uint v)
+{
+    int count = 0;
+    while (v % 5 == 0) {
+        v /= 5;
+        count++;
+    }
+    return count;
+}
+
+static inline uint musvg_f2s_mul_shift(uint m, ullong factor, int shift)
+{
+    const ullong bits0 = (ullong)m * (uint)factor;
+    const ullong bits1 = (ullong)m * (uint)(factor >> 32);
+    return (uint)(((bits0 >> 32) + bits1) >> (shift - 32));
+}
+
+/* returns the shortest decimal significand and sets its power of ten */
+static uint musvg_f2s_decimal(uint ieee_mantissa, uint ieee_exponent, int *exp10)
+{
+    int e2, e10, removed = 0;
+    uint m2, vr, vp, vm;
+    int vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+    uint last_removed = 0;
+
+    if (ieee_exponent == 0) {
+        e2 = 1 - musvg_f2s_bias - musvg_f32_mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int)ieee_exponent - musvg_f2s_bias - musvg_f32_mantissa_bits - 2;
+        m2 = (1u << musvg_f32_mantissa_bits) | ieee_mantissa;
+    }
+
+    /* the interval [mm, mp] around mv holds values that round to m2 */
+    const int accept_bounds = (m2 & 1) == 0;
+    const uint mv = 4 * m2;
+    const uint mp = 4 * m2 + 2;
+    const uint mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    const uint mm = 4 * m2 - 1 - mm_shift;
+
+    if (e2 >= 0) {
+        const int q = musvg_f2s_log10_pow2(e2);
+        const int k = musvg_f2s_pow5_inv_bitcount + musvg_f2s_pow5bits(q) - 1;
+        const int i = -e2 + q + k;
+        e10 = q;
+        vr = musvg_f2s_mul_shift(mv, musvg_f2s_pow5_inv_split[q], i);
+        vp = musvg_f2s_mul_shift(mp, musvg_f2s_pow5_inv_split[q], i);
+        vm = musvg_f2s_mul_shift(mm, musvg_f2s_pow5_inv_split[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            /* one digit more is removed than computed so we need the
+             * last removed digit of vr for rounding */
+            const int l = musvg_f2s_pow5_inv_bitcount + musvg_f2s_pow5bits(q - 1) - 1;
+            last_removed = musvg_f2s_mul_shift(mv, musvg_f2s_pow5_inv_split[q - 1],
+                -e2 + q - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            /* only one of mp, mv and mm can be a multiple of 5 */
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = musvg_f2s_pow5_factor(mv) >= q;
+            } else if (accept_bounds) {
+                vm_trailing_zeros = musvg_f2s_pow5_factor(mm) >= q;
+            } else {
+                vp -= musvg_f2s_pow5_factor(mp) >= q;
+            }
+        }
+    } else {
+        const int q = musvg_f2s_log10_pow5(-e2);
+        const int i = -e2 - q;
+        const int k = musvg_f2s_pow5bits(i) - musvg_f2s_pow5_bitcount;
+        int j = q - k;
+        e10 = q + e2;
+        vr = musvg_f2s_mul_shift(mv, musvg_f2s_pow5_split[i], j);
+        vp = musvg_f2s_mul_shift(mp, musvg_f2s_pow5_split[i], j);
+        vm = musvg_f2s_mul_shift(mm, musvg_f2s_pow5_split[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = q - 1 - (musvg_f2s_pow5bits(i + 1) - musvg_f2s_pow5_bitcount);
+            last_removed = musvg_f2s_mul_shift(mv, musvg_f2s_pow5_split[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            /* mv = 4 * m2 has at least two trailing zero bits */
+            vr_trailing_zeros = 1;
+            if (accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                --vp;
+            }
+        } else if (q < 31) {
+            vr_trailing_zeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+        }
+    }
+
+    /* remove digits while the interval still contains a shorter number */
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = vr % 10;
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = vr % 10;
+                vr /= 10; vp /= 10; vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            /* round ties to even */
+            last_removed = 4;
+        }
+        vr += (vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5;
+    } else {
+        while (vp / 10 > vm / 10) {
+            last_removed = vr % 10;
+            vr /= 10; vp /= 10; vm /= 10;
+            removed++;
+        }
+        vr += vr == vm || last_removed >= 5;
+    }
+
+    *exp10 = e10 + removed;
+    return vr;
+}
+
+/*
+ * write the shortest round trip representation of a float to out, which
+ * must have room for musvg_f2s_max_length characters. returns the length.
+ */
+static int musvg_format_float(char *out, float f)
+{
+    union { float f; uint u; } bits = { f };
+    const uint ieee_mantissa = bits.u & ((1u << musvg_f32_mantissa_bits) - 1);
+    const uint ieee_exponent = (bits.u >> musvg_f32_mantissa_bits) & 0xff;
+    char digits[10], *o = out;
+    int exp10, ndigits = 0, point;
+    uint v;
+
+    if (bits.u >> 31) *o++ = '-';
+    if (ieee_exponent == 0xff) {
+        memcpy(o, ieee_mantissa ? "nan" : "inf", 3);
+        return (int)(o - out) + 3;
+    }
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        *o++ = '0';
+        return (int)(o - out);
+    }
+
+    v = musvg_f2s_decimal(ieee_mantissa, ieee_exponent, &exp10);
+    do {
+        digits[ndigits++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+
+    /* digits are reversed. point is the position of the decimal point
+     * relative to the first digit and point - 1 is the %e exponent */
+    point = ndigits + exp10;
+    if (point - 1 < -5 || point - 1 >= 9) {
+        int e = point - 1;
+        *o++ = digits[--ndigits];
+        if (ndigits) {
+            *o++ = '.';
+            while (ndigits) *o++ = digits[--ndigits];
+        }
+        *o++ = 'e';
+        if (e < 0) {
+            *o++ = '-';
+            e = -e;
+        }
+        if (e >= 10) *o++ = '0' + e / 10;
+        *o++ = '0' + e % 10;
+    } else if (point <= 0) {
+        *o++ = '0';
+        *o++ = '.';
+        while (point++ < 0) *o++ = '0';
+        while (ndigits) *o++ = digits[--ndigits];
+    } else {
+        for (int i = 0; i < point; i++) {
+            *o++ = ndigits ? digits[--ndigits] : '0';
+        }
+        if (ndigits) {
+            *o++ = '.';
+            while (ndigits) *o++ = digits[--ndigits];
+        }
+    }
+    return (int)(o - out);
+}
+
+/* snprintf style wrapper returning the untruncated length */
+static int musvg_float_string(char *buf, size_t buflen, float f)
+{
+    char str[musvg_f2s_max_length];
+    int len = musvg_format_float(str, f);
+    if (buflen > 0) {
+        size_t n = (size_t)len < buflen ? (size_t)len : buflen - 1;
+        memcpy(buf, str, n);
+        buf[n] = '\0';
+    }
+    return len;
+}
+
 static int musvg_viewbox_string(char *buf, size_t buflen, const musvg_viewbox *vb)
 {
-    return snprintf(buf, buflen, "%.8g %.8g %.8g %.8g", vb->x, vb->y, vb->width, vb->height);
+    const float v[4] = { vb->x, vb->y, vb->width, vb->height };
+    int len = 0;
+    for (uint i = 0; i < 4; i++) {
+        if (i > 0) len += snprintf(buf+len, buflen-len, " ");
+        len += musvg_float_string(buf+len, buflen-len, v[i]);
+    }
+    return len;
 }
 
 // SVG transform parsing
 
-static int musvg_parse_transform_args(const char* str, float* args, int maxNa, musvg_small* na)
+static int musvg_parse_transform_args(const char* str, const char* end,
+    float* args, int maxNa, musvg_small* na)
 {
-    const char* end;
+    const char* close;
     const char* ptr;
-    char it[64];
+    const char* next;
 
     *na = 0;
     ptr = str;
-    while (*ptr && *ptr != '(') ++ptr;
-    if (*ptr == 0)
+    while (ptr < end && *ptr != '(') ++ptr;
+    if (ptr == end)
         return 1;
-    end = ptr;
-    while (*end && *end != ')') ++end;
-    if (*end == 0)
+    close = ptr;
+    while (close < end && *close != ')') ++close;
+    if (close == end)
         return 1;
 
-    while (ptr < end) {
+    while (ptr < close) {
         if (*ptr == '-' || *ptr == '+' || *ptr == '.' || musvg_isdigit(*ptr)) {
             if (*na >= maxNa) return 0;
-            ptr = musvg_parse_number(ptr, it, 64);
-            args[(*na)++] = (float)musvg_atof(it);
+            next = musvg_scan_float(ptr, close, args + *na);
+            if (next == ptr) {
+                ++ptr;
+                continue;
+            }
+            (*na)++;
+            ptr = next;
         } else {
             ++ptr;
         }
     }
-    return (int)(end - str);
+    return (int)(close - str);
 }
 
-static int musvg_parse_matrix(musvg_transform* xf, const char* str)
+static int musvg_parse_matrix(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_matrix;
     memset(xf->args, 0, sizeof(xf->args));
-    int len = musvg_parse_transform_args(str, t, 6, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, t, 6, &xf->nargs);
     if (xf->nargs != 6) memset(xf->xform, 0, sizeof(xf->xform));
     else memcpy(xf->xform, t, sizeof(xf->xform));
     return len;
 }
 
-static int musvg_parse_translate(musvg_transform* xf, const char* str)
+static int musvg_parse_translate(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_translate;
     memset(xf->args, 0, sizeof(xf->args));
-    int len = musvg_parse_transform_args(str, xf->args, 2, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, xf->args, 2, &xf->nargs);
     xformSetTranslation(t, xf->args[0], xf->args[1]);
     memcpy(xf->xform, t, sizeof(xf->xform));
     return len;
 }
 
-static int musvg_parse_scale(musvg_transform* xf, const char* str)
+static int musvg_parse_scale(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_scale;
     memset(xf->args, 0, sizeof(xf->args));
-    int len = musvg_parse_transform_args(str, xf->args, 2, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, xf->args, 2, &xf->nargs);
     if (xf->nargs == 1) xf->args[1] = xf->args[0];
     xformSetScale(t, xf->args[0], xf->args[1]);
     memcpy(xf->xform, t, sizeof(xf->xform));
     return len;
 }
 
-static int musvg_parse_skew_x(musvg_transform* xf, const char* str)
+static int musvg_parse_skew_x(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_skew_x;
     memset(xf->args, 0, sizeof(xf->args));
-    int len = musvg_parse_transform_args(str, xf->args, 1, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, xf->args, 1, &xf->nargs);
     xformSetSkewX(t, xf->args[0]/180.0f*M_PI);
     memcpy(xf->xform, t, sizeof(xf->xform));
     return len;
 }
 
-static int musvg_parse_skew_y(musvg_transform* xf, const char* str)
+static int musvg_parse_skew_y(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_skew_y;
     memset(xf->args, 0, sizeof(xf->args));
-    int len = musvg_parse_transform_args(str, xf->args, 1, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, xf->args, 1, &xf->nargs);
     xformSetSkewY(t, xf->args[0]/180.0f*M_PI);
     memcpy(xf->xform, t, sizeof(xf->xform));
     return len;
 }
 
-static int musvg_parse_rotate(musvg_transform* xf, const char* str)
+static int musvg_parse_rotate(musvg_transform* xf, const char* str, const char* end)
 {
     float t[6];
     xf->nargs = 0;
     xf->type = musvg_transform_rotate;
     memset(xf->args, 0, sizeof(xf->args));
     float m[6];
-    int len = musvg_parse_transform_args(str, xf->args, 3, &xf->nargs);
+    int len = musvg_parse_transform_args(str, end, xf->args, 3, &xf->nargs);
     if (xf->nargs == 1)
         xf->args[1] = xf->args[2] = 0.0f;
     xformIdentity(m);
@@ -1457,32 +2681,33 @@ int musvg_transform_string(char *buf, size_t buflen, const musvg_transform *xf)
     const uint nargs = xf->type == musvg_transform_matrix ? 6 : xf->nargs;
     int len = snprintf(buf, buflen, "%s(", musvg_transform_names[xf->type]);
     for (uint i = 0; i < nargs; i++) {
-        len += snprintf(buf+len, buflen-len, "%s%.8g", i > 0 ? "," : "", v[i]);
+        if (i > 0) len += snprintf(buf+len, buflen-len, ",");
+        len += musvg_float_string(buf+len, buflen-len, v[i]);
     }
     len += snprintf(buf+len, buflen-len, ")");
     return len;
 }
 
-static musvg_transform musvg_parse_transform(const char* str)
+static musvg_transform musvg_parse_transform(const char* str, const char* end)
 {
     musvg_transform transform, tmp;
     int ntrans = 0, len;
 
     xformIdentity(transform.xform);
-    while (*str)
+    while (str < end)
     {
-        if (strncmp(str, "matrix", 6) == 0)
-            len = musvg_parse_matrix(&tmp, str);
-        else if (strncmp(str, "translate", 9) == 0)
-            len = musvg_parse_translate(&tmp, str);
-        else if (strncmp(str, "scale", 5) == 0)
-            len = musvg_parse_scale(&tmp, str);
-        else if (strncmp(str, "rotate", 6) == 0)
-            len = musvg_parse_rotate(&tmp, str);
-        else if (strncmp(str, "skewX", 5) == 0)
-            len = musvg_parse_skew_x(&tmp, str);
-        else if (strncmp(str, "skewY", 5) == 0)
-            len = musvg_parse_skew_y(&tmp, str);
+        if (musvg_startswith(str, end, "matrix"))
+            len = musvg_parse_matrix(&tmp, str, end);
+        else if (musvg_startswith(str, end, "translate"))
+            len = musvg_parse_translate(&tmp, str, end);
+        else if (musvg_startswith(str, end, "scale"))
+            len = musvg_parse_scale(&tmp, str, end);
+        else if (musvg_startswith(str, end, "rotate"))
+            len = musvg_parse_rotate(&tmp, str, end);
+        else if (musvg_startswith(str, end, "skewX"))
+            len = musvg_parse_skew_x(&tmp, str, end);
+        else if (musvg_startswith(str, end, "skewY"))
+            len = musvg_parse_skew_y(&tmp, str, end);
         else{
             ++str;
             continue;
@@ -1509,6 +2734,31 @@ static musvg_transform musvg_parse_transform(const char* str)
     return transform;
 }
 
+// SVG errors
+
+static const char * musvg_error_names[] = {
+    [musvg_error_none]      = "no error",
+    [musvg_error_invalid]   = "invalid input",
+    [musvg_error_truncated] = "truncated input",
+    [musvg_error_element]   = "element out of range",
+    [musvg_error_attr]      = "attribute out of range",
+    [musvg_error_value]     = "value out of range",
+    [musvg_error_count]     = "count out of range",
+    [musvg_error_string]    = "string index out of range",
+    [musvg_error_class]     = "class index out of range",
+    [musvg_error_float]     = "invalid float",
+    [musvg_error_depth]     = "unbalanced or too deep nesting",
+    [musvg_error_io]        = "cannot open, read or write file",
+    [musvg_error_format]    = "unsupported format or version",
+};
+
+/* parse functions return zero or a negated musvg_error_t */
+const char* musvg_error_name(int err)
+{
+    if (err < 0) err = -err;
+    return err <= musvg_error_limit ? musvg_error_names[err] : "unknown error";
+}
+
 // SVG enumeration parsing
 
 musvg_small musvg_parse_format(const char *format)
@@ -1525,125 +2775,125 @@ musvg_small musvg_parse_format(const char *format)
         return musvg_format_binary_ieee;
     else if (strcmp(format, "svgb") == 0)
         return musvg_format_binary_ieee;
+    else if (strcmp(format, "binary-delta") == 0)
+        return musvg_format_binary_delta;
+    else if (strcmp(format, "svgd") == 0)
+        return musvg_format_binary_delta;
+    else if (strcmp(format, "binary-columnar") == 0)
+        return musvg_format_binary_columnar;
+    else if (strcmp(format, "svgc") == 0)
+        return musvg_format_binary_columnar;
+    else if (strcmp(format, "binary-entropy") == 0)
+        return musvg_format_binary_entropy;
+    else if (strcmp(format, "svgr") == 0)
+        return musvg_format_binary_entropy;
+    else if (strcmp(format, "image") == 0)
+        return musvg_format_image;
+    else if (strcmp(format, "svgi") == 0)
+        return musvg_format_image;
     return musvg_format_none;
 }
 
-musvg_small musvg_parse_units(const char* units)
+musvg_small musvg_parse_element_name(const char *name, size_t len)
+{
+    int idx = musvg_name_lookup(&musvg_element_table, name, len);
+    return idx < 0 ? musvg_element_none : idx;
+}
+
+musvg_small musvg_parse_attr_name(const char *name, size_t len)
 {
-    if (units[0] == 'p' && units[1] == 'x')
-        return musvg_unit_px;
-    else if (units[0] == 'p' && units[1] == 't')
-        return musvg_unit_pt;
-    else if (units[0] == 'p' && units[1] == 'c')
-        return musvg_unit_pc;
-    else if (units[0] == 'm' && units[1] == 'm')
-        return musvg_unit_mm;
-    else if (units[0] == 'c' && units[1] == 'm')
-        return musvg_unit_cm;
-    else if (units[0] == 'i' && units[1] == 'n')
-        return musvg_unit_in;
-    else if (units[0] == '%')
-        return musvg_unit_percent;
-    else if (units[0] == 'e' && units[1] == 'm')
-        return musvg_unit_em;
-    else if (units[0] == 'e' && units[1] == 'x')
-        return musvg_unit_ex;
-    return musvg_unit_user;
+    int idx = musvg_name_lookup(&musvg_attribute_table, name, len);
+    return idx < 0 ? musvg_attr_none : idx;
 }
 
-musvg_small musvg_parse_linecap(const char* str)
+musvg_small musvg_parse_units(const char* units, size_t len)
 {
-    if (strcmp(str, "butt") == 0)
-        return musvg_linecap_butt;
-    else if (strcmp(str, "round") == 0)
-        return musvg_linecap_round;
-    else if (strcmp(str, "square") == 0)
-        return musvg_linecap_square;
-    return musvg_linecap_default;
+    /* units are a suffix of the number so only the first two
+     * characters are significant. dispatch on the first. */
+    char c1 = len >= 2 ? units[1] : '\0';
+    switch (len >= 1 ? units[0] : '\0') {
+    case '%': return musvg_unit_percent;
+    case 'p': return c1 == 'x' ? musvg_unit_px :
+                     c1 == 't' ? musvg_unit_pt :
+                     c1 == 'c' ? musvg_unit_pc : musvg_unit_user;
+    case 'm': return c1 == 'm' ? musvg_unit_mm : musvg_unit_user;
+    case 'c': return c1 == 'm' ? musvg_unit_cm : musvg_unit_user;
+    case 'i': return c1 == 'n' ? musvg_unit_in : musvg_unit_user;
+    case 'e': return c1 == 'm' ? musvg_unit_em :
+                     c1 == 'x' ? musvg_unit_ex : musvg_unit_user;
+    default:  return musvg_unit_user;
+    }
+}
+
+musvg_small musvg_parse_linecap(const char* str, size_t len)
+{
+    int idx = musvg_name_lookup(&musvg_linecap_table, str, len);
+    return idx < 0 ? musvg_linecap_default : idx;
 }
 
-musvg_small musvg_parse_linejoin(const char* str)
+musvg_small musvg_parse_linejoin(const char* str, size_t len)
 {
-    if (strcmp(str, "miter") == 0)
-        return musvg_linejoin_miter;
-    else if (strcmp(str, "round") == 0)
-        return musvg_linejoin_round;
-    else if (strcmp(str, "bevel") == 0)
-        return musvg_linejoin_bevel;
-    return musvg_linejoin_default;
+    int idx = musvg_name_lookup(&musvg_linejoin_table, str, len);
+    return idx < 0 ? musvg_linejoin_default : idx;
 }
 
-musvg_small musvg_parse_fillrule(const char* str)
+musvg_small musvg_parse_fillrule(const char* str, size_t len)
 {
-    if (strcmp(str, "nonzero") == 0)
-        return musvg_fillrule_nonzero;
-    else if (strcmp(str, "evenodd") == 0)
-        return musvg_fillrule_evenodd;
-    return musvg_fillrule_default;
+    int idx = musvg_name_lookup(&musvg_fillrule_table, str, len);
+    return idx < 0 ? musvg_fillrule_default : idx;
 }
 
-musvg_small musvg_parse_display(const char* str)
+musvg_small musvg_parse_display(const char* str, size_t len)
 {
-    if (strcmp(str, "none") == 0)
-        return musvg_display_none;
-    else if (strcmp(str, "inline") == 0)
-        return musvg_display_inline;
-    return musvg_display_default;
+    int idx = musvg_name_lookup(&musvg_display_table, str, len);
+    return idx < 0 ? musvg_display_default : idx;
 }
 
-musvg_small musvg_parse_spread_method(const char* str)
+musvg_small musvg_parse_spread_method(const char* str, size_t len)
 {
-    if (strcmp(str, "pad") == 0)
-        return musvg_spread_method_pad;
-    else if (strcmp(str, "reflect") == 0)
-        return musvg_spread_method_reflect;
-    else if (strcmp(str, "repeat") == 0)
-        return musvg_spread_method_repeat;
-    return musvg_spread_method_default;
+    int idx = musvg_name_lookup(&musvg_spread_method_table, str, len);
+    return idx < 0 ? musvg_spread_method_default : idx;
 }
 
-musvg_small musvg_parse_gradient_units(const char* str)
+musvg_small musvg_parse_gradient_units(const char* str, size_t len)
 {
-    if (strcmp(str, "userSpaceOnUse") == 0)
-        return musvg_gradient_unit_user;
-    else if (strcmp(str, "objectBoundingBox") == 0)
-        return musvg_gradient_unit_obb;
-    return musvg_gradient_unit_default;
+    int idx = musvg_name_lookup(&musvg_gradient_unit_table, str, len);
+    return idx < 0 ? musvg_gradient_unit_default : idx;
 }
 
-musvg_small musvg_parse_aspectratio_align(const char* str, int isx)
+musvg_small musvg_parse_aspectratio_align(const char* str, size_t len, int isx)
 {
-    if (strcmp(str, "none") == 0)
+    if (musvg_strneq(str, len, "none"))
         return musvg_align_none;
-    else if (strstr(str, isx ? "xMid" : "yMid") != 0)
+    else if (musvg_contains(str, len, isx ? "xMid" : "yMid"))
         return musvg_align_mid;
-    else if (strstr(str, isx ? "xMin" : "yMin") != 0)
+    else if (musvg_contains(str, len, isx ? "xMin" : "yMin"))
         return musvg_align_min;
-    else if (strstr(str, isx ? "xMax" : "yMax") != 0)
+    else if (musvg_contains(str, len, isx ? "xMax" : "yMax"))
         return musvg_align_max;
     return musvg_align_default;
 }
 
-musvg_small musvg_parse_aspectratio_crop(const char* str)
+musvg_small musvg_parse_aspectratio_crop(const char* str, size_t len)
 {
-    if (strcmp(str, "none") == 0)
+    if (musvg_strneq(str, len, "none"))
         return musvg_align_none;
-    else if (strstr(str, "meet") != 0)
+    else if (musvg_contains(str, len, "meet"))
         return musvg_crop_meet;
-    else if (strstr(str, "slice") != 0)
+    else if (musvg_contains(str, len, "slice"))
         return  musvg_crop_slice;
     return musvg_crop_default;
 }
 
-static musvg_aspectratio musvg_parse_aspectratio(const char* str)
+static musvg_aspectratio musvg_parse_aspectratio(const char* str, size_t len)
 {
     musvg_aspectratio aspectratio;
     // Parse X align
-    aspectratio.alignX = musvg_parse_aspectratio_align(str, 1);
+    aspectratio.alignX = musvg_parse_aspectratio_align(str, len, 1);
     // Parse Y align
-    aspectratio.alignY = musvg_parse_aspectratio_align(str, 0);
+    aspectratio.alignY = musvg_parse_aspectratio_align(str, len, 0);
     // Parse meet/slice
-    aspectratio.alignType = musvg_parse_aspectratio_crop(str);
+    aspectratio.alignType = musvg_parse_aspectratio_crop(str, len);
     return aspectratio;
 }
 
@@ -1663,38 +2913,23 @@ static int musvg_aspectratio_string(char *buf, size_t buflen, const musvg_aspect
     return len;
 }
 
-static const char* musvg_get_next_dash_item(const char* s, char* it)
-{
-    int n = 0;
-    it[0] = '\0';
-    // Skip white spaces and commas
-    while (*s && (musvg_isspace(*s) || *s == ',')) s++;
-    // Advance until whitespace, comma or end.
-    while (*s && (!musvg_isspace(*s) && *s != ',')) {
-        if (n < 63)
-            it[n++] = *s;
-        s++;
-    }
-    it[n++] = '\0';
-    return s;
-}
-
-static musvg_dasharray musvg_parse_stroke_dasharray(const char* str)
+static musvg_dasharray musvg_parse_stroke_dasharray(const char* str, const char* end)
 {
-    char item[64];
     float sum = 0.0f;
     musvg_dasharray r = { { 0 }, 0 };
 
     // Handle "none"
-    if (str[0] == 'n')
+    if (str < end && str[0] == 'n')
         return r;
 
-    // Parse dashes
-    while (*str) {
-        str = musvg_get_next_dash_item(str, item);
-        if (!*item) break;
+    // Parse dashes, skipping any unit suffix up to the next separator
+    while (str < end) {
+        float dash = 0.0f;
+        size_t n = musvg_scan_floats(str, end, &dash, 1, &str);
+        if (n == 0 && str == end) break;
+        while (str < end && !musvg_isspace(*str) && *str != ',') str++;
         if (r.count < array_size(r.dashes)) {
-            r.dashes[r.count++] = fabsf((float)musvg_atof(item));
+            r.dashes[r.count++] = fabsf(dash);
         }
     }
 
@@ -1713,82 +2948,126 @@ static int musvg_dasharray_string(char *buf, size_t buflen, const musvg_dasharra
         len += snprintf(buf+len, buflen-len, "none");
     } else {
         for (size_t i = 0; i < da->count; i++) {
-            len += snprintf(buf+len, buflen-len, "%s%.8g", i > 0 ? "," : "", da->dashes[i]);
+            if (i > 0) len += snprintf(buf+len, buflen-len, ",");
+            len += musvg_float_string(buf+len, buflen-len, da->dashes[i]);
         }
     }
     return len;
 }
 
-static musvg_id musvg_parse_id(musvg_parser *p, const char* str)
+static musvg_id musvg_parse_id(musvg_parser *p, const char* str, size_t len)
 {
-    musvg_index string_offset = alloc_string(p, str, strlen(str));
+    musvg_index string_offset = alloc_string(p, str, len);
     musvg_id id = { (uint)string_offset };
     return id;
 }
 
-static musvg_points musvg_parse_points(musvg_parser *p, const char *s)
+static musvg_points musvg_parse_points(musvg_parser *p, const char *s, const char *end)
 {
-    char item[64];
-
+    musvg_cursor pts;
+    size_t run, n;
     musvg_points points = { points_count(p) };
 
-    while (*s) {
-        s = musvg_get_next_path_item(s, item);
-        if (!*item) break;
-        float value = (float)musvg_atof(item);
-        points_add(p, &value);
-    }
-
-    points.point_count = points_count(p) - points.point_offset;
+    musvg_cursor_init(&pts, &p->points, sizeof(float));
+    do {
+        float *v = (float*)musvg_cursor_run(&pts, &run);
+        n = musvg_scan_floats(s, end, v, run, &s);
+        musvg_cursor_advance(&pts, n);
+    } while (n == run);
+    points.point_count = pts.count;
+    musvg_cursor_commit(&pts);
 
     return points;
 }
 
-static musvg_path_d musvg_parse_path_ops(musvg_parser *p, const char *s)
+static inline int musvg_is_number_start(char c)
+{
+    return c == '-' || c == '+' || c == '.' || musvg_isdigit(c);
+}
+
+/*
+ * path data scanner
+ *
+ * commands and arguments are decoded in a single pass directly into the
+ * points, path_ops and path_points vectors using append cursors. numbers
+ * need no separators when unambiguous, so "1.5.5" is 1.5 and 0.5 and
+ * "-1-2" is -1 and -2, and the arc large-arc and sweep flags may be
+ * written as single digits without separators. arguments beyond the
+ * command's count repeat the command, with moveto continuing as lineto.
+ * partial argument lists are discarded.
+ */
+static musvg_path_d musvg_parse_path_ops(musvg_parser *p, const char *s, const char *end)
 {
-    int nargs, opc;
-    uint argc;
-    musvg_small code;
-    float args[7];
-    char item[64];
+    musvg_cursor pts, ops, opp;
+    uint code = musvg_path_none, argc = 0, nargs = 0;
+
+    musvg_path_d d = { path_ops_count(p) };
 
-    musvg_path_d ops = { path_ops_count(p) };
+    musvg_cursor_init(&pts, &p->points, sizeof(float));
+    musvg_cursor_init(&ops, &p->path_ops, sizeof(musvg_path_op));
+    musvg_cursor_init(&opp, &p->path_points, sizeof(musvg_points));
 
-    nargs = 0;
-    while (*s) {
-        s = musvg_get_next_path_item(s, item);
-        if (!*item) break;
-        int is_length = musvg_is_length(item);
-        if (nargs == 0 && !is_length) {
-            opc = item[0];
-            code = musvg_parse_opcode(opc);
+    while (s < end) {
+        char c = *s;
+        if (musvg_isspace(c) || c == ',') {
+            s++;
+            continue;
+        }
+        if (!musvg_is_number_start(c)) {
+            musvg_cursor_rewind(&pts, nargs);
+            nargs = 0;
+            code = musvg_parse_opcode(c);
             argc = musvg_path_opcode_arg_count(code);
-            if (code != 0 && argc == 0) {
-                musvg_path_op op = { code };
-                musvg_points points = { 0, 0 };
-                path_ops_add(p, &op);
-                path_points_add(p, &points);
+            if (code != musvg_path_none && argc == 0) {
+                musvg_path_op *op = (musvg_path_op*)musvg_cursor_next(&ops);
+                musvg_points *pp = (musvg_points*)musvg_cursor_next(&opp);
+                op->code = code;
+                pp->point_offset = 0;
+                pp->point_count = 0;
             }
+            s++;
+            continue;
+        }
+        if (argc == 0) {
+            /* numbers without a command are ignored */
+            float ignored;
+            const char *next = musvg_scan_float(s, end, &ignored);
+            s = next == s ? s + 1 : next;
             continue;
         }
-        float value = (float)musvg_atof(item);
-        args[nargs] = value;
-        if (nargs == argc - 1) {
-            uint points_offset = points_count(p);
-            for (uint i = 0; i < argc; i++) {
-                points_add(p, args + i);
+        float *v = (float*)musvg_cursor_next(&pts);
+        if ((code == musvg_path_eliptical_arc_abs || code == musvg_path_eliptical_arc_rel) &&
+            (nargs == 3 || nargs == 4) && (c == '0' || c == '1')) {
+            *v = (float)(c - '0');
+            s++;
+        } else {
+            const char *next = musvg_scan_float(s, end, v);
+            if (next == s) {
+                musvg_cursor_rewind(&pts, 1);
+                s++;
+                continue;
             }
-            musvg_path_op op = { code };
-            musvg_points points = { points_offset, argc };
-            path_ops_add(p, &op);
-            path_points_add(p, &points);
+            s = next;
+        }
+        if (++nargs == argc) {
+            musvg_path_op *op = (musvg_path_op*)musvg_cursor_next(&ops);
+            musvg_points *pp = (musvg_points*)musvg_cursor_next(&opp);
+            op->code = code;
+            pp->point_offset = musvg_cursor_index(&pts) - argc;
+            pp->point_count = argc;
+            nargs = 0;
+            if (code == musvg_path_moveto_abs) code = musvg_path_lineto_abs;
+            if (code == musvg_path_moveto_rel) code = musvg_path_lineto_rel;
         }
-        nargs = (nargs + 1) % argc;
     }
+    musvg_cursor_rewind(&pts, nargs);
 
-    ops.op_count = path_ops_count(p) - ops.op_offset;
+    musvg_cursor_commit(&pts);
+    musvg_cursor_commit(&ops);
+    musvg_cursor_commit(&opp);
+    d.op_count = path_ops_count(p) - d.op_offset;
 
-    return ops;
+    return d;
 }
 
 // SVG node stack
@@ -1874,6 +3153,7 @@ static musvg_index musvg_node_add(musvg_parser *p, musvg_element type)
 {
     musvg_index node_idx = nodes_alloc(p, 1);
     musvg_node *node = nodes_get(p, node_idx);
+    memset(node, 0, sizeof(musvg_node));
 
     uint depth = p->node_depth++;
     if (depth == musvg_max_depth) abort();
@@ -1936,16 +3216,22 @@ static musvg_index find_attr_parent(musvg_parser *p, musvg_index node_idx, musvg
     return storage;
 }
 
+/* add a slot referring to existing storage, which may be shared */
+static inline void share_attr(musvg_parser *p, musvg_index node_idx, musvg_attr attr, musvg_index storage)
+{
+    musvg_index slot_idx = node_attr(p, node_idx);
+    musvg_slot o = { attr, mnu_int48_set(storage), mnu_int48_set(slot_idx) };
+    node_set_attr(p, node_idx, slots_add(p,&o));
+}
+
 static inline musvg_index alloc_attr(musvg_parser *p, musvg_index node_idx, musvg_attr attr)
 {
     /* allocate aligned storage space */
     size_t type = musvg_attr_types[attr];
     size_t size = musvg_type_storage[type].size;
     size_t align = musvg_type_storage[type].align;
-    musvg_index slot_idx = node_attr(p, node_idx);
     musvg_index storage = storage_alloc(p, size, align);
-    musvg_slot o = { attr, mnu_int48_set(storage), mnu_int48_set(slot_idx) };
-    node_set_attr(p, node_idx, slots_add(p,&o));
+    share_attr(p, node_idx, attr, storage);
     return storage;
 }
 
@@ -1978,9 +3264,9 @@ static inline musvg_small* attr_pointer_parent(musvg_parser *p, musvg_index node
     return (musvg_small*)storage_get(p, storage);
 }
 
-static inline musvg_small parse_enum(musvg_attr attr, const char *s)
+static inline musvg_small parse_enum(musvg_attr attr, const char *s, size_t len)
 {
-    return musvg_type_info_enum[attr].parse(s);
+    return musvg_type_info_enum[attr].parse(s, len);
 }
 
 static inline musvg_small enum_modulus(musvg_attr attr)
@@ -1988,947 +3274,4198 @@ static inline musvg_small enum_modulus(musvg_attr attr)
     return musvg_type_info_enum[attr].limit + 1;
 }
 
-// binary readers
+// binary delta coding
 
-int musvg_read_binary_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_small *enum_value = (musvg_small*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_read_i8(buf, enum_value));
-    *enum_value = *enum_value  % enum_modulus(attr);
-    return 0;
-}
+/*
+ * svgd stores path and polygon coordinates on a per-document decimal
+ * fixed-point grid with a step of 10^-digits. absolute coordinates are
+ * delta coded against the pen position, relative coordinates are already
+ * deltas, and both are written as zigzag LEB128 varints.
+ *
+ * the header holds the grid digits. by default the encoder picks the
+ * coarsest grid on which every coordinate is exact, and paths holding
+ * coordinates that fit no grid are written as vf128 floats. a requested
+ * precision rounds coordinates to the grid, bounding the error to half
+ * a step plus the float rounding of the decoded value. relative
+ * coordinates are rounded at their absolute position and written as the
+ * difference from the rounded pen, so the error does not grow along a
+ * path.
+ */
 
-int musvg_read_binary_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+enum {
+    musvg_grid_max_digits = 6,
+    musvg_grid_mode_fixed = 0,
+    musvg_grid_mode_float = 1,
+};
+
+static const double musvg_grid_scale[musvg_grid_max_digits + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6
+};
+
+typedef struct musvg_grid_pen musvg_grid_pen;
+
+struct musvg_grid_pen
 {
-    musvg_id *id = (musvg_id*)attr_pointer(p, node_idx, attr);
-    char id_str[128] = { 0 };
-    ullong id_len = 0;
-    assert(!mu_leb_u64_read(buf, &id_len));
-    assert(id_len < sizeof(id_str));
-    assert(mu_buf_read_bytes(buf, id_str, id_len) == id_len);
-    id->name = alloc_string(p, id_str, id_len);
-    return 0;
-}
+    llong pos[2];
+    llong start[2];
+    double real[2];            /* unrounded pen, used when rounding to a precision */
+    double real_start[2];
+};
 
-int musvg_read_binary_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static inline ullong musvg_zigzag(llong v)
 {
-    musvg_length *length = (musvg_length*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_read(buf, &length->value));
-    assert(mu_buf_read_i8(buf, &length->units));
-    return 0;
+    return ((ullong)v << 1) ^ (ullong)(v >> 63);
 }
 
-int musvg_read_binary_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static inline llong musvg_unzigzag(ullong v)
 {
-    musvg_color *color = (musvg_color*)attr_pointer(p, node_idx, attr);
-    uint8_t type;
-    assert(mu_buf_read_i8(buf, (int8_t*)&type));
-    color->type = type;
-    if (color->type == musvg_color_type_rgba) {
-        int32_t col;
-        assert(mu_buf_read_i32(buf, &col));
-        color->data = col;
-    } else if (color->type == musvg_color_type_url) {
-        ullong url_len = 0;
-        char url_str[128];
-        assert(!mu_leb_u64_read(buf, &url_len));
-        assert(url_len < sizeof(url_str));
-        assert(mu_buf_read_bytes(buf, url_str, url_len) == url_len);
-        color->data = alloc_string(p, url_str, url_len);
-    }
-    return 0;
+    return (llong)(v >> 1) ^ -(llong)(v & 1);
 }
 
-int musvg_read_binary_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static inline float musvg_grid_float(llong n, int digits)
 {
-    musvg_transform *xf = (musvg_transform*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_read_i8(buf, (int8_t*)&xf->type));
-    if (xf->type == musvg_transform_matrix) {
-        xf->nargs = 0;
-        assert(!p->f32_read_vec(buf, xf->xform, 6));
-    } else {
-        assert(mu_buf_read_i8(buf, (int8_t*)&xf->nargs));
-        assert(!p->f32_read_vec(buf, xf->args, xf->nargs));
-    }
-    return 0;
+    return (float)((double)n / musvg_grid_scale[digits]);
 }
 
-int musvg_read_binary_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* quantize to the grid; exact requires the grid to reproduce the float */
+static inline int musvg_grid_fits(float f, int digits, int exact, llong *n)
 {
-    musvg_dasharray *da = (musvg_dasharray*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_read_i8(buf, (int8_t*)&da->count));
-    assert(!p->f32_read_vec(buf, da->dashes, da->count));
-    return 0;
+    double v = (double)f * musvg_grid_scale[digits];
+    if (!(fabs(v) < 0x1p53)) return 0;
+    *n = llround(v);
+    if (!exact) return 1;
+    float g = musvg_grid_float(*n, digits);
+    return g == f && signbit(g) == signbit(f);
 }
 
-int musvg_read_binary_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* coarsest grid of at least digits on which the points from start are exact */
+static int musvg_grid_digits(musvg_parser *p, size_t start, int digits)
 {
-    float *value = (float*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_read(buf, value));
-    return 0;
+    llong n;
+    for (int d = digits; d < musvg_grid_max_digits; d++) {
+        size_t i = start, count = points_count(p);
+        for (; i < count; i++) {
+            float f = *points_get(p, i);
+            if (!musvg_grid_fits(f, d, 1, &n) &&
+                 musvg_grid_fits(f, musvg_grid_max_digits, 1, &n)) break;
+        }
+        if (i == count) return d;
+    }
+    return musvg_grid_max_digits;
 }
 
-int musvg_read_binary_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/*
+ * axis of each argument of an opcode: 0 for x, 1 for y or -1 for values
+ * that are not coordinates, such as arc radii, rotation and flags.
+ */
+static const signed char musvg_grid_axes[][7] = {
+    [musvg_path_none]                         = { -1, -1, -1, -1, -1, -1, -1 },
+    [musvg_path_closepath]                    = { -1, -1, -1, -1, -1, -1, -1 },
+    [musvg_path_moveto_abs]                   = {  0,  1 },
+    [musvg_path_moveto_rel]                   = {  0,  1 },
+    [musvg_path_lineto_abs]                   = {  0,  1 },
+    [musvg_path_lineto_rel]                   = {  0,  1 },
+    [musvg_path_curveto_cubic_abs]            = {  0,  1,  0,  1,  0,  1 },
+    [musvg_path_curveto_cubic_rel]            = {  0,  1,  0,  1,  0,  1 },
+    [musvg_path_quadratic_curve_to_abs]       = {  0,  1,  0,  1 },
+    [musvg_path_quadratic_curve_to_rel]       = {  0,  1,  0,  1 },
+    [musvg_path_eliptical_arc_abs]            = { -1, -1, -1, -1, -1,  0,  1 },
+    [musvg_path_eliptical_arc_rel]            = { -1, -1, -1, -1, -1,  0,  1 },
+    [musvg_path_line_to_horizontal_abs]       = {  0 },
+    [musvg_path_line_to_horizontal_rel]       = {  0 },
+    [musvg_path_line_to_vertical_abs]         = {  1 },
+    [musvg_path_line_to_vertical_rel]         = {  1 },
+    [musvg_path_curveto_cubic_smooth_abs]     = {  0,  1,  0,  1 },
+    [musvg_path_curveto_cubic_smooth_rel]     = {  0,  1,  0,  1 },
+    [musvg_path_curveto_quadratic_smooth_abs] = {  0,  1 },
+    [musvg_path_curveto_quadratic_smooth_rel] = {  0,  1 },
+};
+
+/* absolute opcodes are even, see musvg_path_opcode_t */
+static inline int musvg_grid_relative(uint code)
 {
-    musvg_viewbox *vb = (musvg_viewbox*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_read(buf, &vb->x));
-    assert(!p->f32_read(buf, &vb->y));
-    assert(!p->f32_read(buf, &vb->width));
-    assert(!p->f32_read(buf, &vb->height));
-    return 0;
+    return code > musvg_path_closepath && (code & 1);
 }
 
-int musvg_read_binary_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_aspectratio *ar = (musvg_aspectratio*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_read_i8(buf, &ar->alignX));
-    assert(mu_buf_read_i8(buf, &ar->alignY));
-    assert(mu_buf_read_i8(buf, &ar->alignType));
-    return 0;
+/*
+ * move the pen to the end point of a complete group of arguments. the
+ * writer also passes the unrounded values to move the unrounded pen.
+ */
+static inline void musvg_grid_pen_end(musvg_grid_pen *pen, uint code,
+    const llong *args, const float *vals, uint nargs, int first)
+{
+    int rel = musvg_grid_relative(code), seen[2] = { 0, 0 };
+    for (uint k = nargs; k-- > 0; ) {
+        int axis = musvg_grid_axes[code][k];
+        if (axis < 0 || seen[axis]) continue;
+        seen[axis] = 1;
+        pen->pos[axis] = rel ? pen->pos[axis] + args[k] : args[k];
+        if (vals) pen->real[axis] = rel ? pen->real[axis] + vals[k] : vals[k];
+    }
+    if (first && (code == musvg_path_moveto_abs || code == musvg_path_moveto_rel)) {
+        memcpy(pen->start, pen->pos, sizeof(pen->start));
+        memcpy(pen->real_start, pen->real, sizeof(pen->real_start));
+    }
 }
 
-int musvg_read_binary_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_path_d *pd = (musvg_path_d*)attr_pointer(p, node_idx, attr);
-    ullong count = 0;
-    assert(!mu_leb_u64_read(buf, &count));
-    musvg_path_d ops = { path_ops_count(p), count };
-    *pd = ops;
-    for (uint j = 0; j < ops.op_count; j++) {
-        ullong count = 0; musvg_small code = 0;
-        assert(mu_buf_read_i8(buf, (int8_t*)&code));
-        assert(!mu_leb_u64_read(buf, &count));
-        musvg_path_op op = { code };
-        musvg_points points = { points_count(p), count };
-        path_ops_add(p, &op);
-        path_points_add(p, &points);
-        ullong points_count = points.point_count;
-        ullong points_idx = points_alloc(p, points_count);
-        if (points_linear(p, points_idx, points.point_count)) {
-            assert(!p->f32_read_vec(buf, points_get(p, points_idx), points_count));
-        } else {
-            for (size_t k = 0; k < points.point_count; k++) {
-                assert(!p->f32_read(buf, points_get(p, points_idx + k)));
-            }
-        }
+/*
+ * quantize one argument against the pen. fails if the value, or the pen
+ * after a relative move, leaves the range where the grid is exact.
+ */
+static inline int musvg_grid_quantize(musvg_parser *p, int axis, int rel, float f,
+    const musvg_grid_pen *pen, llong *n)
+{
+    int exact = p->grid_precision < 0;
+    if (rel && axis >= 0 && !exact) {
+        /* round the absolute position so errors do not accumulate */
+        double abs = (pen->real[axis] + f) * musvg_grid_scale[p->grid_digits];
+        if (!(fabs(abs) < 0x1p53)) return 0;
+        *n = llround(abs) - pen->pos[axis];
+        return 1;
     }
-    return 0;
+    if (!musvg_grid_fits(f, p->grid_digits, exact, n)) return 0;
+    return !(rel && axis >= 0) || llabs(pen->pos[axis] + *n) < (1ll << 53);
 }
 
-int musvg_read_binary_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_points *pp = (musvg_points*)attr_pointer(p, node_idx, attr);
-    ullong count = 0;
-    assert(!mu_leb_u64_read(buf, &count));
-    musvg_points points = { points_count(p), count };
-    *pp = points;
-    ullong points_count = points.point_count;
-    ullong points_idx = points_alloc(p, points_count);
-    if (points_linear(p, points_idx, points.point_count)) {
-        assert(!p->f32_read_vec(buf, points_get(p, points_idx), points_count));
-    } else {
-        for (size_t k = 0; k < points.point_count; k++) {
-            assert(!p->f32_read(buf, points_get(p, points_idx + k)));
+/*
+ * writes the points, or only moves the pen when buf is NULL. returns 0
+ * if they do not fit the grid.
+ */
+static int musvg_grid_write(musvg_parser *p, mu_buf *buf, uint code,
+    musvg_index idx, size_t count, musvg_grid_pen *pen)
+{
+    uint nargs = musvg_path_opcode_arg_count(code);
+    int rel = musvg_grid_relative(code);
+    const signed char *axes = musvg_grid_axes[code];
+    llong args[7], n;
+    float vals[7];
+
+    if (code == musvg_path_closepath) {
+        memcpy(pen->pos, pen->start, sizeof(pen->pos));
+        memcpy(pen->real, pen->real_start, sizeof(pen->real));
+    }
+    for (size_t k = 0, j = 0; k < count; k++) {
+        int axis = axes[j];
+        float f = *points_get(p, idx + k);
+        if (!musvg_grid_quantize(p, axis, rel, f, pen, &n)) return 0;
+        if (buf) {
+            ullong v = musvg_zigzag(axis < 0 || rel ? n : n - pen->pos[axis]);
+            assert(!mu_leb_u64_write(buf, &v));
         }
+        args[j] = n;
+        vals[j] = f;
+        if (++j < nargs) continue;
+        if (nargs) musvg_grid_pen_end(pen, code, args, vals, nargs, k < nargs);
+        j = 0;
     }
-    return 0;
+    return 1;
 }
 
-// binary writers
-
-int musvg_write_binary_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* follows the pen of the writer, so relative runs cannot leave the grid range */
+static int musvg_grid_path_fits(musvg_parser *p, uint code, musvg_index idx,
+    size_t count, musvg_grid_pen *pen)
 {
-    const musvg_small value = *attr_pointer(p, node_idx, attr) % enum_modulus(attr);
-    assert(mu_buf_write_i8(buf, value));
-    return 0;
+    return musvg_grid_write(p, NULL, code, idx, count, pen);
 }
 
-int musvg_write_binary_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static void musvg_grid_read(musvg_parser *p, mu_buf *buf, uint code,
+    musvg_index idx, size_t count, musvg_grid_pen *pen)
 {
-    const musvg_id id = *(musvg_id*)attr_pointer(p, node_idx, attr);
-    const char* id_str = fetch_string(p, id.name);
-    const ullong id_len = strlen(id_str);
-    assert(!mu_leb_u64_write(buf, &id_len));
-    assert(mu_buf_write_bytes(buf, id_str, id_len) == id_len);
-    return 0;
+    uint nargs = musvg_path_opcode_arg_count(code);
+    int rel = musvg_grid_relative(code), digits = p->grid_digits;
+    const signed char *axes = musvg_grid_axes[code];
+    float *out = points_linear(p, idx, count) ? points_get(p, idx) : NULL;
+    llong args[7];
+
+    if (code == musvg_path_closepath) {
+        memcpy(pen->pos, pen->start, sizeof(pen->pos));
+    }
+    for (size_t k = 0, j = 0; k < count; k++) {
+        int axis = axes[j];
+        llong n = musvg_unzigzag(mu_leb_u64_read_byval(buf).value);
+        if (!(axis < 0 || rel)) n += pen->pos[axis];
+        if (out) out[k] = musvg_grid_float(n, digits);
+        else *points_get(p, idx + k) = musvg_grid_float(n, digits);
+        args[j] = n;
+        if (++j < nargs) continue;
+        if (nargs) musvg_grid_pen_end(pen, code, args, NULL, nargs, k < nargs);
+        j = 0;
+    }
 }
 
-int musvg_write_binary_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+// binary string table
+
+/*
+ * svgv, svgb and svgd bodies are preceded by a table of the distinct id
+ * and url strings in the document, each a LEB128 length and the bytes.
+ * ids and urls in the body are LEB128 indices into the table, so readers
+ * intern each string once and share its offset between the nodes.
+ */
+struct musvg_string_table
 {
-    const musvg_length length = *(musvg_length*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_write(buf, length.value));
-    assert(mu_buf_write_i8(buf, length.units) == 1);
-    return 0;
-}
+    array_buffer refs;         /* string offset of each entry */
+    musvg_index *slots;        /* entry plus one, by string hash */
+    size_t mask;
+};
 
-int musvg_write_binary_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static ullong musvg_string_hash(const char *s, size_t len)
 {
-    const musvg_color color = *(musvg_color*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_write_i8(buf, (int8_t)color.type));
-    if (color.type == musvg_color_type_rgba) {
-        assert(mu_buf_write_i32(buf, (int32_t)color.data));
-    } else if (color.type == musvg_color_type_url) {
-        const char *url_str = fetch_string(p, color.data);
-        const ullong url_len = strlen(url_str);
-        assert(!mu_leb_u64_write(buf, &url_len));
-        assert(mu_buf_write_bytes(buf, url_str, url_len) == url_len);
+    /* FNV-1a */
+    ullong h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * 0x100000001b3ull;
     }
-    return 0;
+    return h;
 }
 
-int musvg_write_binary_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static void musvg_string_table_init(musvg_string_table *t)
 {
-    const musvg_transform xf = *(musvg_transform*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_write_i8(buf, (int8_t)xf.type));
-    if (xf.type == musvg_transform_matrix) {
-        assert(!p->f32_write_vec(buf, xf.xform, 6));
-    } else {
-        assert(mu_buf_write_i8(buf, (int8_t)xf.nargs));
-        assert(!p->f32_write_vec(buf, xf.args, xf.nargs));
-    }
-    return 0;
+    array_buffer_init(&t->refs, sizeof(musvg_index), 16);
+    t->slots = NULL;
+    t->mask = 0;
 }
 
-int musvg_write_binary_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static void musvg_string_table_destroy(musvg_string_table *t)
 {
-    const musvg_dasharray da = *(musvg_dasharray*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_write_i8(buf, (int8_t)da.count));
-    assert(!p->f32_write_vec(buf, da.dashes, da.count));
-    return 0;
+    array_buffer_destroy(&t->refs);
+    free(t->slots);
 }
 
-int musvg_write_binary_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static musvg_index musvg_string_table_ref(musvg_string_table *t, size_t entry)
 {
-    const float value = *(float*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_write(buf, value));
-    return 0;
+    return *(musvg_index*)array_buffer_get(&t->refs, sizeof(musvg_index), entry);
 }
 
-int musvg_write_binary_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* string offset held by an id or url attribute slot, otherwise zero */
+static musvg_index musvg_slot_string(musvg_parser *p, musvg_index slot_idx)
 {
-    const musvg_viewbox vb = *(musvg_viewbox*)attr_pointer(p, node_idx, attr);
-    assert(!p->f32_write(buf, vb.x));
-    assert(!p->f32_write(buf, vb.y));
-    assert(!p->f32_write(buf, vb.width));
-    assert(!p->f32_write(buf, vb.height));
-    return 0;
+    char *value = storage_get(p, slot_storage(p, slot_idx));
+    switch (musvg_attr_types[slot_type(p, slot_idx)]) {
+    case musvg_type_id:
+        return ((musvg_id*)value)->name;
+    case musvg_type_color:
+        if (((musvg_color*)value)->type == musvg_color_type_url) {
+            return ((musvg_color*)value)->data;
+        }
+        return 0;
+    default:
+        return 0;
+    }
 }
 
-int musvg_write_binary_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* returns the slot holding the string at offset str, or an empty slot */
+static musvg_index* musvg_string_table_slot(musvg_parser *p, musvg_string_table *t, musvg_index str)
 {
-    const musvg_aspectratio ar = *(musvg_aspectratio*)attr_pointer(p, node_idx, attr);
-    assert(mu_buf_write_i8(buf, ar.alignX));
-    assert(mu_buf_write_i8(buf, ar.alignY));
-    assert(mu_buf_write_i8(buf, ar.alignType));
-    return 0;
+    const char *s = fetch_string(p, str);
+    size_t h = (size_t)musvg_string_hash(s, strlen(s)) & t->mask;
+    for (; t->slots[h]; h = (h + 1) & t->mask) {
+        size_t entry = t->slots[h] - 1;
+        if (strcmp(fetch_string(p, musvg_string_table_ref(t, entry)), s) == 0) break;
+    }
+    return t->slots + h;
 }
 
-int musvg_write_binary_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* returns the entry holding the string at offset str, adding it if absent */
+static size_t musvg_string_table_intern(musvg_parser *p, musvg_string_table *t, musvg_index str)
 {
-    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
-    ullong count = ops.op_count;
-    assert(!mu_leb_u64_write(buf, &count));
-    for (musvg_index j = 0; j < ops.op_count; j++) {
-        const  musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
-        const  musvg_points *points = path_points_get(p, ops.op_offset + j);
-        musvg_small code = op->code;
-        ullong points_count = points->point_count;
-        ullong points_idx = points->point_offset;
-        assert(mu_buf_write_i8(buf, (int8_t)code));
-        assert(!mu_leb_u64_write(buf, &points_count));
-        if (points_linear(p, points_idx, points_count)) {
-            assert(!p->f32_write_vec(buf, points_get(p, points_idx), points_count));
-        } else {
-            for (size_t k = 0; k < points_count; k++) {
-                assert(!p->f32_write(buf, *points_get(p, points_idx + k)));
-            }
-        }
-    }
-    return 0;
+    musvg_index *slot = musvg_string_table_slot(p, t, str);
+    if (!*slot) *slot = array_buffer_add(&t->refs, sizeof(musvg_index), &str) + 1;
+    return *slot - 1;
 }
 
-int musvg_write_binary_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+/* gathers the distinct strings in slot order */
+static void musvg_string_table_collect(musvg_parser *p, musvg_string_table *t)
 {
-    musvg_points points = *(musvg_points*)attr_pointer(p, node_idx, attr);
-    ullong points_count = points.point_count;
-    ullong points_idx = points.point_offset;
-    assert(!mu_leb_u64_write(buf, &points_count));
-    if (points_linear(p, points_idx, points_count)) {
-        assert(!p->f32_write_vec(buf, points_get(p, points_idx), points_count));
-    } else {
-        for (size_t k = 0; k < points_count; k++) {
-            assert(!p->f32_write(buf, *points_get(p, points_idx + k)));
-        }
+    size_t count = 0, size = 2;
+    for (musvg_index i = 1; i < slots_count(p); i++) {
+        count += musvg_slot_string(p, i) != 0;
+    }
+    while (size < count * 2) size <<= 1;
+    t->slots = (musvg_index*)calloc(size, sizeof(musvg_index));
+    t->mask = size - 1;
+    for (musvg_index i = 1; i < slots_count(p); i++) {
+        musvg_index str = musvg_slot_string(p, i);
+        if (str) musvg_string_table_intern(p, t, str);
     }
-    return 0;
 }
 
-// attribute parsers
-
-int musvg_read_text_enum(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+static void musvg_string_table_write(musvg_parser *p, mu_buf *buf, musvg_string_table *t)
 {
-    musvg_small val = parse_enum(attr, s);
-    musvg_small *ptr = (musvg_small*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+    ullong count = array_buffer_count(&t->refs);
+    assert(!mu_leb_u64_write(buf, &count));
+    for (size_t i = 0; i < count; i++) {
+        const char *str = fetch_string(p, musvg_string_table_ref(t, i));
+        const ullong len = strlen(str);
+        assert(!mu_leb_u64_write(buf, &len));
+        assert(mu_buf_write_bytes(buf, str, len) == len);
+    }
 }
 
-int musvg_read_text_id(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_id val = musvg_parse_id(p, s);
-    musvg_id *ptr = (musvg_id*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
+/* reads the strings straight into string storage */
+static int musvg_string_table_read(musvg_parser *p, mu_buf *buf, musvg_string_table *t)
+{
+    ullong count, len;
+    if (mu_leb_u64_read(buf, &count) < 0) return -musvg_error_truncated;
+    for (ullong i = 0; i < count; i++) {
+        if (mu_leb_u64_read(buf, &len) < 0) return -musvg_error_truncated;
+        if (len > mu_buf_avaiable_read(buf) &&
+            (!buf->sync || buf->read_check(buf, len))) return -musvg_error_truncated;
+        musvg_index str = strings_alloc(p, len + 1, 1);
+        char *dst = strings_get(p, str);
+        if (mu_buf_read_bytes(buf, dst, len) != len) return -musvg_error_truncated;
+        dst[len] = '\0';
+        array_buffer_add(&t->refs, sizeof(musvg_index), &str);
+    }
     return 0;
 }
 
-int musvg_read_text_length(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
-{
-    musvg_length val = musvg_parse_length(s);
-    musvg_length *ptr = (musvg_length*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+/*
+ * writes the table index of a string, or the string itself without a table.
+ * the table is written ahead of the nodes, so a string missing from it is
+ * reported to the transcoder, whose scan pass should have gathered it.
+ */
+static void musvg_write_binary_string(musvg_parser *p, mu_buf *buf, musvg_index str)
+{
+    musvg_string_table *t = p->string_table;
+    if (t) {
+        musvg_index slot = t->slots ? *musvg_string_table_slot(p, t, str) : 0;
+        if (!slot) musvg_transcode_fail(p, -musvg_error_string);
+        ullong entry = slot ? slot - 1 : 0;
+        char *c = mu_buf_write_reserve(buf, mu_leb_max_length);
+        assert(c);
+        mu_buf_write_commit(buf, mu_cur_put_leb(c, entry));
+    } else {
+        const char *s = fetch_string(p, str);
+        const size_t len = strlen(s);
+        char *c = mu_buf_write_reserve(buf, mu_leb_max_length + len);
+        assert(c);
+        c = mu_cur_put_leb(c, len);
+        mu_buf_write_commit(buf, mu_cur_put_bytes(c, s, len));
+    }
 }
 
-int musvg_read_text_color(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+static int musvg_read_binary_string(musvg_parser *p, mu_buf *buf, musvg_index *str)
 {
-    musvg_color val = musvg_parse_color(p, s);
-    musvg_color *ptr = (musvg_color*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
+    ullong entry;
+    if (mu_leb_u64_read(buf, &entry) < 0) return -1;
+    if (!p->string_table || entry >= array_buffer_count(&p->string_table->refs)) return -1;
+    *str = musvg_string_table_ref(p->string_table, entry);
     return 0;
 }
 
-int musvg_read_text_transform(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+// binary readers
+
+/*
+ * the binary readers and writers reserve buffer space once for each
+ * attribute, or each path op, and move a cursor over the fixed size
+ * fields. IEEE 754 floats are fixed size so they go through the cursor
+ * too, while vf128 floats go through the batch codec in between.
+ */
+
+static inline int musvg_f32_read_fixed(musvg_parser *p)
 {
-    musvg_transform val = musvg_parse_transform(s);
-    musvg_transform *ptr = (musvg_transform*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+    return p->f32_read == mu_ieee754_f32_read;
 }
 
-int musvg_read_text_dasharray(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+static inline int musvg_f32_write_fixed(musvg_parser *p)
 {
-    musvg_dasharray val = musvg_parse_stroke_dasharray(s);
-    musvg_dasharray *ptr = (musvg_dasharray*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+    return p->f32_write == mu_ieee754_f32_write_byval;
 }
 
-int musvg_read_text_float(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+static int musvg_read_binary_floats(musvg_parser *p, mu_buf *buf, musvg_index idx, size_t count)
 {
-    float val = (float)musvg_atof(s);
-    float *ptr = (float*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
+    if (points_linear(p, idx, count)) {
+        return p->f32_read_vec(buf, points_get(p, idx), count);
+    }
+    for (size_t k = 0; k < count; k++) {
+        if (p->f32_read(buf, points_get(p, idx + k)) < 0) return -1;
+    }
     return 0;
 }
 
-int musvg_read_text_viewbox(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+/* reads floats at the cursor and returns a cursor with rest bytes after it */
+static const char* musvg_cursor_get_floats(musvg_parser *p, mu_buf *buf,
+    const char *c, float *value, size_t count, size_t rest)
 {
-    musvg_viewbox val = musvg_parse_viewbox(s);
-    musvg_viewbox *ptr = (musvg_viewbox*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+    if (musvg_f32_read_fixed(p)) {
+        for (size_t k = 0; k < count; k++) c = mu_cur_get_f32(c, value + k);
+        return c;
+    }
+    mu_buf_read_commit(buf, c);
+    if (p->f32_read_vec(buf, value, count) < 0) return NULL;
+    return mu_buf_read_reserve(buf, rest);
 }
 
-int musvg_read_text_aspectratio(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+/* reads a LEB128 count, falling back to the buffer when it is cut short */
+static const char* musvg_cursor_get_count(mu_buf *buf, const char *c, ullong *count)
 {
-    musvg_aspectratio val = musvg_parse_aspectratio(s);
-    musvg_aspectratio *ptr = (musvg_aspectratio*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
-    return 0;
+    const char *next = mu_cur_get_leb(c, mu_buf_read_end(buf), count);
+    if (next) return next;
+    mu_buf_read_commit(buf, c);
+    if (mu_leb_u64_read(buf, count) < 0) return NULL;
+    return mu_buf_read_reserve(buf, 0);
 }
 
-int musvg_read_text_path(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+/* commits the cursor and reads count points into idx */
+static int musvg_cursor_get_points(musvg_parser *p, mu_buf *buf,
+    const char *c, musvg_index idx, size_t count)
 {
-    musvg_path_d val = musvg_parse_path_ops(p, s);
-    musvg_path_d *ptr = (musvg_path_d*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
+    mu_buf_read_commit(buf, c);
+    if (!musvg_f32_read_fixed(p)) {
+        return musvg_read_binary_floats(p, buf, idx, count);
+    }
+    if (!(c = mu_buf_read_reserve(buf, sizeof(float) * count))) return -1;
+    for (size_t k = 0; k < count; k++) {
+        c = mu_cur_get_f32(c, points_get(p, idx + k));
+    }
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_read_text_points(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr)
+static int musvg_read_delta_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+static int musvg_read_delta_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+
+int musvg_read_binary_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    musvg_points val = musvg_parse_points(p, s);
-    musvg_points *ptr = (musvg_points*)attr_pointer(p, node_idx, attr);
-    *ptr = val;
+    musvg_small *enum_value = (musvg_small*)attr_pointer(p, node_idx, attr);
+    const char *c = mu_buf_read_reserve(buf, 1);
+    if (!c) return -1;
+    mu_buf_read_commit(buf, mu_cur_get_i8(c, enum_value));
+    *enum_value = *enum_value  % enum_modulus(attr);
     return 0;
 }
 
-// text writers
-
-int musvg_write_text_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_small enum_value = *attr_pointer(p, node_idx, attr) % enum_modulus(attr);
-    const char *enum_name = musvg_type_info_enum[attr].names[enum_value];
-    size_t enum_len = strlen(enum_name);
-    assert(mu_buf_write_bytes(buf, enum_name, enum_len) == enum_len);
+    musvg_id *id = (musvg_id*)attr_pointer(p, node_idx, attr);
+    musvg_index str;
+    if (musvg_read_binary_string(p, buf, &str) < 0) return -1;
+    id->name = str;
     return 0;
 }
 
-int musvg_write_text_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_id id = *(musvg_id*)attr_pointer(p, node_idx, attr);
-    const char* id_str = fetch_string(p, id.name);
-    const ullong id_len = strlen(id_str);
-    assert(mu_buf_write_bytes(buf, id_str, id_len) == id_len);
+    musvg_length *length = (musvg_length*)attr_pointer(p, node_idx, attr);
+    const char *c = mu_buf_read_reserve(buf, musvg_f32_read_fixed(p) ? 5 : 0);
+    if (!c || !(c = musvg_cursor_get_floats(p, buf, c, &length->value, 1, 1))) return -1;
+    c = mu_cur_get_i8(c, &length->units);
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_length length = *(musvg_length*)attr_pointer(p, node_idx, attr);
-    char str[64];
-    int len = snprintf(str, sizeof(str), "%.8g", length.value);
-    if (length.units != musvg_unit_default) {
-        len += snprintf(str + len, sizeof(str) - len, "%s",
-            musvg_unit_names[length.units]);
+    musvg_color *color = (musvg_color*)attr_pointer(p, node_idx, attr);
+    const char *c = mu_buf_read_reserve(buf, 1);
+    int8_t type;
+    if (!c) return -1;
+    c = mu_cur_get_i8(c, &type);
+    color->type = (uint8_t)type;
+    if (color->type == musvg_color_type_rgba) {
+        int32_t col;
+        mu_buf_read_commit(buf, c);
+        if (!(c = mu_buf_read_reserve(buf, 4))) return -1;
+        c = mu_cur_get_i32(c, &col);
+        color->data = (uint32_t)col;
+    } else if (color->type == musvg_color_type_url) {
+        musvg_index str;
+        mu_buf_read_commit(buf, c);
+        if (musvg_read_binary_string(p, buf, &str) < 0) return -1;
+        color->data = str;
+        return 0;
     }
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    char str[128];
-    const musvg_color color = *(musvg_color*)attr_pointer(p, node_idx, attr);
-    if (color.type == musvg_color_type_url) {
-        const char* url_str = fetch_string(p, color.data);
-        int len = snprintf(str, sizeof(str), "url(#%s)", url_str);
-        assert(mu_buf_write_bytes(buf, str, len) == len);
-    } else if (color.type == musvg_color_type_rgba) {
-        int len = snprintf(str, sizeof(str), "#%06x", (int32_t)color.data);
-        assert(mu_buf_write_bytes(buf, str, len) == len);
+    musvg_transform *xf = (musvg_transform*)attr_pointer(p, node_idx, attr);
+    const size_t f32_size = musvg_f32_read_fixed(p) ? 4 : 0;
+    const char *c = mu_buf_read_reserve(buf, 1);
+    if (!c) return -1;
+    c = mu_cur_get_i8(c, (int8_t*)&xf->type);
+    if (xf->type == musvg_transform_matrix) {
+        xf->nargs = 0;
+        mu_buf_read_commit(buf, c);
+        if (!(c = mu_buf_read_reserve(buf, f32_size * 6))) return -1;
+        if (!(c = musvg_cursor_get_floats(p, buf, c, xf->xform, 6, 0))) return -1;
     } else {
-        assert(mu_buf_write_bytes(buf, "none", 4) == 4);
+        mu_buf_read_commit(buf, c);
+        if (!(c = mu_buf_read_reserve(buf, 1))) return -1;
+        c = mu_cur_get_i8(c, (int8_t*)&xf->nargs);
+        if (xf->nargs > array_size(xf->args)) return -1;
+        mu_buf_read_commit(buf, c);
+        if (!(c = mu_buf_read_reserve(buf, f32_size * xf->nargs))) return -1;
+        if (!(c = musvg_cursor_get_floats(p, buf, c, xf->args, xf->nargs, 0))) return -1;
     }
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_transform xf = *(musvg_transform*)attr_pointer(p, node_idx, attr);
-    char str[128];
-    int len = musvg_transform_string(str, sizeof(str), &xf);
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    musvg_dasharray *da = (musvg_dasharray*)attr_pointer(p, node_idx, attr);
+    const size_t f32_size = musvg_f32_read_fixed(p) ? 4 : 0;
+    const char *c = mu_buf_read_reserve(buf, 1);
+    if (!c) return -1;
+    c = mu_cur_get_i8(c, (int8_t*)&da->count);
+    if (da->count > array_size(da->dashes)) return -1;
+    mu_buf_read_commit(buf, c);
+    if (!(c = mu_buf_read_reserve(buf, f32_size * da->count))) return -1;
+    if (!(c = musvg_cursor_get_floats(p, buf, c, da->dashes, da->count, 0))) return -1;
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_dasharray da = *(musvg_dasharray*)attr_pointer(p, node_idx, attr);
-    char str[128];
-    int len = musvg_dasharray_string(str, sizeof(str), &da);
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    float *value = (float*)attr_pointer(p, node_idx, attr);
+    const char *c = mu_buf_read_reserve(buf, musvg_f32_read_fixed(p) ? 4 : 0);
+    if (!c || !(c = musvg_cursor_get_floats(p, buf, c, value, 1, 0))) return -1;
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const float value = *(float*)attr_pointer(p, node_idx, attr);
-    char str[128];
-    int len = snprintf(str, sizeof(str), "%.8f", value);
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    musvg_viewbox *vb = (musvg_viewbox*)attr_pointer(p, node_idx, attr);
+    float v[4];
+    const char *c = mu_buf_read_reserve(buf, musvg_f32_read_fixed(p) ? 16 : 0);
+    if (!c || !(c = musvg_cursor_get_floats(p, buf, c, v, 4, 0))) return -1;
+    mu_buf_read_commit(buf, c);
+    vb->x = v[0];
+    vb->y = v[1];
+    vb->width = v[2];
+    vb->height = v[3];
     return 0;
 }
 
-int musvg_write_text_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_viewbox vb = *(musvg_viewbox*)attr_pointer(p, node_idx, attr);
-    char str[128];
-    int len = musvg_viewbox_string(str, sizeof(str), &vb);
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    musvg_aspectratio *ar = (musvg_aspectratio*)attr_pointer(p, node_idx, attr);
+    const char *c = mu_buf_read_reserve(buf, 3);
+    if (!c) return -1;
+    c = mu_cur_get_i8(c, &ar->alignX);
+    c = mu_cur_get_i8(c, &ar->alignY);
+    c = mu_cur_get_i8(c, &ar->alignType);
+    mu_buf_read_commit(buf, c);
     return 0;
 }
 
-int musvg_write_text_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    const musvg_aspectratio ar = *(musvg_aspectratio*)attr_pointer(p, node_idx, attr);
-    char str[128];
-    int len = musvg_aspectratio_string(str, sizeof(str), &ar);
-    assert(mu_buf_write_bytes(buf, str, len) == len);
+    if (p->grid_digits >= 0) return musvg_read_delta_path(p, buf, node_idx, attr);
+    musvg_path_d *pd = (musvg_path_d*)attr_pointer(p, node_idx, attr);
+    ullong count = 0;
+    const char *c = mu_buf_read_reserve(buf, 1);
+    if (!c || !(c = musvg_cursor_get_count(buf, c, &count))) return -1;
+    mu_buf_read_commit(buf, c);
+    musvg_path_d ops = { path_ops_count(p), count };
+    *pd = ops;
+    for (uint j = 0; j < ops.op_count; j++) {
+        ullong count = 0; musvg_small code = 0;
+        if (!(c = mu_buf_read_reserve(buf, 2))) return -1;
+        c = mu_cur_get_i8(c, (int8_t*)&code);
+        if (!(c = musvg_cursor_get_count(buf, c, &count))) return -1;
+        musvg_path_op op = { code };
+        musvg_points points = { points_count(p), count };
+        path_ops_add(p, &op);
+        path_points_add(p, &points);
+        ullong points_idx = points_alloc(p, points.point_count);
+        if (musvg_cursor_get_points(p, buf, c, points_idx, points.point_count) < 0) return -1;
+    }
     return 0;
 }
 
-int musvg_write_text_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+int musvg_read_binary_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
-    char last_code = 0;
-    for (musvg_index j = 0; j < ops.op_count; j++) {
-        char str[128];
-        const musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
-        const musvg_points *points = path_points_get(p, ops.op_offset + j);
-        int8_t code = musvg_path_opcode_cmd_char(op->code);
-        assert(mu_buf_write_i8(buf, code != last_code ? code : ' '));
-        for (musvg_index k = 0; k < points->point_count; k++) {
-            if (k > 0) assert(mu_buf_write_i8(buf, ','));
-            float v = *points_get(p, points->point_offset + k);
-            int len = snprintf(str, sizeof(str), "%.8g", v);
-            assert(mu_buf_write_bytes(buf, str, len) == len);
+    if (p->grid_digits >= 0) return musvg_read_delta_points(p, buf, node_idx, attr);
+    musvg_points *pp = (musvg_points*)attr_pointer(p, node_idx, attr);
+    ullong count = 0;
+    const char *c = mu_buf_read_reserve(buf, 1);
+    if (!c || !(c = musvg_cursor_get_count(buf, c, &count))) return -1;
+    musvg_points points = { points_count(p), count };
+    *pp = points;
+    ullong points_idx = points_alloc(p, points.point_count);
+    return musvg_cursor_get_points(p, buf, c, points_idx, points.point_count);
+}
+
+/* svgd paths and points are only decoded after musvg_validate_binary */
+static int musvg_read_delta_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_path_d *pd = (musvg_path_d*)attr_pointer(p, node_idx, attr);
+    musvg_grid_pen pen = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+    ullong count = 0;
+    musvg_small mode = 0;
+    mu_leb_u64_read(buf, &count);
+    mu_buf_read_unchecked_i8(buf, (int8_t*)&mode);
+    musvg_path_d ops = { path_ops_count(p), count };
+    *pd = ops;
+    for (uint j = 0; j < ops.op_count; j++) {
+        ullong count = 0; musvg_small code = 0;
+        mu_buf_read_unchecked_i8(buf, (int8_t*)&code);
+        mu_leb_u64_read(buf, &count);
+        musvg_path_op op = { code };
+        musvg_points points = { points_count(p), count };
+        path_ops_add(p, &op);
+        path_points_add(p, &points);
+        ullong points_idx = points_alloc(p, points.point_count);
+        if (mode == musvg_grid_mode_fixed) {
+            musvg_grid_read(p, buf, code, points_idx, points.point_count, &pen);
+        } else {
+            musvg_read_binary_floats(p, buf, points_idx, points.point_count);
         }
-        last_code = code;
     }
     return 0;
 }
 
-int musvg_write_text_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+static int musvg_read_delta_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
 {
-    musvg_points points = *(musvg_points*)attr_pointer(p, node_idx, attr);
-    for (musvg_index j = 0; j < points.point_count; j++) {
-        char str[128];
-        if (j > 0) assert(mu_buf_write_i8(buf, j % 2 ? ',' : ' '));
-        float v = *points_get(p, points.point_offset + j);
-        int len = snprintf(str, sizeof(str), "%.8g", v);
-        assert(mu_buf_write_bytes(buf, str, len) == len);
+    musvg_points *pp = (musvg_points*)attr_pointer(p, node_idx, attr);
+    musvg_grid_pen pen = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+    ullong count = 0;
+    musvg_small mode = 0;
+    mu_leb_u64_read(buf, &count);
+    mu_buf_read_unchecked_i8(buf, (int8_t*)&mode);
+    musvg_points points = { points_count(p), count };
+    *pp = points;
+    ullong points_idx = points_alloc(p, points.point_count);
+    if (mode == musvg_grid_mode_fixed) {
+        musvg_grid_read(p, buf, musvg_path_lineto_abs, points_idx, points.point_count, &pen);
+    } else {
+        musvg_read_binary_floats(p, buf, points_idx, points.point_count);
     }
     return 0;
 }
 
-// type metadata
+// binary writers
 
-typedef int (*musvg_attr_str_fn)(musvg_parser *p, const char *s, musvg_index node_idx, musvg_attr attr);
+static void musvg_write_binary_floats(musvg_parser *p, mu_buf *buf, musvg_index idx, size_t count)
+{
+    if (points_linear(p, idx, count)) {
+        assert(!p->f32_write_vec(buf, points_get(p, idx), count));
+    } else {
+        for (size_t k = 0; k < count; k++) {
+            assert(!p->f32_write(buf, *points_get(p, idx + k)));
+        }
+    }
+}
 
-static const musvg_attr_str_fn musvg_text_parsers[] = {
-    [musvg_type_enum]        = &musvg_read_text_enum,
-    [musvg_type_id]          = &musvg_read_text_id,
-    [musvg_type_length]      = &musvg_read_text_length,
-    [musvg_type_color]       = &musvg_read_text_color,
-    [musvg_type_transform]   = &musvg_read_text_transform,
-    [musvg_type_dasharray]   = &musvg_read_text_dasharray,
-    [musvg_type_float]       = &musvg_read_text_float,
+/* writes floats at the cursor and returns a cursor with room for rest bytes */
+static char* musvg_cursor_put_floats(musvg_parser *p, mu_buf *buf,
+    char *c, const float *value, size_t count, size_t rest)
+{
+    if (musvg_f32_write_fixed(p)) {
+        for (size_t k = 0; k < count; k++) c = mu_cur_put_f32(c, value[k]);
+        return c;
+    }
+    mu_buf_write_commit(buf, c);
+    assert(!p->f32_write_vec(buf, value, count));
+    return mu_buf_write_reserve(buf, rest);
+}
+
+/* fixed size floats are reserved in runs that fit any writer buffer */
+enum { musvg_cursor_max_floats = 256 };
+
+/* commits the cursor and writes count points from idx */
+static void musvg_cursor_put_points(musvg_parser *p, mu_buf *buf,
+    char *c, musvg_index idx, size_t count)
+{
+    mu_buf_write_commit(buf, c);
+    if (!musvg_f32_write_fixed(p)) {
+        musvg_write_binary_floats(p, buf, idx, count);
+        return;
+    }
+    for (size_t k = 0; k < count;) {
+        size_t n = count - k < musvg_cursor_max_floats
+            ? count - k : musvg_cursor_max_floats;
+        c = mu_buf_write_reserve(buf, 4 * n);
+        assert(c);
+        for (size_t end = k + n; k < end; k++) {
+            c = mu_cur_put_f32(c, *points_get(p, idx + k));
+        }
+        mu_buf_write_commit(buf, c);
+    }
+}
+
+static int musvg_write_delta_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+static int musvg_write_delta_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+
+int musvg_write_binary_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_small value = *attr_pointer(p, node_idx, attr) % enum_modulus(attr);
+    char *c = mu_buf_write_reserve(buf, 1);
+    assert(c);
+    mu_buf_write_commit(buf, mu_cur_put_i8(c, value));
+    return 0;
+}
+
+int musvg_write_binary_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_id id = *(musvg_id*)attr_pointer(p, node_idx, attr);
+    musvg_write_binary_string(p, buf, id.name);
+    return 0;
+}
+
+int musvg_write_binary_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_length length = *(musvg_length*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, musvg_f32_write_fixed(p) ? 5 : 0);
+    assert(c && (c = musvg_cursor_put_floats(p, buf, c, &length.value, 1, 1)));
+    mu_buf_write_commit(buf, mu_cur_put_i8(c, length.units));
+    return 0;
+}
+
+int musvg_write_binary_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_color color = *(musvg_color*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, 5);
+    assert(c);
+    c = mu_cur_put_i8(c, (int8_t)color.type);
+    if (color.type == musvg_color_type_rgba) {
+        c = mu_cur_put_i32(c, (int32_t)color.data);
+    }
+    mu_buf_write_commit(buf, c);
+    if (color.type == musvg_color_type_url) {
+        musvg_write_binary_string(p, buf, color.data);
+    }
+    return 0;
+}
+
+int musvg_write_binary_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_transform xf = *(musvg_transform*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, 2 + (musvg_f32_write_fixed(p) ? 24 : 0));
+    assert(c);
+    c = mu_cur_put_i8(c, (int8_t)xf.type);
+    if (xf.type == musvg_transform_matrix) {
+        c = musvg_cursor_put_floats(p, buf, c, xf.xform, 6, 0);
+    } else {
+        c = mu_cur_put_i8(c, (int8_t)xf.nargs);
+        c = musvg_cursor_put_floats(p, buf, c, xf.args, xf.nargs, 0);
+    }
+    assert(c);
+    mu_buf_write_commit(buf, c);
+    return 0;
+}
+
+int musvg_write_binary_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_dasharray da = *(musvg_dasharray*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, 1 + (musvg_f32_write_fixed(p) ? 4 * da.count : 0));
+    assert(c);
+    c = mu_cur_put_i8(c, (int8_t)da.count);
+    assert((c = musvg_cursor_put_floats(p, buf, c, da.dashes, da.count, 0)));
+    mu_buf_write_commit(buf, c);
+    return 0;
+}
+
+int musvg_write_binary_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const float value = *(float*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, musvg_f32_write_fixed(p) ? 4 : 0);
+    assert(c && (c = musvg_cursor_put_floats(p, buf, c, &value, 1, 0)));
+    mu_buf_write_commit(buf, c);
+    return 0;
+}
+
+int musvg_write_binary_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_viewbox vb = *(musvg_viewbox*)attr_pointer(p, node_idx, attr);
+    const float v[4] = { vb.x, vb.y, vb.width, vb.height };
+    char *c = mu_buf_write_reserve(buf, musvg_f32_write_fixed(p) ? 16 : 0);
+    assert(c && (c = musvg_cursor_put_floats(p, buf, c, v, 4, 0)));
+    mu_buf_write_commit(buf, c);
+    return 0;
+}
+
+int musvg_write_binary_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_aspectratio ar = *(musvg_aspectratio*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, 3);
+    assert(c);
+    c = mu_cur_put_i8(c, ar.alignX);
+    c = mu_cur_put_i8(c, ar.alignY);
+    c = mu_cur_put_i8(c, ar.alignType);
+    mu_buf_write_commit(buf, c);
+    return 0;
+}
+
+int musvg_write_binary_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    if (p->grid_digits >= 0) return musvg_write_delta_path(p, buf, node_idx, attr);
+    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, mu_leb_max_length);
+    assert(c);
+    mu_buf_write_commit(buf, mu_cur_put_leb(c, ops.op_count));
+    for (musvg_index j = 0; j < ops.op_count; j++) {
+        const  musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
+        const  musvg_points *points = path_points_get(p, ops.op_offset + j);
+        c = mu_buf_write_reserve(buf, 1 + mu_leb_max_length);
+        assert(c);
+        c = mu_cur_put_i8(c, (int8_t)op->code);
+        c = mu_cur_put_leb(c, points->point_count);
+        musvg_cursor_put_points(p, buf, c, points->point_offset, points->point_count);
+    }
+    return 0;
+}
+
+int musvg_write_binary_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    if (p->grid_digits >= 0) return musvg_write_delta_points(p, buf, node_idx, attr);
+    musvg_points points = *(musvg_points*)attr_pointer(p, node_idx, attr);
+    char *c = mu_buf_write_reserve(buf, mu_leb_max_length);
+    assert(c);
+    c = mu_cur_put_leb(c, points.point_count);
+    musvg_cursor_put_points(p, buf, c, points.point_offset, points.point_count);
+    return 0;
+}
+
+static int musvg_write_delta_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
+    musvg_grid_pen pen = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } }, check = pen;
+    musvg_small mode = musvg_grid_mode_fixed;
+    ullong count = ops.op_count;
+    for (musvg_index j = 0; j < ops.op_count && mode == musvg_grid_mode_fixed; j++) {
+        const  musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
+        const  musvg_points *points = path_points_get(p, ops.op_offset + j);
+        if (!musvg_grid_path_fits(p, op->code, points->point_offset,
+                points->point_count, &check)) {
+            mode = musvg_grid_mode_float;
+        }
+    }
+    assert(!mu_leb_u64_write(buf, &count));
+    assert(mu_buf_write_i8(buf, (int8_t)mode));
+    for (musvg_index j = 0; j < ops.op_count; j++) {
+        const  musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
+        const  musvg_points *points = path_points_get(p, ops.op_offset + j);
+        ullong points_count = points->point_count;
+        assert(mu_buf_write_i8(buf, (int8_t)op->code));
+        assert(!mu_leb_u64_write(buf, &points_count));
+        if (mode == musvg_grid_mode_fixed) {
+            assert(musvg_grid_write(p, buf, op->code, points->point_offset,
+                points_count, &pen));
+        } else {
+            musvg_write_binary_floats(p, buf, points->point_offset, points_count);
+        }
+    }
+    return 0;
+}
+
+static int musvg_write_delta_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_points points = *(musvg_points*)attr_pointer(p, node_idx, attr);
+    musvg_grid_pen pen = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } }, check = pen;
+    ullong points_count = points.point_count;
+    musvg_small mode = musvg_grid_path_fits(p, musvg_path_lineto_abs,
+        points.point_offset, points_count, &check)
+        ? musvg_grid_mode_fixed : musvg_grid_mode_float;
+    assert(!mu_leb_u64_write(buf, &points_count));
+    assert(mu_buf_write_i8(buf, (int8_t)mode));
+    if (mode == musvg_grid_mode_fixed) {
+        assert(musvg_grid_write(p, buf, musvg_path_lineto_abs, points.point_offset,
+            points_count, &pen));
+    } else {
+        musvg_write_binary_floats(p, buf, points.point_offset, points_count);
+    }
+    return 0;
+}
+
+// attribute parsers
+
+int musvg_read_text_enum(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_small val = parse_enum(attr, s, len);
+    musvg_small *ptr = (musvg_small*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_id(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_id val = musvg_parse_id(p, s, len);
+    musvg_id *ptr = (musvg_id*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_length(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_length val = musvg_parse_length(s, s + len);
+    musvg_length *ptr = (musvg_length*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_color(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_color val = musvg_parse_color(p, s, s + len);
+    musvg_color *ptr = (musvg_color*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_transform(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_transform val = musvg_parse_transform(s, s + len);
+    musvg_transform *ptr = (musvg_transform*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_dasharray(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_dasharray val = musvg_parse_stroke_dasharray(s, s + len);
+    musvg_dasharray *ptr = (musvg_dasharray*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_float(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    float val = musvg_parse_float(s, s + len);
+    float *ptr = (float*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_viewbox(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_viewbox val = musvg_parse_viewbox(s, s + len);
+    musvg_viewbox *ptr = (musvg_viewbox*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_aspectratio(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_aspectratio val = musvg_parse_aspectratio(s, len);
+    musvg_aspectratio *ptr = (musvg_aspectratio*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_path(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_path_d val = musvg_parse_path_ops(p, s, s + len);
+    musvg_path_d *ptr = (musvg_path_d*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+int musvg_read_text_points(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_points val = musvg_parse_points(p, s, s + len);
+    musvg_points *ptr = (musvg_points*)attr_pointer(p, node_idx, attr);
+    *ptr = val;
+    return 0;
+}
+
+// text writers
+
+int musvg_write_text_enum(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_small enum_value = *attr_pointer(p, node_idx, attr) % enum_modulus(attr);
+    const char *enum_name = musvg_type_info_enum[attr].names[enum_value];
+    size_t enum_len = strlen(enum_name);
+    assert(mu_buf_write_bytes(buf, enum_name, enum_len) == enum_len);
+    return 0;
+}
+
+int musvg_write_text_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_id id = *(musvg_id*)attr_pointer(p, node_idx, attr);
+    const char* id_str = fetch_string(p, id.name);
+    const ullong id_len = strlen(id_str);
+    assert(mu_buf_write_bytes(buf, id_str, id_len) == id_len);
+    return 0;
+}
+
+int musvg_write_text_length(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_length length = *(musvg_length*)attr_pointer(p, node_idx, attr);
+    char str[64];
+    int len = musvg_format_float(str, length.value);
+    if (length.units != musvg_unit_default) {
+        len += snprintf(str + len, sizeof(str) - len, "%s",
+            musvg_unit_names[length.units]);
+    }
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    char str[128];
+    const musvg_color color = *(musvg_color*)attr_pointer(p, node_idx, attr);
+    if (color.type == musvg_color_type_url) {
+        const char* url_str = fetch_string(p, color.data);
+        int len = snprintf(str, sizeof(str), "url(#%s)", url_str);
+        assert(mu_buf_write_bytes(buf, str, len) == len);
+    } else if (color.type == musvg_color_type_rgba) {
+        const uint rgba = (uint)color.data;
+        int len = rgba >> 24
+            ? snprintf(str, sizeof(str), "#%06x%02x", rgba & 0xffffff, 255 - (rgba >> 24))
+            : snprintf(str, sizeof(str), "#%06x", rgba);
+        assert(mu_buf_write_bytes(buf, str, len) == len);
+    } else {
+        assert(mu_buf_write_bytes(buf, "none", 4) == 4);
+    }
+    return 0;
+}
+
+int musvg_write_text_transform(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_transform xf = *(musvg_transform*)attr_pointer(p, node_idx, attr);
+    char str[128];
+    int len = musvg_transform_string(str, sizeof(str), &xf);
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_dasharray(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_dasharray da = *(musvg_dasharray*)attr_pointer(p, node_idx, attr);
+    char str[128];
+    int len = musvg_dasharray_string(str, sizeof(str), &da);
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_float(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const float value = *(float*)attr_pointer(p, node_idx, attr);
+    char str[musvg_f2s_max_length];
+    int len = musvg_format_float(str, value);
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_viewbox(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_viewbox vb = *(musvg_viewbox*)attr_pointer(p, node_idx, attr);
+    char str[128];
+    int len = musvg_viewbox_string(str, sizeof(str), &vb);
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_aspectratio(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_aspectratio ar = *(musvg_aspectratio*)attr_pointer(p, node_idx, attr);
+    char str[128];
+    int len = musvg_aspectratio_string(str, sizeof(str), &ar);
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+    return 0;
+}
+
+int musvg_write_text_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
+    char last_code = 0;
+    for (musvg_index j = 0; j < ops.op_count; j++) {
+        /* path commands have at most 7 arguments so each command is
+         * formatted on the stack and written with a single copy */
+        char str[8 * musvg_f2s_max_length];
+        const musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
+        const musvg_points *points = path_points_get(p, ops.op_offset + j);
+        int8_t code = musvg_path_opcode_cmd_char(op->code);
+        int len = 0;
+        assert(points->point_count <= 7);
+        str[len++] = code != last_code ? code : ' ';
+        for (musvg_index k = 0; k < points->point_count; k++) {
+            if (k > 0) str[len++] = ',';
+            len += musvg_format_float(str + len, *points_get(p, points->point_offset + k));
+        }
+        assert(mu_buf_write_bytes(buf, str, len) == len);
+        last_code = code;
+    }
+    return 0;
+}
+
+int musvg_write_text_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_points points = *(musvg_points*)attr_pointer(p, node_idx, attr);
+    for (musvg_index j = 0; j < points.point_count; j++) {
+        char str[musvg_f2s_max_length + 1];
+        int len = 0;
+        if (j > 0) str[len++] = j % 2 ? ',' : ' ';
+        len += musvg_format_float(str + len, *points_get(p, points.point_offset + j));
+        assert(mu_buf_write_bytes(buf, str, len) == len);
+    }
+    return 0;
+}
+
+// type metadata
+
+typedef int (*musvg_attr_str_fn)(musvg_parser *p, const char *s, size_t len, musvg_index node_idx, musvg_attr attr);
+
+static const musvg_attr_str_fn musvg_text_parsers[] = {
+    [musvg_type_enum]        = &musvg_read_text_enum,
+    [musvg_type_id]          = &musvg_read_text_id,
+    [musvg_type_length]      = &musvg_read_text_length,
+    [musvg_type_color]       = &musvg_read_text_color,
+    [musvg_type_transform]   = &musvg_read_text_transform,
+    [musvg_type_dasharray]   = &musvg_read_text_dasharray,
+    [musvg_type_float]       = &musvg_read_text_float,
     [musvg_type_viewbox]     = &musvg_read_text_viewbox,
     [musvg_type_aspectratio] = &musvg_read_text_aspectratio,
     [musvg_type_path]        = &musvg_read_text_path,
     [musvg_type_points]      = &musvg_read_text_points,
 };
 
-typedef int (*musvg_attr_buf_fn)(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+typedef int (*musvg_attr_buf_fn)(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr);
+
+static const musvg_attr_buf_fn musvg_binary_parsers[] = {
+    [musvg_type_enum]        = &musvg_read_binary_enum,
+    [musvg_type_id]          = &musvg_read_binary_id,
+    [musvg_type_length]      = &musvg_read_binary_length,
+    [musvg_type_color]       = &musvg_read_binary_color,
+    [musvg_type_transform]   = &musvg_read_binary_transform,
+    [musvg_type_dasharray]   = &musvg_read_binary_dasharray,
+    [musvg_type_float]       = &musvg_read_binary_float,
+    [musvg_type_viewbox]     = &musvg_read_binary_viewbox,
+    [musvg_type_aspectratio] = &musvg_read_binary_aspectratio,
+    [musvg_type_path]        = &musvg_read_binary_path,
+    [musvg_type_points]      = &musvg_read_binary_points,
+};
+
+static const musvg_attr_buf_fn musvg_binary_emitters[] = {
+    [musvg_type_enum]        = &musvg_write_binary_enum,
+    [musvg_type_id]          = &musvg_write_binary_id,
+    [musvg_type_length]      = &musvg_write_binary_length,
+    [musvg_type_color]       = &musvg_write_binary_color,
+    [musvg_type_transform]   = &musvg_write_binary_transform,
+    [musvg_type_dasharray]   = &musvg_write_binary_dasharray,
+    [musvg_type_float]       = &musvg_write_binary_float,
+    [musvg_type_viewbox]     = &musvg_write_binary_viewbox,
+    [musvg_type_aspectratio] = &musvg_write_binary_aspectratio,
+    [musvg_type_path]        = &musvg_write_binary_path,
+    [musvg_type_points]      = &musvg_write_binary_points,
+};
+
+static const musvg_attr_buf_fn musvg_text_emitters[] = {
+    [musvg_type_enum]        = &musvg_write_text_enum,
+    [musvg_type_id]          = &musvg_write_text_id,
+    [musvg_type_length]      = &musvg_write_text_length,
+    [musvg_type_color]       = &musvg_write_text_color,
+    [musvg_type_transform]   = &musvg_write_text_transform,
+    [musvg_type_dasharray]   = &musvg_write_text_dasharray,
+    [musvg_type_float]       = &musvg_write_text_float,
+    [musvg_type_viewbox]     = &musvg_write_text_viewbox,
+    [musvg_type_aspectratio] = &musvg_write_text_aspectratio,
+    [musvg_type_path]        = &musvg_write_text_path,
+    [musvg_type_points]      = &musvg_write_text_points,
+};
+
+// binary style classes
+
+/*
+ * with style classes enabled, runs of presentation attributes repeated
+ * on several nodes are written once in a table following the string
+ * table, which is present when the header has musvg_binary_flag_classes.
+ * each entry is the LEB128 length of an attribute list in the
+ * node format. a node refers to an entry with the class marker and a
+ * LEB128 index in place of the run, so attribute order is preserved.
+ * readers decode an entry at its first use and give later nodes slots
+ * that share the decoded storage.
+ */
+enum { musvg_binary_class = 0x7f };
+
+static const char musvg_attr_presentation[musvg_attr_limit + 1] = {
+    [musvg_attr_display]           = 1,
+    [musvg_attr_fill]              = 1,
+    [musvg_attr_fill_opacity]      = 1,
+    [musvg_attr_fill_rule]         = 1,
+    [musvg_attr_font_size]         = 1,
+    [musvg_attr_stroke]            = 1,
+    [musvg_attr_stroke_width]      = 1,
+    [musvg_attr_stroke_dasharray]  = 1,
+    [musvg_attr_stroke_dashoffset] = 1,
+    [musvg_attr_stroke_opacity]    = 1,
+    [musvg_attr_stroke_linecap]    = 1,
+    [musvg_attr_stroke_linejoin]   = 1,
+    [musvg_attr_stroke_miterlimit] = 1,
+    [musvg_attr_stop_color]        = 1,
+    [musvg_attr_stop_opacity]      = 1,
+};
+
+typedef struct musvg_style_class musvg_style_class;
+typedef struct musvg_class_attr musvg_class_attr;
+
+struct musvg_style_class
+{
+    size_t offset;             /* attribute list in lists */
+    size_t length;             /* attribute list length */
+    size_t count;              /* nodes using the list, or decoded attributes */
+    size_t index;              /* table index, or first decoded attribute */
+};
+
+struct musvg_class_attr
+{
+    musvg_attr attr;
+    musvg_index storage;
+};
+
+struct musvg_class_table
+{
+    mu_buf *lists;             /* attribute lists */
+    array_buffer classes;      /* musvg_style_class */
+    array_buffer shared;       /* musvg_class_attr, decoded storage */
+    musvg_index *slots;        /* class plus one, by list hash */
+    musvg_index *node_class;   /* class plus one, by node */
+    size_t mask;
+};
+
+static void musvg_class_table_init(musvg_class_table *t)
+{
+    t->lists = mu_resizable_buf_new();
+    array_buffer_init(&t->classes, sizeof(musvg_style_class), 16);
+    array_buffer_init(&t->shared, sizeof(musvg_class_attr), 16);
+    t->slots = NULL;
+    t->node_class = NULL;
+    t->mask = 0;
+}
+
+static void musvg_class_table_destroy(musvg_class_table *t)
+{
+    mu_buf_destroy(t->lists);
+    array_buffer_destroy(&t->classes);
+    array_buffer_destroy(&t->shared);
+    free(t->slots);
+    free(t->node_class);
+}
+
+static musvg_style_class* musvg_class_get(musvg_class_table *t, size_t idx)
+{
+    return (musvg_style_class*)array_buffer_get(&t->classes, sizeof(musvg_style_class), idx);
+}
+
+/* finds the first run of presentation attributes in node slot order */
+static size_t musvg_class_run(musvg_parser *p, const musvg_index *slots, size_t count, size_t *start)
+{
+    size_t i = 0, j;
+    while (i < count && !musvg_attr_presentation[slot_type(p, slots[i])]) i++;
+    for (j = i; j < count && musvg_attr_presentation[slot_type(p, slots[j])]; j++);
+    *start = i;
+    return j - i;
+}
+
+/* returns the class of the list at offset in lists, adding it if absent */
+static size_t musvg_class_intern(musvg_class_table *t, size_t offset)
+{
+    const char *list = t->lists->data + offset;
+    const size_t length = t->lists->write_marker - offset;
+    size_t h = (size_t)musvg_string_hash(list, length) & t->mask;
+    for (; t->slots[h]; h = (h + 1) & t->mask) {
+        musvg_style_class *c = musvg_class_get(t, t->slots[h] - 1);
+        if (c->length == length && memcmp(t->lists->data + c->offset, list, length) == 0) {
+            t->lists->write_marker = offset;
+            c->count++;
+            return t->slots[h] - 1;
+        }
+    }
+    musvg_style_class c = { offset, length, 1, 0 };
+    t->slots[h] = array_buffer_add(&t->classes, sizeof(musvg_style_class), &c) + 1;
+    return t->slots[h] - 1;
+}
+
+/*
+ * gathers the presentation runs of every node. runs used by one node are
+ * left inline and the others are numbered in order of first use. values
+ * are written with the codec and string table of the body.
+ */
+static void musvg_class_table_collect(musvg_parser *p, musvg_class_table *t)
+{
+    size_t nodes = nodes_count(p), size = 2, count = 0;
+    while (size < nodes * 2) size <<= 1;
+    t->slots = (musvg_index*)calloc(size, sizeof(musvg_index));
+    t->node_class = (musvg_index*)calloc(nodes + 1, sizeof(musvg_index));
+    t->mask = size - 1;
+    for (musvg_index node_idx = 0; node_idx < nodes; node_idx++) {
+        musvg_index slots[64];
+        size_t sz = array_size(slots), start;
+        musvg_node_attr_slots(p, node_idx, slots, &sz);
+        size_t run = musvg_class_run(p, slots, sz, &start);
+        if (!run) continue;
+        size_t offset = t->lists->write_marker;
+        for (size_t i = start; i < start + run; i++) {
+            musvg_attr attr = slot_type(p, slots[i]);
+            musvg_attr_buf_fn fn = musvg_binary_emitters[musvg_attr_types[attr]];
+            mu_buf_write_i8(t->lists, attr);
+            fn(p, t->lists, node_idx, attr);
+        }
+        t->node_class[node_idx] = musvg_class_intern(t, offset) + 1;
+    }
+    for (size_t i = 0; i < array_buffer_count(&t->classes); i++) {
+        musvg_style_class *c = musvg_class_get(t, i);
+        c->index = c->count > 1 ? count++ : SIZE_MAX;
+    }
+}
+
+static void musvg_class_table_write(mu_buf *buf, musvg_class_table *t)
+{
+    ullong count = 0;
+    for (size_t i = 0; i < array_buffer_count(&t->classes); i++) {
+        count += musvg_class_get(t, i)->index != SIZE_MAX;
+    }
+    assert(!mu_leb_u64_write(buf, &count));
+    for (size_t i = 0; i < array_buffer_count(&t->classes); i++) {
+        musvg_style_class *c = musvg_class_get(t, i);
+        if (c->index == SIZE_MAX) continue;
+        const ullong length = c->length;
+        assert(!mu_leb_u64_write(buf, &length));
+        assert(mu_buf_write_bytes(buf, t->lists->data + c->offset, c->length) == c->length);
+    }
+}
+
+/* class of a node and the start of its run, or SIZE_MAX if it is inline */
+static size_t musvg_class_of(musvg_parser *p, musvg_index node_idx,
+    const musvg_index *slots, size_t count, size_t *start, size_t *run)
+{
+    musvg_class_table *t = p->class_table;
+    if (!t || !t->node_class || !t->node_class[node_idx]) return SIZE_MAX;
+    size_t index = musvg_class_get(t, t->node_class[node_idx] - 1)->index;
+    if (index != SIZE_MAX) *run = musvg_class_run(p, slots, count, start);
+    return index;
+}
+
+/* copies the attribute lists, which are decoded when first used */
+static int musvg_class_table_read(mu_buf *buf, musvg_class_table *t)
+{
+    ullong count, length;
+    if (mu_leb_u64_read(buf, &count) < 0) return -musvg_error_truncated;
+    for (ullong i = 0; i < count; i++) {
+        if (mu_leb_u64_read(buf, &length) < 0) return -musvg_error_truncated;
+        if (length > mu_buf_avaiable_read(buf) &&
+            (!buf->sync || buf->read_check(buf, length))) return -musvg_error_truncated;
+        musvg_style_class c = { t->lists->write_marker, length, 0, 0 };
+        if (mu_buf_resizable_check_write_capacity(t->lists, length) < 0) return -musvg_error_invalid;
+        if (mu_buf_read_bytes(buf, t->lists->data + c.offset, length) != length) {
+            return -musvg_error_truncated;
+        }
+        t->lists->write_marker = c.offset + length;
+        array_buffer_add(&t->classes, sizeof(musvg_style_class), &c);
+    }
+    return 0;
+}
+
+/* a reader of the same lists with nothing decoded, for a chunk parser */
+static void musvg_class_table_fork(musvg_class_table *t, musvg_class_table *doc)
+{
+    musvg_class_table_init(t);
+    const size_t length = doc->lists->write_marker;
+    assert(mu_buf_write_bytes(t->lists, doc->lists->data, length) == length);
+    for (size_t i = 0; i < array_buffer_count(&doc->classes); i++) {
+        musvg_style_class c = *musvg_class_get(doc, i);
+        c.count = c.index = 0;
+        array_buffer_add(&t->classes, sizeof(musvg_style_class), &c);
+    }
+}
+
+static int musvg_read_binary_class(musvg_parser *p, mu_buf *buf, musvg_index node_idx)
+{
+    musvg_class_table *t = p->class_table;
+    musvg_class_attr a;
+    musvg_small attr;
+    ullong idx;
+
+    if (mu_leb_u64_read(buf, &idx) < 0) return -1;
+    if (!t || idx >= array_buffer_count(&t->classes)) return -1;
+    musvg_style_class *c = musvg_class_get(t, idx);
+    if (c->count) {
+        for (size_t i = 0; i < c->count; i++) {
+            a = *(musvg_class_attr*)array_buffer_get(&t->shared,
+                sizeof(musvg_class_attr), c->index + i);
+            share_attr(p, node_idx, a.attr, a.storage);
+        }
+        return 0;
+    }
+
+    size_t first = array_buffer_count(&t->shared);
+    mu_buf *list = mu_buf_memory_new(t->lists->data + c->offset, c->length);
+    int ret = 0;
+    while (ret == 0 && mu_buf_read_i8(list, &attr)) {
+        attr = attr % (musvg_attr_limit + 1);
+        if (!musvg_attr_presentation[attr]) {
+            ret = -1;
+            break;
+        }
+        musvg_attr_buf_fn read_fn = musvg_binary_parsers[musvg_attr_types[attr]];
+        ret = read_fn(p, list, node_idx, as_attr(attr));
+        a.attr = as_attr(attr);
+        a.storage = find_attr(p, node_idx, a.attr);
+        array_buffer_add(&t->shared, sizeof(musvg_class_attr), &a);
+    }
+    mu_buf_destroy(list);
+    c = musvg_class_get(t, idx);
+    c->index = first;
+    c->count = array_buffer_count(&t->shared) - first;
+    /* later nodes share the storage, so a transcoder must not release it */
+    if (p->transcoder) musvg_transcode_keep(p);
+    return ret;
+}
+
+// binary header
+
+/*
+ * svgv, svgb and svgd files start with a header naming the body format,
+ * so a file written for another format or version is rejected before its
+ * tables are read. flags record the optional sections that follow.
+ *
+ *   magic                "musvg"
+ *   format               u8 musvg_format_t of the body
+ *   version              u8 musvg_binary_version
+ *   flags                u8 musvg_binary_flag_*
+ *   grid digits          i8 svgd coordinate grid, svgd only
+ *   string table         leb128 count, then leb128 length and bytes
+ *   class table          leb128 count, then leb128 length and bytes,
+ *                        with musvg_binary_flag_classes
+ */
+
+enum { musvg_binary_version = 1 };
+enum { musvg_binary_flag_classes = 1, musvg_binary_flags = 1 };
+
+static const char musvg_binary_magic[5] = { 'm','u','s','v','g' };
+
+static void musvg_binary_header_write(mu_buf *buf, musvg_format_t format,
+    int grid_digits, int flags)
+{
+    const size_t len = sizeof(musvg_binary_magic);
+    assert(mu_buf_write_bytes(buf, musvg_binary_magic, len) == len);
+    mu_buf_write_i8(buf, (int8_t)format);
+    mu_buf_write_i8(buf, (int8_t)musvg_binary_version);
+    mu_buf_write_i8(buf, (int8_t)flags);
+    if (format == musvg_format_binary_delta) mu_buf_write_i8(buf, (int8_t)grid_digits);
+}
+
+/* reads the header and the tables, setting the grid digits of svgd */
+static int musvg_binary_tables_read(musvg_parser *p, mu_buf *buf, musvg_format_t format,
+    musvg_string_table *t, musvg_class_table *ct)
+{
+    char magic[sizeof(musvg_binary_magic)];
+    int8_t fmt, version, flags, digits;
+
+    if (mu_buf_read_bytes(buf, magic, sizeof(magic)) != sizeof(magic) ||
+        !mu_buf_read_i8(buf, &fmt) || !mu_buf_read_i8(buf, &version) ||
+        !mu_buf_read_i8(buf, &flags)) {
+        return -musvg_error_truncated;
+    }
+    if (memcmp(magic, musvg_binary_magic, sizeof(magic)) != 0 || fmt != format ||
+        version != musvg_binary_version || (flags & ~musvg_binary_flags) != 0) {
+        return -musvg_error_format;
+    }
+    if (format == musvg_format_binary_delta) {
+        if (!mu_buf_read_i8(buf, &digits)) return -musvg_error_truncated;
+        if (digits < 0 || digits > musvg_grid_max_digits) return -musvg_error_value;
+        p->grid_digits = digits;
+    }
+    int ret = musvg_string_table_read(p, buf, t);
+    if (ret == 0 && (flags & musvg_binary_flag_classes)) {
+        ret = musvg_class_table_read(buf, ct);
+    }
+    return ret;
+}
+
+// SVG columnar binary format
+
+/*
+ * svgc splits the binary node stream into sections so that each can be
+ * decoded in bulk: element symbols with zero closing each element, zero
+ * terminated attribute symbols per node, scalar attribute values, path
+ * opcodes, 32-bit op and point counts, IEEE 754 path and polygon points
+ * and zero terminated id and url strings. the header holds the section
+ * lengths as LEB128 values. the decoder appends the opcode and point
+ * sections to path_ops and points in one pass, and attribute readers
+ * then assign offsets from running indices.
+ */
+
+enum musvg_column {
+    musvg_column_tree,
+    musvg_column_attrs,
+    musvg_column_values,
+    musvg_column_ops,
+    musvg_column_counts,
+    musvg_column_points,
+    musvg_column_strings,
+    musvg_column_count
+};
+
+struct musvg_columns
+{
+    mu_buf *buf[musvg_column_count];
+    musvg_index op_idx;        /* next path op while decoding */
+    musvg_index point_idx;     /* next point while decoding */
+};
+
+/*
+ * svgr holds the svgc sections, each compressed by the adaptive range
+ * coder with its own context model. four byte records in the count and
+ * point sections are modeled per byte lane. the header holds the raw
+ * and the coded section lengths as LEB128 values.
+ *
+ * before coding, each point is replaced by the difference between its
+ * binary32 bit pattern and that of the previous point on the same axis.
+ * neighbouring coordinates share their sign, exponent and high mantissa
+ * bits, so the differences are mostly small and their high bytes cheap.
+ */
+static const size_t musvg_entropy_lanes[musvg_column_count] = {
+    [musvg_column_tree] = 1,
+    [musvg_column_attrs] = 1,
+    [musvg_column_values] = 1,
+    [musvg_column_ops] = 1,
+    [musvg_column_counts] = 4,
+    [musvg_column_points] = 4,
+    [musvg_column_strings] = 1,
+};
+
+static uint musvg_entropy_load(const char *s)
+{
+    const unsigned char *u = (const unsigned char*)s;
+    return (uint)u[0] | (uint)u[1] << 8 | (uint)u[2] << 16 | (uint)u[3] << 24;
+}
+
+static void musvg_entropy_store(char *s, uint v)
+{
+    s[0] = (char)v; s[1] = (char)(v >> 8); s[2] = (char)(v >> 16); s[3] = (char)(v >> 24);
+}
+
+static void musvg_entropy_delta(char *data, size_t len)
+{
+    for (size_t i = len & ~(size_t)3; i >= 12; i -= 4) {
+        uint v = musvg_entropy_load(data + i - 4), w = musvg_entropy_load(data + i - 12);
+        musvg_entropy_store(data + i - 4, v - w);
+    }
+}
+
+static void musvg_entropy_undelta(char *data, size_t len)
+{
+    for (size_t i = 8; i + 4 <= len; i += 4) {
+        uint v = musvg_entropy_load(data + i), w = musvg_entropy_load(data + i - 8);
+        musvg_entropy_store(data + i, v + w);
+    }
+}
+
+static const char* musvg_columnar_read_string(musvg_parser *p, size_t *len)
+{
+    mu_buf *buf = p->columns->buf[musvg_column_strings];
+    const char *str = buf->data + buf->read_marker;
+    const char *end = memchr(str, 0, mu_buf_avaiable_read(buf));
+    assert(end);
+    buf->read_marker += end - str + 1;
+    *len = end - str;
+    return str;
+}
+
+static void musvg_columnar_write_string(musvg_parser *p, const char *str)
+{
+    mu_buf *buf = p->columns->buf[musvg_column_strings];
+    size_t len = strlen(str) + 1;
+    assert(mu_buf_write_bytes(buf, str, len) == len);
+}
+
+static uint musvg_columnar_read_count(musvg_parser *p)
+{
+    int32_t count = 0;
+    assert(mu_buf_read_i32(p->columns->buf[musvg_column_counts], &count));
+    return (uint)count;
+}
+
+static void musvg_columnar_write_count(musvg_parser *p, ullong count)
+{
+    assert(count <= UINT32_MAX);
+    assert(mu_buf_write_i32(p->columns->buf[musvg_column_counts], (int32_t)count));
+}
+
+static musvg_points musvg_columnar_read_points(musvg_parser *p)
+{
+    musvg_columns *c = p->columns;
+    musvg_points points = { c->point_idx, musvg_columnar_read_count(p) };
+    assert(points.point_count <= points_count(p) - c->point_idx);
+    c->point_idx += points.point_count;
+    return points;
+}
+
+static void musvg_columnar_write_points(musvg_parser *p, musvg_points points)
+{
+    mu_buf *buf = p->columns->buf[musvg_column_points];
+    musvg_columnar_write_count(p, points.point_count);
+    musvg_write_binary_floats(p, buf, points.point_offset, points.point_count);
+}
+
+int musvg_read_columnar_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    size_t len;
+    const char *str = musvg_columnar_read_string(p, &len);
+    musvg_id *id = (musvg_id*)attr_pointer(p, node_idx, attr);
+    *id = musvg_parse_id(p, str, len);
+    return 0;
+}
+
+int musvg_read_columnar_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_color *color = (musvg_color*)attr_pointer(p, node_idx, attr);
+    uint8_t type;
+    assert(mu_buf_read_i8(buf, (int8_t*)&type));
+    color->type = type;
+    if (color->type == musvg_color_type_rgba) {
+        int32_t col;
+        assert(mu_buf_read_i32(buf, &col));
+        color->data = (uint32_t)col;
+    } else if (color->type == musvg_color_type_url) {
+        size_t len;
+        const char *str = musvg_columnar_read_string(p, &len);
+        color->data = alloc_string(p, str, len);
+    }
+    return 0;
+}
+
+int musvg_read_columnar_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_columns *c = p->columns;
+    musvg_path_d *pd = (musvg_path_d*)attr_pointer(p, node_idx, attr);
+    musvg_path_d ops = { c->op_idx, musvg_columnar_read_count(p) };
+    assert(ops.op_count <= path_ops_count(p) - c->op_idx);
+    assert(path_points_count(p) == c->op_idx);
+    *pd = ops;
+    for (uint j = 0; j < ops.op_count; j++) {
+        musvg_points points = musvg_columnar_read_points(p);
+        path_points_add(p, &points);
+    }
+    c->op_idx += ops.op_count;
+    return 0;
+}
+
+int musvg_read_columnar_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_points *pp = (musvg_points*)attr_pointer(p, node_idx, attr);
+    *pp = musvg_columnar_read_points(p);
+    return 0;
+}
+
+int musvg_write_columnar_id(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_id id = *(musvg_id*)attr_pointer(p, node_idx, attr);
+    musvg_columnar_write_string(p, fetch_string(p, id.name));
+    return 0;
+}
+
+int musvg_write_columnar_color(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    const musvg_color color = *(musvg_color*)attr_pointer(p, node_idx, attr);
+    assert(mu_buf_write_i8(buf, (int8_t)color.type));
+    if (color.type == musvg_color_type_rgba) {
+        assert(mu_buf_write_i32(buf, (int32_t)color.data));
+    } else if (color.type == musvg_color_type_url) {
+        musvg_columnar_write_string(p, fetch_string(p, color.data));
+    }
+    return 0;
+}
+
+int musvg_write_columnar_path(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    mu_buf *ops_buf = p->columns->buf[musvg_column_ops];
+    musvg_path_d ops = *(musvg_path_d*)attr_pointer(p, node_idx, attr);
+    musvg_columnar_write_count(p, ops.op_count);
+    for (musvg_index j = 0; j < ops.op_count; j++) {
+        const musvg_path_op *op = path_ops_get(p, ops.op_offset + j);
+        assert(mu_buf_write_i8(ops_buf, (int8_t)op->code));
+        musvg_columnar_write_points(p, *path_points_get(p, ops.op_offset + j));
+    }
+    return 0;
+}
+
+int musvg_write_columnar_points(musvg_parser *p, mu_buf *buf, musvg_index node_idx, musvg_attr attr)
+{
+    musvg_columnar_write_points(p, *(musvg_points*)attr_pointer(p, node_idx, attr));
+    return 0;
+}
+
+static const musvg_attr_buf_fn musvg_columnar_parsers[] = {
+    [musvg_type_enum]        = &musvg_read_binary_enum,
+    [musvg_type_id]          = &musvg_read_columnar_id,
+    [musvg_type_length]      = &musvg_read_binary_length,
+    [musvg_type_color]       = &musvg_read_columnar_color,
+    [musvg_type_transform]   = &musvg_read_binary_transform,
+    [musvg_type_dasharray]   = &musvg_read_binary_dasharray,
+    [musvg_type_float]       = &musvg_read_binary_float,
+    [musvg_type_viewbox]     = &musvg_read_binary_viewbox,
+    [musvg_type_aspectratio] = &musvg_read_binary_aspectratio,
+    [musvg_type_path]        = &musvg_read_columnar_path,
+    [musvg_type_points]      = &musvg_read_columnar_points,
+};
+
+static const musvg_attr_buf_fn musvg_columnar_emitters[] = {
+    [musvg_type_enum]        = &musvg_write_binary_enum,
+    [musvg_type_id]          = &musvg_write_columnar_id,
+    [musvg_type_length]      = &musvg_write_binary_length,
+    [musvg_type_color]       = &musvg_write_columnar_color,
+    [musvg_type_transform]   = &musvg_write_binary_transform,
+    [musvg_type_dasharray]   = &musvg_write_binary_dasharray,
+    [musvg_type_float]       = &musvg_write_binary_float,
+    [musvg_type_viewbox]     = &musvg_write_binary_viewbox,
+    [musvg_type_aspectratio] = &musvg_write_binary_aspectratio,
+    [musvg_type_path]        = &musvg_write_columnar_path,
+    [musvg_type_points]      = &musvg_write_columnar_points,
+};
+
+// SVG attribute parsing
+
+static void musvg_parse_style(musvg_parser* p, musvg_index node_idx,
+    const char* str, size_t len);
+
+static int musvg_parse_attr(musvg_parser* p, musvg_index node_idx,
+    const char* name, size_t name_len, const char* value, size_t value_len)
+{
+    musvg_attr attr = musvg_parse_attr_name(name, name_len);
+    if (attr == musvg_attr_style) {
+        musvg_parse_style(p, node_idx, value, value_len);
+    } else if (attr != musvg_attr_none) {
+        musvg_attr_str_fn fn = musvg_text_parsers[musvg_attr_types[attr]];
+        debugf("musvg_parse_attr: %.*s := %.*s\n",
+            (int)name_len, name, (int)value_len, value);
+        return fn(p, value, value_len, node_idx, attr);
+    }
+    return 1;
+}
+
+/*
+ * style declarations are parsed in place as spans of the attribute value
+ * and dispatched straight to the typed parsers, so values have no length
+ * limit. a style property nested inside a style attribute is ignored.
+ */
+static int musvg_parse_name_value(musvg_parser* p, musvg_index node_idx,
+    const char* start, const char* end)
+{
+    const char *name_end, *val = start;
+
+    while (val < end && *val != ':') ++val;
+    if (val == end) return 1;
+
+    // Right Trim
+    name_end = val;
+    while (name_end > start && musvg_isspace(name_end[-1])) --name_end;
+
+    // Left Trim
+    ++val;
+    while (val < end && musvg_isspace(*val)) ++val;
+
+    musvg_attr attr = musvg_parse_attr_name(start, name_end - start);
+    if (attr == musvg_attr_none || attr == musvg_attr_style) return 1;
+
+    musvg_attr_str_fn fn = musvg_text_parsers[musvg_attr_types[attr]];
+    return fn(p, val, end - val, node_idx, attr);
+}
+
+static void musvg_parse_style(musvg_parser* p, musvg_index node_idx,
+    const char* str, size_t len)
+{
+    const char *start, *end, *limit = str + len;
+
+    debugf("musvg_parse_style: [%.*s]\n", (int)len, str);
+
+    while (str < limit)
+    {
+        // Left Trim
+        while(str < limit && musvg_isspace(*str)) ++str;
+        if (str == limit) break;
+        start = str;
+        end = memchr(str, ';', limit - str);
+        if (!end) end = limit;
+        str = end;
+
+        // Right Trim
+        while (end > start && musvg_isspace(end[-1])) --end;
+
+        if (end > start) musvg_parse_name_value(p, node_idx, start, end);
+        if (str < limit) ++str;
+    }
+}
+
+// SVG parser image
+
+/*
+ * the parser image is the parser arrays written end to end after a
+ * header holding the offset of each array from the start of the file.
+ * the arrays only contain indices, so an image can be mapped read-only
+ * at any address and the accessors used in place. an image is only
+ * readable by builds with the same byte order and node and slot layout.
+ */
+
+enum musvg_image_section {
+    musvg_image_nodes,
+    musvg_image_slots,
+    musvg_image_storage,
+    musvg_image_strings,
+    musvg_image_points,
+    musvg_image_path_ops,
+    musvg_image_path_points,
+    musvg_image_count
+};
+
+enum { musvg_image_version = 1, musvg_image_align = 16 };
+
+typedef struct musvg_image_header musvg_image_header;
+
+struct musvg_image_header
+{
+    char magic[8];                      /* "musvgimg" */
+    uint32_t version;                   /* musvg_image_version */
+    uint32_t byte_order;                /* 0x01020304 in writer byte order */
+    uint32_t node_size;                 /* sizeof(musvg_node) */
+    uint32_t slot_size;                 /* sizeof(musvg_slot) */
+    uint64_t offset[musvg_image_count]; /* section offset from file start */
+    uint64_t count[musvg_image_count];  /* section element count */
+};
+
+static const char musvg_image_magic[8] = { 'm','u','s','v','g','i','m','g' };
+
+static const size_t musvg_image_stride[musvg_image_count] = {
+    [musvg_image_nodes] = sizeof(musvg_node),
+    [musvg_image_slots] = sizeof(musvg_slot),
+    [musvg_image_storage] = 1,
+    [musvg_image_strings] = 1,
+    [musvg_image_points] = sizeof(float),
+    [musvg_image_path_ops] = sizeof(musvg_path_op),
+    [musvg_image_path_points] = sizeof(musvg_points),
+};
+
+/* returns the vector for a section or NULL for byte storage sections */
+static vec* musvg_image_vec(musvg_parser *p, size_t section)
+{
+    switch (section) {
+    case musvg_image_nodes: return &p->nodes;
+    case musvg_image_slots: return &p->slots;
+    case musvg_image_points: return &p->points;
+    case musvg_image_path_ops: return &p->path_ops;
+    case musvg_image_path_points: return &p->path_points;
+    default: return NULL;
+    }
+}
+
+static storage_buffer* musvg_image_bytes(musvg_parser *p, size_t section)
+{
+    return section == musvg_image_storage ? &p->storage : &p->strings;
+}
+
+static size_t musvg_image_section_count(musvg_parser *p, size_t section)
+{
+    vec *v = musvg_image_vec(p, section);
+    return v ? vec_count(v) : storage_buffer_size(musvg_image_bytes(p, section));
+}
+
+static void musvg_image_header_init(musvg_parser *p, musvg_image_header *h)
+{
+    size_t offset = sizeof(musvg_image_header);
+
+    memset(h, 0, sizeof(musvg_image_header));
+    memcpy(h->magic, musvg_image_magic, sizeof(h->magic));
+    h->version = musvg_image_version;
+    h->byte_order = 0x01020304;
+    h->node_size = sizeof(musvg_node);
+    h->slot_size = sizeof(musvg_slot);
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        offset = (offset + musvg_image_align - 1) & ~(size_t)(musvg_image_align - 1);
+        h->offset[i] = offset;
+        h->count[i] = musvg_image_section_count(p, i);
+        offset += h->count[i] * musvg_image_stride[i];
+    }
+}
+
+/* sections must be aligned, in order and within size bytes */
+static int musvg_image_header_check(const musvg_image_header *h, size_t size)
+{
+    uint64_t end = sizeof(musvg_image_header);
+
+    if (memcmp(h->magic, musvg_image_magic, sizeof(h->magic)) != 0 ||
+        h->version != musvg_image_version || h->byte_order != 0x01020304 ||
+        h->node_size != sizeof(musvg_node) || h->slot_size != sizeof(musvg_slot)) {
+        return -1;
+    }
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        if (h->offset[i] < end || h->offset[i] > size ||
+            h->offset[i] % musvg_image_align != 0 ||
+            h->count[i] > (size - h->offset[i]) / musvg_image_stride[i]) {
+            return -1;
+        }
+        end = h->offset[i] + h->count[i] * musvg_image_stride[i];
+    }
+    /* slot, storage and string index 0 are reserved */
+    if (h->count[musvg_image_slots] < 1 || h->count[musvg_image_storage] < 1 ||
+        h->count[musvg_image_strings] < 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static int musvg_image_check_range(size_t offset, size_t count, size_t limit)
+{
+    return offset <= limit && count <= limit - offset ? 0 : -musvg_error_count;
+}
+
+/* enums index their names and offsets stay inside their sections */
+static int musvg_image_check_value(musvg_parser *p, musvg_attr attr, const char *v)
+{
+    const unsigned char *u = (const unsigned char*)v;
+    size_t strings = strings_size(p);
+    switch (musvg_attr_types[attr]) {
+    case musvg_type_enum:
+        return *u < enum_modulus(attr) ? 0 : -musvg_error_value;
+    case musvg_type_id:
+        return ((musvg_id*)v)->name < strings ? 0 : -musvg_error_string;
+    case musvg_type_length:
+        return (uint)(unsigned char)((musvg_length*)v)->units <= musvg_unit_limit
+            ? 0 : -musvg_error_value;
+    case musvg_type_color:
+        if (((musvg_color*)v)->type > musvg_color_type_url) return -musvg_error_value;
+        return ((musvg_color*)v)->type != musvg_color_type_url ||
+            ((musvg_color*)v)->data < strings ? 0 : -musvg_error_string;
+    case musvg_type_transform:
+        if ((unsigned char)((musvg_transform*)v)->type > musvg_transform_skew_y) {
+            return -musvg_error_value;
+        }
+        /* a matrix keeps its arguments in xform */
+        return (unsigned char)((musvg_transform*)v)->nargs <=
+            (((musvg_transform*)v)->type == musvg_transform_matrix
+                ? array_size(((musvg_transform*)v)->xform)
+                : array_size(((musvg_transform*)v)->args)) ? 0 : -musvg_error_count;
+    case musvg_type_dasharray:
+        return (unsigned char)((musvg_dasharray*)v)->count <=
+            array_size(((musvg_dasharray*)v)->dashes) ? 0 : -musvg_error_count;
+    case musvg_type_aspectratio:
+        return (unsigned char)((musvg_aspectratio*)v)->alignX <= musvg_align_none &&
+               (unsigned char)((musvg_aspectratio*)v)->alignY <= musvg_align_none &&
+               (unsigned char)((musvg_aspectratio*)v)->alignType <= musvg_crop_none
+            ? 0 : -musvg_error_value;
+    case musvg_type_path:
+        return musvg_image_check_range(((musvg_path_d*)v)->op_offset,
+            ((musvg_path_d*)v)->op_count, path_ops_count(p));
+    case musvg_type_points:
+        return musvg_image_check_range(((musvg_points*)v)->point_offset,
+            ((musvg_points*)v)->point_count, points_count(p));
+    default:
+        return 0;
+    }
+}
+
+/*
+ * images are untrusted like the other formats, so one pass over the
+ * sections checks every index and offset before an image is served.
+ * sibling, parent and attribute links point backwards and child links
+ * forwards, so walks over the tree terminate, and each child names its
+ * parent, so the nesting depth follows from the parent links.
+ */
+static int musvg_image_check(musvg_parser *p)
+{
+    size_t nodes = nodes_count(p), slots = slots_count(p);
+    size_t storage = storage_size(p), points = points_count(p);
+    size_t ops = path_ops_count(p);
+    int ret = 0;
+
+    /* strings are terminated, so any offset in the section is a string */
+    if (*(char*)strings_get(p, strings_size(p) - 1) != '\0') return -musvg_error_string;
+    if (path_points_count(p) != ops) return -musvg_error_count;
+    for (size_t i = 0; i < ops; i++) {
+        uint code = (unsigned char)path_ops_get(p, i)->code;
+        const musvg_points *pp = path_points_get(p, i);
+        if (code > musvg_path_curveto_quadratic_smooth_rel) return -musvg_error_value;
+        if (pp->point_count != musvg_path_opcode_arg_count(code)) return -musvg_error_count;
+        if ((ret = musvg_image_check_range(pp->point_offset, pp->point_count, points)) < 0) {
+            return ret;
+        }
+    }
+    for (size_t i = 1; i < slots; i++) {
+        uint attr = slot_type(p, i);
+        musvg_index offset = slot_storage(p, i);
+        if (attr == musvg_attr_none || attr > musvg_attr_limit) return -musvg_error_attr;
+        if (musvg_attr_types[attr] == musvg_type_enum && !musvg_type_info_enum[attr].names) {
+            return -musvg_error_attr;
+        }
+        const musvg_type_meta *m = musvg_type_storage + musvg_attr_types[attr];
+        if (slot_left(p, i) >= i || offset == 0 || offset % m->align != 0 ||
+            musvg_image_check_range(offset, m->size, storage) < 0) {
+            return -musvg_error_invalid;
+        }
+        if ((ret = musvg_image_check_value(p, as_attr(attr), storage_get(p, offset))) < 0) {
+            return ret;
+        }
+    }
+
+    unsigned short *depth = (unsigned short*)malloc(nodes * sizeof(unsigned short) + 1);
+    for (size_t i = 0; i < nodes && ret == 0; i++) {
+        musvg_index left = node_left(p, i), up = node_up(p, i);
+        musvg_index down = node_down(p, i), attr = node_attr(p, i);
+        if (node_type(p, i) > musvg_element_limit) {
+            ret = -musvg_error_element;
+        } else if (attr >= slots || (i == 0 ? left || up : left >= i || up >= i) ||
+                   (down && (down <= i || down >= nodes || node_up(p, down) != i)) ||
+                   (left && node_up(p, left) != up)) {
+            ret = -musvg_error_invalid;
+        } else if ((depth[i] = i ? depth[up] + 1 : 1) > musvg_max_depth) {
+            ret = -musvg_error_depth;
+        }
+    }
+    free(depth);
+    return ret;
+}
+
+/* writes len bytes in pieces that fit buffered writers */
+static void musvg_write_pieces(mu_buf *buf, const char *data, size_t len)
+{
+    for (size_t o = 0, n; o < len; o += n) {
+        n = len - o < buf->buffer_size ? len - o : buf->buffer_size;
+        assert(mu_buf_write_bytes(buf, data + o, n) == n);
+    }
+}
+
+/* reads len bytes in pieces that fit buffered readers, skipping if NULL */
+static int musvg_read_pieces(mu_buf *buf, char *data, size_t len)
+{
+    char skip[musvg_image_align];
+    for (size_t o = 0, n; o < len; o += n) {
+        n = len - o < buf->buffer_size ? len - o : buf->buffer_size;
+        if (!data && n > sizeof(skip)) n = sizeof(skip);
+        if (mu_buf_read_bytes(buf, data ? data + o : skip, n) != n) return -1;
+    }
+    return 0;
+}
+
+void musvg_emit_image(musvg_parser* p, mu_buf *buf)
+{
+    static const char zero[musvg_image_align];
+    musvg_image_header h;
+    uint64_t offset = sizeof(h);
+
+    musvg_image_header_init(p, &h);
+    musvg_write_pieces(buf, (const char*)&h, sizeof(h));
+
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        size_t stride = musvg_image_stride[i], count = h.count[i];
+        vec *v = musvg_image_vec(p, i);
+        musvg_write_pieces(buf, zero, h.offset[i] - offset);
+        if (v) {
+            /* extent k starts at index 2^k-1 and holds 2^k elements */
+            for (size_t idx = 0, n; idx < count; idx += n) {
+                n = count - idx < idx + 1 ? count - idx : idx + 1;
+                assert(vec_linear(v, idx, n));
+                musvg_write_pieces(buf, (const char*)vec_get(v, stride, idx), n * stride);
+            }
+        } else {
+            musvg_write_pieces(buf, storage_buffer_get(musvg_image_bytes(p, i), 0), count);
+        }
+        offset = h.offset[i] + count * stride;
+    }
+}
+
+/* copies an image from a stream into an empty parser */
+int musvg_parse_image(musvg_parser* p, mu_buf *buf)
+{
+    musvg_image_header h;
+    uint64_t offset = sizeof(h);
+
+    if (musvg_read_pieces(buf, (char*)&h, sizeof(h)) < 0) return -1;
+    if (musvg_image_header_check(&h, SIZE_MAX) < 0) return -1;
+    if (nodes_count(p) != 0) return -1;
+
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        size_t stride = musvg_image_stride[i], count = h.count[i];
+        size_t reserved = musvg_image_section_count(p, i);
+        vec *v = musvg_image_vec(p, i);
+
+        /* the parser already holds the reserved elements */
+        if (musvg_read_pieces(buf, NULL, h.offset[i] - offset + reserved * stride) < 0) {
+            return -1;
+        }
+        if (v) {
+            size_t idx = count > reserved ? vec_alloc(v, stride, count - reserved) : count, n;
+            for (; idx < count; idx += n) {
+                char *dst = (char*)vec_span(v, stride, idx, &n);
+                if (n > count - idx) n = count - idx;
+                if (musvg_read_pieces(buf, dst, n * stride) < 0) return -1;
+            }
+        } else {
+            storage_buffer *sb = musvg_image_bytes(p, i);
+            size_t idx = storage_buffer_alloc(sb, count - reserved, 1);
+            assert(idx == reserved);
+            if (musvg_read_pieces(buf, storage_buffer_get(sb, idx), count - reserved) < 0) {
+                return -1;
+            }
+        }
+        offset = h.offset[i] + count * stride;
+    }
+    return musvg_image_check(p);
+}
+
+static void musvg_image_release(musvg_span image)
+{
+#ifndef _WIN32
+    munmap(image.data, image.size);
+#else
+    free(image.data);
+#endif
+}
+
+static void musvg_image_unmap_sections(musvg_parser *p)
+{
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        vec *v = musvg_image_vec(p, i);
+        if (v) {
+            vec_unmap(v);
+        } else {
+            storage_buffer_unmap(musvg_image_bytes(p, i));
+        }
+    }
+}
+
+/* points the parser arrays into an image without copying */
+static int musvg_image_map(musvg_parser *p, musvg_span image)
+{
+    musvg_image_header h;
+    int ret;
+
+    if (image.size < sizeof(h)) return -1;
+    memcpy(&h, image.data, sizeof(h));
+    if (musvg_image_header_check(&h, image.size) < 0) return -1;
+
+    for (size_t i = 0; i < musvg_image_count; i++) {
+        vec *v = musvg_image_vec(p, i);
+        char *data = image.data + h.offset[i];
+        if (v) {
+            vec_destroy(v);
+            vec_map(v, musvg_image_stride[i], data, h.count[i]);
+        } else {
+            storage_buffer *sb = musvg_image_bytes(p, i);
+            storage_buffer_destroy(sb);
+            storage_buffer_map(sb, data, h.count[i]);
+        }
+    }
+    if ((ret = musvg_image_check(p)) < 0) {
+        musvg_image_unmap_sections(p);
+        return ret;
+    }
+    p->image = image;
+    return 0;
+}
+
+static void musvg_image_unmap(musvg_parser *p)
+{
+    musvg_image_unmap_sections(p);
+    musvg_image_release(p->image);
+    p->image.data = NULL;
+    p->image.size = 0;
+}
+
+// binary subtree index
+
+/*
+ * an indexed svgv, svgb or svgd file is followed by a footer recording
+ * the byte range and node range of each child of the root element, so a
+ * reader can seek to one subtree or decode subtrees concurrently. the
+ * footer ends with a fixed size trailer holding the float codec, so the
+ * subtrees can be decoded without the preceding stream. sequential
+ * readers stop when the root element closes and never see the footer.
+ *
+ *   subtree entries      leb128 offset, length, first node, node count
+ *   index offset         u64 offset of the first entry
+ *   subtree count        u32
+ *   format               u8 musvg_format_t of the body
+ *   grid digits          i8 svgd coordinate grid or -1
+ *   body offset          u32 offset of the root element
+ *   magic                "musvgidx"
+ */
+
+enum { musvg_subtree_trailer_size = 26 };
+
+static const char musvg_subtree_magic[8] = { 'm','u','s','v','g','i','d','x' };
+
+typedef struct musvg_subtree musvg_subtree;
+typedef struct musvg_subtree_index musvg_subtree_index;
+
+struct musvg_subtree
+{
+    ullong offset;             /* byte offset of the subtree */
+    ullong length;             /* byte length of the subtree */
+    ullong first_node;         /* document order index of the subtree root */
+    ullong node_count;         /* nodes in the subtree */
+};
+
+struct musvg_subtree_index
+{
+    ullong index_offset;       /* end of the body */
+    size_t count;              /* number of subtrees */
+    musvg_format_t format;     /* body format */
+    int grid_digits;           /* svgd coordinate grid or -1 */
+    size_t body_offset;        /* offset of the root element */
+    musvg_subtree *subtrees;
+};
+
+static void musvg_subtree_index_write(mu_buf *buf, musvg_subtree_index *ix)
+{
+    for (size_t i = 0; i < ix->count; i++) {
+        musvg_subtree *s = ix->subtrees + i;
+        assert(!mu_leb_u64_write(buf, &s->offset));
+        assert(!mu_leb_u64_write(buf, &s->length));
+        assert(!mu_leb_u64_write(buf, &s->first_node));
+        assert(!mu_leb_u64_write(buf, &s->node_count));
+    }
+    mu_buf_write_i64(buf, (int64_t)ix->index_offset);
+    mu_buf_write_i32(buf, (int32_t)ix->count);
+    mu_buf_write_i8(buf, (int8_t)ix->format);
+    mu_buf_write_i8(buf, (int8_t)ix->grid_digits);
+    mu_buf_write_i32(buf, (int32_t)ix->body_offset);
+    musvg_write_pieces(buf, musvg_subtree_magic, sizeof(musvg_subtree_magic));
+}
+
+/*
+ * reads the footer of a file held in a memory buffer. returns -1 if the
+ * file has no footer, it was written for another format, or the subtree
+ * ranges are not in document order within the body.
+ */
+static int musvg_subtree_index_read(mu_buf *buf, musvg_format_t format,
+    musvg_subtree_index *ix)
+{
+    const size_t size = buf->write_marker;
+    int64_t index_offset;
+    int32_t count;
+    int8_t fmt, digits;
+    int32_t body_offset;
+    ullong end;
+
+    memset(ix, 0, sizeof(musvg_subtree_index));
+    if (buf->sync || size < musvg_subtree_trailer_size) return -1;
+    if (memcmp(buf->data + size - sizeof(musvg_subtree_magic), musvg_subtree_magic,
+            sizeof(musvg_subtree_magic)) != 0) {
+        return -1;
+    }
+
+    mu_buf *tb = mu_buf_memory_new(buf->data + size - musvg_subtree_trailer_size,
+        musvg_subtree_trailer_size);
+    mu_buf_read_i64(tb, &index_offset);
+    mu_buf_read_i32(tb, &count);
+    mu_buf_read_i8(tb, &fmt);
+    mu_buf_read_i8(tb, &digits);
+    mu_buf_read_i32(tb, &body_offset);
+    mu_buf_destroy(tb);
+
+    /* each entry is at least four bytes */
+    const size_t footer_end = size - musvg_subtree_trailer_size;
+    if (fmt != format || index_offset < 0 || (ullong)index_offset > footer_end ||
+        count < 0 || (size_t)count > (footer_end - index_offset) / 4 ||
+        digits > musvg_grid_max_digits || body_offset < 0 ||
+        (ullong)body_offset > (ullong)index_offset) {
+        return -1;
+    }
+    ix->index_offset = index_offset;
+    ix->count = count;
+    ix->format = format;
+    ix->grid_digits = digits < 0 ? -1 : digits;
+    ix->body_offset = body_offset;
+    ix->subtrees = (musvg_subtree*)malloc(count * sizeof(musvg_subtree) + 1);
+
+    mu_buf *eb = mu_buf_memory_new(buf->data + index_offset, footer_end - index_offset);
+    end = ix->body_offset;
+    for (size_t i = 0; i < ix->count; i++) {
+        musvg_subtree *s = ix->subtrees + i;
+        if (mu_leb_u64_read(eb, &s->offset) < 0 || mu_leb_u64_read(eb, &s->length) < 0 ||
+            mu_leb_u64_read(eb, &s->first_node) < 0 ||
+            mu_leb_u64_read(eb, &s->node_count) < 0 ||
+            s->offset < end || s->length > ix->index_offset - s->offset) {
+            mu_buf_destroy(eb);
+            free(ix->subtrees);
+            ix->subtrees = NULL;
+            return -1;
+        }
+        end = s->offset + s->length;
+    }
+    mu_buf_destroy(eb);
+    return 0;
+}
+
+// SVG emitters
+
+void musvg_emit_text_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
+    mu_buf_write_format(buf, "node %s {\n",
+        musvg_element_names[node_type(p, node_idx)]);
+    musvg_index slots[64];
+    size_t sz = array_size(slots);
+    musvg_node_attr_slots(p, node_idx, slots, &sz);
+    for (size_t i = 0; i < sz; i++) {
+        musvg_attr attr = slot_type(p, slots[i]);
+        musvg_attr_buf_fn fn = musvg_text_emitters[musvg_attr_types[attr]];
+        for (int d = 0; d < depth + 1; d++) mu_buf_write_string(buf, "\t");
+        mu_buf_write_format(buf, "attr %s \"", musvg_attribute_names[attr]);
+        fn(p, buf, node_idx, attr);
+        mu_buf_write_string(buf, "\";\n");
+    }
+}
+
+void musvg_emit_text_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
+    mu_buf_write_string(buf, "};\n");
+}
+
+void musvg_emit_xml_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
+    mu_buf_write_i8(buf, '<');
+    mu_buf_write_string(buf, musvg_element_names[node_type(p, node_idx)]);
+    musvg_index slots[64];
+    size_t sz = array_size(slots);
+    musvg_node_attr_slots(p, node_idx, slots, &sz);
+    for (size_t i = 0; i < sz; i++) {
+        musvg_attr attr = slot_type(p, slots[i]);
+        musvg_attr_buf_fn fn = musvg_text_emitters[musvg_attr_types[attr]];
+        mu_buf_write_i8(buf, ' ');
+        mu_buf_write_string(buf, musvg_attribute_names[attr]);
+        mu_buf_write_string(buf, "=\"");
+        fn(p, buf, node_idx, attr);
+        mu_buf_write_i8(buf, '"');
+    }
+    if (close) mu_buf_write_i8(buf, '/');
+    mu_buf_write_string(buf, ">\n\0");
+}
+
+void musvg_emit_xml_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    if (close) return;
+    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
+    mu_buf_write_format(buf, "</%s>\n", musvg_element_names[node_type(p, node_idx)]);
+}
+
+void musvg_emit_binary_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    char *c = mu_buf_write_reserve(buf, 1);
+    assert(c);
+    mu_buf_write_commit(buf, mu_cur_put_i8(c, (char)node_type(p, node_idx)));
+
+    musvg_index slots[64];
+    size_t sz = array_size(slots), start = 0, run = 0;
+    musvg_node_attr_slots(p, node_idx, slots, &sz);
+    ullong index = musvg_class_of(p, node_idx, slots, sz, &start, &run);
+    for (size_t i = 0; i < sz; i++) {
+        if (run && i == start) {
+            assert((c = mu_buf_write_reserve(buf, 1 + mu_leb_max_length)));
+            c = mu_cur_put_i8(c, musvg_binary_class);
+            mu_buf_write_commit(buf, mu_cur_put_leb(c, index));
+            i += run - 1;
+            continue;
+        }
+        musvg_attr attr = slot_type(p, slots[i]);
+        musvg_attr_buf_fn fn = musvg_binary_emitters[musvg_attr_types[attr]];
+        assert((c = mu_buf_write_reserve(buf, 1)));
+        mu_buf_write_commit(buf, mu_cur_put_i8(c, attr));
+        fn(p, buf, node_idx, attr);
+    }
+    assert((c = mu_buf_write_reserve(buf, 1)));
+    mu_buf_write_commit(buf, mu_cur_put_i8(c, musvg_attr_none));
+}
+
+void musvg_emit_binary_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    mu_buf *buf = (mu_buf *)userdata;
+    char *c = mu_buf_write_reserve(buf, 1);
+    assert(c);
+    mu_buf_write_commit(buf, mu_cur_put_i8(c, musvg_element_none));
+}
+
+void musvg_visit_recurse(musvg_parser* p, void *userdata, musvg_index node_idx, uint d,
+    musvg_node_visit_fn begin_fn, musvg_node_visit_fn end_fn)
+{
+    musvg_index down_idx, left_idx = node_idx;
+    llong count = 0, i = 0;
+    do {
+        count++;
+        left_idx = node_left(p, left_idx);
+    } while (left_idx);
+    musvg_index node_indices[count];
+    left_idx = node_idx;
+    do {
+        left_idx = node_left(p, (node_indices[i++] = left_idx));
+    } while (left_idx);
+    while (i-- > 0) {
+        left_idx = node_indices[i];
+        down_idx = node_down(p, left_idx);
+        int has_depth = !!down_idx;
+        if (begin_fn) begin_fn(p, userdata, left_idx, d, !has_depth);
+        if (has_depth) {
+            musvg_visit_recurse(p, userdata, down_idx, d + 1, begin_fn, end_fn);
+        }
+        if (end_fn) end_fn(p, userdata, left_idx, d, !has_depth);
+    }
+}
+
+void musvg_visit(musvg_parser* p, void *userdata, musvg_node_visit_fn begin_fn, musvg_node_visit_fn end_fn)
+{
+    /*
+     * currently we construct the entire output in memory, however, it will be
+     * possible to use the buffer size check callback to incrementally flush.
+     */
+    if (nodes_count(p) == 0) return;
+    musvg_visit_recurse(p, userdata, 0, 0, begin_fn, end_fn);
+}
+
+typedef struct musvg_subtree_writer musvg_subtree_writer;
+
+struct musvg_subtree_writer
+{
+    mu_buf *buf;               /* body */
+    size_t body_offset;        /* bytes written before the body */
+    array_buffer subtrees;     /* musvg_subtree */
+    ullong node_count;         /* nodes emitted so far */
+};
+
+static void musvg_subtree_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    musvg_subtree_writer *w = (musvg_subtree_writer *)userdata;
+    if (depth == 1) {
+        musvg_subtree s = { w->body_offset + w->buf->write_marker, 0, w->node_count, 0 };
+        array_buffer_add(&w->subtrees, sizeof(musvg_subtree), &s);
+    }
+    w->node_count++;
+    musvg_emit_binary_begin(p, w->buf, node_idx, depth, close);
+}
+
+static void musvg_subtree_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    musvg_subtree_writer *w = (musvg_subtree_writer *)userdata;
+    musvg_emit_binary_end(p, w->buf, node_idx, depth, close);
+    if (depth == 1) {
+        size_t last = array_buffer_count(&w->subtrees) - 1;
+        musvg_subtree *s = (musvg_subtree*)array_buffer_get(&w->subtrees, sizeof(musvg_subtree), last);
+        s->length = w->body_offset + w->buf->write_marker - s->offset;
+        s->node_count = w->node_count - s->first_node;
+    }
+}
+
+/*
+ * emits the nodes, followed by the subtree index if it is enabled. the
+ * nodes are built in memory so that the subtree offsets are known.
+ */
+static void musvg_emit_binary_nodes(musvg_parser* p, mu_buf *buf,
+    musvg_format_t format, size_t body_offset)
+{
+    if (!p->subtree_index) {
+        musvg_visit(p, buf, musvg_emit_binary_begin, musvg_emit_binary_end);
+        return;
+    }
+
+    musvg_subtree_writer w = { mu_resizable_buf_new(), body_offset };
+    array_buffer_init(&w.subtrees, sizeof(musvg_subtree), 16);
+    musvg_visit(p, &w, musvg_subtree_begin, musvg_subtree_end);
+    musvg_write_pieces(buf, w.buf->data, w.buf->write_marker);
+
+    musvg_subtree_index ix = {
+        body_offset + w.buf->write_marker, array_buffer_count(&w.subtrees),
+        format, p->grid_digits, body_offset, (musvg_subtree*)w.subtrees.data
+    };
+    musvg_subtree_index_write(buf, &ix);
+    array_buffer_destroy(&w.subtrees);
+    mu_buf_destroy(w.buf);
+}
+
+/* emits the header, the string and class tables and the body that refers to them */
+static void musvg_emit_binary_body(musvg_parser* p, mu_buf *buf, musvg_format_t format)
+{
+    musvg_string_table t;
+    musvg_class_table ct;
+    musvg_string_table_init(&t);
+    musvg_string_table_collect(p, &t);
+    musvg_class_table_init(&ct);
+    mu_buf *tables = mu_resizable_buf_new();
+    int flags = p->style_classes ? musvg_binary_flag_classes : 0;
+    musvg_binary_header_write(tables, format, p->grid_digits, flags);
+    musvg_string_table_write(p, tables, &t);
+    p->string_table = &t;
+    if (p->style_classes) {
+        musvg_class_table_collect(p, &ct);
+        musvg_class_table_write(tables, &ct);
+    }
+    musvg_write_pieces(buf, tables->data, tables->write_marker);
+    size_t body_offset = tables->write_marker;
+    mu_buf_destroy(tables);
+    p->class_table = &ct;
+    musvg_emit_binary_nodes(p, buf, format, body_offset);
+    p->class_table = NULL;
+    p->string_table = NULL;
+    musvg_class_table_destroy(&ct);
+    musvg_string_table_destroy(&t);
+}
+
+void musvg_emit_text(musvg_parser* p, mu_buf *buf)
+{
+    musvg_visit(p, buf, musvg_emit_text_begin, musvg_emit_text_end);
+}
+
+void musvg_emit_xml(musvg_parser* p, mu_buf *buf)
+{
+    musvg_visit(p, buf, musvg_emit_xml_begin, musvg_emit_xml_end);
+}
+
+void musvg_emit_binary_vf(musvg_parser* p, mu_buf *buf)
+{
+    p->f32_write = mu_vf128_f32_write_byval;
+    p->f32_write_vec = mu_vf128_f32_write_vec;
+    musvg_emit_binary_body(p, buf, musvg_format_binary_vf);
+}
+
+void musvg_emit_binary_ieee(musvg_parser* p, mu_buf *buf)
+{
+    p->f32_write = mu_ieee754_f32_write_byval;
+    p->f32_write_vec = mu_ieee754_f32_write_vec;
+    musvg_emit_binary_body(p, buf, musvg_format_binary_ieee);
+}
+
+void musvg_emit_columnar_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    musvg_columns *c = (musvg_columns *)userdata;
+    mu_buf *attrs = c->buf[musvg_column_attrs];
+    mu_buf_write_i8(c->buf[musvg_column_tree], (char)node_type(p, node_idx));
+
+    musvg_index slots[64];
+    size_t sz = array_size(slots);
+    musvg_node_attr_slots(p, node_idx, slots, &sz);
+    for (size_t i = 0; i < sz; i++) {
+        musvg_attr attr = slot_type(p, slots[i]);
+        musvg_attr_buf_fn fn = musvg_columnar_emitters[musvg_attr_types[attr]];
+        mu_buf_write_i8(attrs, attr);
+        fn(p, c->buf[musvg_column_values], node_idx, attr);
+    }
+    mu_buf_write_i8(attrs, musvg_attr_none);
+}
+
+void musvg_emit_columnar_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+{
+    musvg_columns *c = (musvg_columns *)userdata;
+    mu_buf_write_i8(c->buf[musvg_column_tree], musvg_element_none);
+}
+
+static void musvg_emit_columns(musvg_parser* p, musvg_columns *c)
+{
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        c->buf[i] = mu_resizable_buf_new();
+    }
+    p->f32_write = mu_ieee754_f32_write_byval;
+    p->f32_write_vec = mu_ieee754_f32_write_vec;
+    p->columns = c;
+    musvg_visit(p, c, musvg_emit_columnar_begin, musvg_emit_columnar_end);
+    p->columns = NULL;
+}
+
+void musvg_emit_binary_columnar(musvg_parser* p, mu_buf *buf)
+{
+    musvg_columns c = { 0 };
+    musvg_emit_columns(p, &c);
+
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        ullong len = c.buf[i]->write_marker;
+        assert(!mu_leb_u64_write(buf, &len));
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        musvg_write_pieces(buf, c.buf[i]->data, c.buf[i]->write_marker);
+        mu_buf_destroy(c.buf[i]);
+    }
+}
+
+void musvg_emit_binary_entropy(musvg_parser* p, mu_buf *buf)
+{
+    musvg_columns c = { 0 };
+    mu_buf *coded[musvg_column_count];
+    musvg_emit_columns(p, &c);
+    musvg_entropy_delta(c.buf[musvg_column_points]->data,
+        c.buf[musvg_column_points]->write_marker);
+
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        coded[i] = mu_resizable_buf_new();
+        assert(!mu_rc_encode_bytes(coded[i], c.buf[i]->data, c.buf[i]->write_marker,
+            musvg_entropy_lanes[i]));
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        ullong len = c.buf[i]->write_marker;
+        assert(!mu_leb_u64_write(buf, &len));
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        ullong len = coded[i]->write_marker;
+        assert(!mu_leb_u64_write(buf, &len));
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        musvg_write_pieces(buf, coded[i]->data, coded[i]->write_marker);
+        mu_buf_destroy(coded[i]);
+        mu_buf_destroy(c.buf[i]);
+    }
+}
+
+void musvg_emit_binary_delta(musvg_parser* p, mu_buf *buf)
+{
+    p->f32_write = mu_vf128_f32_write_byval;
+    p->f32_write_vec = mu_vf128_f32_write_vec;
+    p->grid_digits = p->grid_precision < 0 ? musvg_grid_digits(p, 0, 0) : p->grid_precision;
+    debugf("musvg_emit_binary_delta: grid_digits=%d\n", p->grid_digits);
+    musvg_emit_binary_body(p, buf, musvg_format_binary_delta);
+    p->grid_digits = -1;
+}
+
+int musvg_emit_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf)
+{
+    switch (format) {
+    case musvg_format_text:        musvg_emit_text(p, buf);        break;
+    case musvg_format_xml:         musvg_emit_xml(p, buf);         break;
+    case musvg_format_binary_vf:   musvg_emit_binary_vf(p, buf);   break;
+    case musvg_format_binary_ieee: musvg_emit_binary_ieee(p, buf); break;
+    case musvg_format_binary_delta: musvg_emit_binary_delta(p, buf); break;
+    case musvg_format_binary_columnar: musvg_emit_binary_columnar(p, buf); break;
+    case musvg_format_image:       musvg_emit_image(p, buf);       break;
+    case musvg_format_binary_entropy: musvg_emit_binary_entropy(p, buf); break;
+    default: break;
+    }
+    return 0;
+}
+
+/* files use the asynchronous writer unless it has fewer than two buffers */
+static mu_buf* musvg_writer_fd(musvg_parser* p, int fd)
+{
+    return p->write_buffers < 2 ? mu_buffered_writer_fd(fd)
+        : mu_async_writer_fd(fd, p->write_buffer_size, p->write_buffers);
+}
+
+int musvg_emit_file(musvg_parser* p, musvg_format_t format, const char *filename)
+{
+    if (strcmp(filename,"-") == 0) {
+        return musvg_emit_fd(p, format, fileno(stdout));
+    }
+
+    int fd = open(filename, O_CREAT|O_TRUNC|O_WRONLY, 0666);
+    return fd < 0 ? -musvg_error_io : musvg_emit_fd(p, format, fd);
+}
+
+/* returns -musvg_error_io if the output could not be written */
+int musvg_emit_fd(musvg_parser* p, musvg_format_t format, int fd)
+{
+    mu_buf *buf = musvg_writer_fd(p, fd);
+    int ret = musvg_emit_buffer(p, format, buf);
+    if (mu_buf_destroy(buf) < 0 && ret == 0) ret = -musvg_error_io;
+    return ret;
+}
+
+// SVG XML element callbacks
+
+static void musvg_start_element(void* ud, musvg_slice el, const musvg_slice* a, size_t na)
+{
+    musvg_parser* p = (musvg_parser*)ud;
+
+    debugf("musvg_start_element: %.*s\n", (int)el.size, el.data);
+
+    musvg_element element = musvg_parse_element_name(el.data, el.size);
+    if (element != musvg_element_none) {
+        musvg_index node_idx = p->transcoder
+            ? musvg_transcode_node_add(p, element) : musvg_node_add(p, element);
+        for (size_t i = 0; i < na; i += 2)
+        {
+            if (!musvg_parse_attr(p, node_idx, a[i].data, a[i].size,
+                                  a[i + 1].data, a[i + 1].size))
+            {
+                // todo
+            }
+        }
+        if (p->transcoder) musvg_transcode_open(p, node_idx);
+    }
+}
+
+static void musvg_end_element(void* ud, musvg_slice el)
+{
+    musvg_parser* p = (musvg_parser*)ud;
+
+    debugf("musvg_end_element: %.*s\n", (int)el.size, el.data);
+
+    if (musvg_parse_element_name(el.data, el.size) != musvg_element_none) {
+        if (p->transcoder) musvg_transcode_close(p);
+        else musvg_stack_pop(p);
+    }
+}
+
+static void musvg_content(void* ud, musvg_slice s)
+{
+    // empty
+}
+
+// SVG parallel XML parser
+
+/*
+ * documents of at least two minimum chunks are split between sibling
+ * elements under the root element and the chunks are parsed by the mule
+ * workers into private parsers. a chunk parser starts with a placeholder
+ * root at node zero so its nodes, slots, strings and points can be
+ * appended to the document with a constant offset per array. the
+ * prescan guesses self-closing tags from the trailing slash, so a chunk
+ * must end at the depth it started at without closing the placeholder,
+ * otherwise the rest of the document is parsed serially.
+ */
+
+enum {
+    musvg_xml_min_chunk = 65536,
+    musvg_xml_min_parallel = 2 * musvg_xml_min_chunk,
+    musvg_xml_chunks_per_thread = 4,
+};
+
+enum {
+    musvg_xml_tag_none,
+    musvg_xml_tag_open,
+    musvg_xml_tag_close,
+    musvg_xml_tag_empty,
+};
+
+struct musvg_chunk
+{
+    const char *data;          /* chunk source */
+    size_t length;             /* chunk length */
+    musvg_parser *p;           /* chunk parser */
+    musvg_parser *doc;         /* document for binary chunks or NULL */
+    int unbalanced;            /* chunk closed the placeholder */
+};
+
+static void musvg_parser_init(musvg_parser *p);
+static void musvg_parser_fini(musvg_parser *p);
+int musvg_parse_binary(musvg_parser *p, mu_buf *buf);
+
+/* classify a tag between '<' and '>' the way musvg_parse_element does */
+static int musvg_xml_tag_kind(const char* s, const char* end)
+{
+    const char* name;
+    int end_tag = 0;
+
+    while (s < end && musvg_isspace(*s)) s++;
+    if (s < end && *s == '/') {
+        s++;
+        end_tag = 1;
+    }
+    if (s == end || *s == '?' || *s == '!') return musvg_xml_tag_none;
+
+    name = s;
+    while (s < end && !musvg_isspace(*s)) s++;
+    if (musvg_parse_element_name(name, s - name) == musvg_element_none) {
+        return musvg_xml_tag_none;
+    }
+    if (end_tag) return musvg_xml_tag_close;
+
+    while (end > s && musvg_isspace(end[-1])) end--;
+    return end > s && end[-1] == '/' ? musvg_xml_tag_empty : musvg_xml_tag_open;
+}
+
+/*
+ * find offsets where the document can be split. the first split follows
+ * the root start tag and the last split precedes the root end tag. the
+ * others are boundaries between children of the root at least chunk
+ * bytes apart. returns the number of splits.
+ */
+static size_t musvg_xml_split(const char* input, size_t length, size_t chunk,
+    const char** splits, size_t max_splits)
+{
+    const char* end = input + length;
+    const char* mark = input;
+    const char* last = NULL;
+    size_t n = 0;
+    uint depth = 0;
+    int state = CONTENT;
+
+    for (const char* blk = input; blk < end; blk += musvg_xml_block_size)
+    {
+        uint mask = musvg_xml_block_mask(blk, end, '<', '>');
+        while (mask)
+        {
+            const char* s = blk + ctz(mask);
+            mask &= mask - 1;
+            if (*s == '<' && state == CONTENT) {
+                mark = s + 1;
+                state = TAG;
+            } else if (*s == '>' && state == TAG) {
+                state = CONTENT;
+                switch (musvg_xml_tag_kind(mark, s)) {
+                case musvg_xml_tag_none: continue;
+                case musvg_xml_tag_open: depth++; break;
+                case musvg_xml_tag_close:
+                    if (depth == 1) goto out;
+                    if (depth > 0) depth--;
+                    break;
+                }
+                if (depth != 1) continue;
+                if (n == 0 || (s + 1 - splits[n - 1] >= chunk && n + 1 < max_splits)) {
+                    splits[n++] = s + 1;
+                }
+                last = s + 1;
+            }
+        }
+    }
+
+out:
+    if (n > 0 && last > splits[n - 1]) splits[n++] = last;
+    return n;
+}
+
+static void musvg_chunk_start_element(void* ud, musvg_slice el, const musvg_slice* a, size_t na)
+{
+    musvg_chunk *c = (musvg_chunk*)ud;
+    musvg_start_element(c->p, el, a, na);
+}
+
+static void musvg_chunk_end_element(void* ud, musvg_slice el)
+{
+    musvg_chunk *c = (musvg_chunk*)ud;
+    if (c->p->node_depth == 1 &&
+        musvg_parse_element_name(el.data, el.size) != musvg_element_none) {
+        c->unbalanced = 1;
+        return;
+    }
+    musvg_end_element(c->p, el);
+}
+
+static void musvg_parse_chunk(musvg_chunk *c)
+{
+    c->p = (musvg_parser*)malloc(sizeof(musvg_parser));
+    musvg_parser_init(c->p);
+    musvg_node_add(c->p, musvg_element_svg);
+    if (c->doc) {
+        /* binary chunks are decoded with the float codec of the document */
+        c->p->f32_read = c->doc->f32_read;
+        c->p->f32_read_vec = c->doc->f32_read_vec;
+        c->p->grid_digits = c->doc->grid_digits;
+        c->p->string_table = c->doc->string_table;
+        /* style classes are decoded into the storage of the chunk */
+        musvg_class_table ct;
+        musvg_class_table_fork(&ct, c->doc->class_table);
+        c->p->class_table = &ct;
+        mu_buf *buf = mu_buf_memory_new((char*)c->data, c->length);
+        if (musvg_parse_binary(c->p, buf) < 0 || mu_buf_avaiable_read(buf) > 0) {
+            c->unbalanced = 1;
+        }
+        mu_buf_destroy(buf);
+        c->p->class_table = NULL;
+        c->p->string_table = NULL;
+        musvg_class_table_destroy(&ct);
+    } else {
+        musvg_parse_xml(c->data, c->length, musvg_chunk_start_element,
+                        musvg_chunk_end_element, musvg_content, c);
+    }
+}
+
+static void musvg_chunk_relocate(musvg_attr attr, musvg_small *value,
+    musvg_index string_delta, musvg_index points_delta, musvg_index ops_delta)
+{
+    switch (musvg_attr_types[attr]) {
+    case musvg_type_id:
+        ((musvg_id*)value)->name += string_delta;
+        break;
+    case musvg_type_color:
+        if (((musvg_color*)value)->type == musvg_color_type_url) {
+            ((musvg_color*)value)->data += string_delta;
+        }
+        break;
+    case musvg_type_points:
+        ((musvg_points*)value)->point_offset += points_delta;
+        break;
+    case musvg_type_path:
+        ((musvg_path_d*)value)->op_offset += ops_delta;
+        break;
+    default:
+        break;
+    }
+}
+
+/* append the nodes and attributes of a chunk parser to the document */
+static void musvg_chunk_append(musvg_parser *p, musvg_parser *q)
+{
+    const musvg_index root = p->node_stack[0], prev = p->node_stack[1];
+    const musvg_index node_delta = nodes_count(p) - 1;
+    const musvg_index slot_delta = slots_count(p) - 1;
+    const musvg_index points_delta = points_count(p);
+    const musvg_index ops_delta = path_ops_count(p);
+    musvg_cursor c;
+
+    /* binary chunks refer to the string table of the document and
+     * have no strings of their own, so their offsets are kept */
+    const size_t strings_len = strings_size(q) - 1;
+    musvg_index string_delta = 0;
+    if (strings_len > 0) {
+        const musvg_index strings_base = strings_alloc(p, strings_len, 1);
+        memcpy(strings_get(p, strings_base), strings_get(q, 1), strings_len);
+        string_delta = strings_base - 1;
+    }
+
+    musvg_cursor_init(&c, &p->points, sizeof(float));
+    for (musvg_index i = 0; i < points_count(q); i++) {
+        *(float*)musvg_cursor_next(&c) = *points_get(q, i);
+    }
+    musvg_cursor_commit(&c);
+
+    musvg_cursor_init(&c, &p->path_ops, sizeof(musvg_path_op));
+    for (musvg_index i = 0; i < path_ops_count(q); i++) {
+        *(musvg_path_op*)musvg_cursor_next(&c) = *path_ops_get(q, i);
+    }
+    musvg_cursor_commit(&c);
+
+    musvg_cursor_init(&c, &p->path_points, sizeof(musvg_points));
+    for (musvg_index i = 0; i < path_points_count(q); i++) {
+        musvg_points *pts = (musvg_points*)musvg_cursor_next(&c);
+        *pts = *path_points_get(q, i);
+        pts->point_offset += points_delta;
+    }
+    musvg_cursor_commit(&c);
+
+    /* values are stored in slot order, so allocating them again in slot
+     * order reproduces the padding of the serial parser */
+    musvg_cursor_init(&c, &p->slots, sizeof(musvg_slot));
+    for (musvg_index i = 1; i < slots_count(q); i++) {
+        musvg_slot *o = (musvg_slot*)musvg_cursor_next(&c);
+        *o = *slots_get(q, i);
+        const musvg_type_meta *meta = &musvg_type_storage[musvg_attr_types[o->type]];
+        musvg_index left = mnu_int48_get(o->left);
+        musvg_index storage = storage_alloc(p, meta->size, meta->align);
+        memcpy(storage_get(p, storage), storage_get(q, mnu_int48_get(o->storage)), meta->size);
+        o->left = mnu_int48_set(left ? left + slot_delta : 0);
+        o->storage = mnu_int48_set(storage);
+        musvg_chunk_relocate((musvg_attr)o->type, (musvg_small*)storage_get(p, storage),
+            string_delta, points_delta, ops_delta);
+    }
+    musvg_cursor_commit(&c);
+
+    /* children of the placeholder become children of the root and the
+     * first of them follows the last child of the root so far */
+    musvg_cursor_init(&c, &p->nodes, sizeof(musvg_node));
+    for (musvg_index i = 1; i < nodes_count(q); i++) {
+        musvg_node *n = (musvg_node*)musvg_cursor_next(&c);
+        *n = *nodes_get(q, i);
+        musvg_index left = mnu_int48_get(n->left), down = mnu_int48_get(n->down);
+        musvg_index up = mnu_int48_get(n->up), attr = mnu_int48_get(n->attr);
+        n->left = mnu_int48_set(left ? left + node_delta : up ? 0 : prev);
+        n->down = mnu_int48_set(down ? down + node_delta : 0);
+        n->up = mnu_int48_set(up ? up + node_delta : root);
+        n->attr = mnu_int48_set(attr ? attr + slot_delta : 0);
+    }
+    musvg_cursor_commit(&c);
+
+    musvg_index last = node_down(q, 0);
+    if (last) {
+        node_set_down(p, root, last + node_delta);
+        p->node_stack[1] = last + node_delta;
+    }
+}
+
+/* stitch chunks in document order until one fails to balance */
+static size_t musvg_chunks_stitch(musvg_parser *p, musvg_chunk *chunks, size_t nchunks)
+{
+    size_t i = 0;
+    for (; i < nchunks && p->node_depth == 1; i++) {
+        if (chunks[i].unbalanced || chunks[i].p->node_depth != 1) break;
+        musvg_chunk_append(p, chunks[i].p);
+    }
+    return i;
+}
+
+static void musvg_chunks_free(musvg_chunk *chunks, size_t nchunks)
+{
+    for (size_t i = 0; i < nchunks; i++) {
+        musvg_parser_fini(chunks[i].p);
+        free(chunks[i].p);
+    }
+    free(chunks);
+}
+
+static int musvg_parse_svg_xml_parallel(musvg_parser* p, const char *data, size_t length)
+{
+    const size_t max_chunks = p->mule.num_threads * musvg_xml_chunks_per_thread;
+    const char **splits = (const char**)malloc((max_chunks + 2) * sizeof(const char*));
+    size_t chunk = length / max_chunks;
+    if (chunk < musvg_xml_min_chunk) chunk = musvg_xml_min_chunk;
+
+    size_t nsplits = musvg_xml_split(data, length, chunk, splits, max_chunks + 2);
+    size_t nchunks = nsplits > 2 ? nsplits - 1 : 0;
+    if (nchunks == 0) {
+        free(splits);
+        return musvg_parse_xml(data, length, musvg_start_element,
+                               musvg_end_element, musvg_content, p);
+    }
+
+    musvg_chunk *chunks = (musvg_chunk*)calloc(nchunks, sizeof(musvg_chunk));
+    for (size_t i = 0; i < nchunks; i++) {
+        chunks[i].data = splits[i];
+        chunks[i].length = splits[i + 1] - splits[i];
+    }
+
+    /* workers parse the chunks while we parse the prefix */
+    mule_reset(&p->mule);
+    p->chunks = chunks;
+    mule_submit(&p->mule, nchunks);
+    musvg_parse_xml(data, splits[0] - data, musvg_start_element,
+                    musvg_end_element, musvg_content, p);
+    mule_sync(&p->mule);
+    p->chunks = NULL;
+
+    size_t stitched = musvg_chunks_stitch(p, chunks, nchunks);
+    const char *resume = splits[stitched];
+    debugf("musvg_parse_svg_xml_parallel: chunks=%zu stitched=%zu bytes\n",
+        nchunks, (size_t)(resume - splits[0]));
+    musvg_chunks_free(chunks, nchunks);
+    free(splits);
+
+    return musvg_parse_xml(resume, data + length - resume, musvg_start_element,
+                           musvg_end_element, musvg_content, p);
+}
+
+/*
+ * indexed binary files are split between runs of subtrees at least
+ * chunk bytes long. the prefix holding the root element is decoded
+ * while the workers decode the chunks and the rest of the body is
+ * decoded serially from the first chunk that fails to stitch.
+ */
+static int musvg_parse_binary_parallel(musvg_parser* p, mu_buf *buf, musvg_subtree_index *ix)
+{
+    const size_t max_chunks = p->mule.num_threads * musvg_xml_chunks_per_thread;
+    const ullong first = ix->subtrees[0].offset;
+    const ullong last = ix->subtrees[ix->count - 1].offset + ix->subtrees[ix->count - 1].length;
+    size_t chunk = (last - first) / max_chunks;
+    if (chunk < musvg_xml_min_chunk) chunk = musvg_xml_min_chunk;
+
+    musvg_chunk *chunks = (musvg_chunk*)calloc(ix->count, sizeof(musvg_chunk));
+    size_t nchunks = 0;
+    for (size_t i = 0; i < ix->count; i++) {
+        musvg_subtree *s = ix->subtrees + i;
+        if (nchunks > 0 && chunks[nchunks - 1].length < chunk) {
+            musvg_chunk *c = chunks + nchunks - 1;
+            c->length = buf->data + s->offset + s->length - c->data;
+        } else {
+            musvg_chunk *c = chunks + nchunks++;
+            c->data = buf->data + s->offset;
+            c->length = s->length;
+            c->doc = p;
+        }
+    }
+
+    /* workers decode the chunks while we decode the prefix */
+    mule_reset(&p->mule);
+    p->chunks = chunks;
+    mule_submit(&p->mule, nchunks);
+    mu_buf *prefix = mu_buf_memory_new(buf->data + buf->read_marker, first - buf->read_marker);
+    int ret = musvg_parse_binary(p, prefix);
+    mu_buf_destroy(prefix);
+    mule_sync(&p->mule);
+    p->chunks = NULL;
+
+    size_t stitched = ret < 0 ? 0 : musvg_chunks_stitch(p, chunks, nchunks);
+    const char *resume = stitched ? chunks[stitched - 1].data + chunks[stitched - 1].length
+                                  : buf->data + first;
+    debugf("musvg_parse_binary_parallel: chunks=%zu stitched=%zu\n", nchunks, stitched);
+    musvg_chunks_free(chunks, nchunks);
+
+    if (ret < 0) return ret;
+    mu_buf *rest = mu_buf_memory_new((char*)resume, buf->data + ix->index_offset - resume);
+    ret = musvg_parse_binary(p, rest);
+    mu_buf_destroy(rest);
+    return ret;
+}
+
+// SVG parsers
+
+int musvg_parse_svg_xml(musvg_parser* p, mu_buf *buf)
+{
+    /* readers with a sync callback are tokenized as they are filled */
+    if (buf->sync) {
+        return musvg_parse_xml_stream(buf, musvg_start_element,
+                                      musvg_end_element, musvg_content, p);
+    }
+
+    /* the tokenizer reads the source buffer in place and passes
+     * length-bounded slices to the callbacks, so the buffer may be
+     * read-only or mapped. consume the buffer as if it were read. */
+    const char *data = buf->data + buf->read_marker;
+    size_t length = buf->write_marker - buf->read_marker;
+    int ret;
+    if (p->mule.num_threads > 1 && length >= musvg_xml_min_parallel) {
+        ret = musvg_parse_svg_xml_parallel(p, data, length);
+    } else {
+        ret = musvg_parse_xml(data, length, musvg_start_element,
+                              musvg_end_element, musvg_content, p);
+    }
+    buf->read_marker = buf->write_marker;
+    return ret;
+}
+
+// binary validation
 
-static const musvg_attr_buf_fn musvg_binary_parsers[] = {
-    [musvg_type_enum]        = &musvg_read_binary_enum,
-    [musvg_type_id]          = &musvg_read_binary_id,
-    [musvg_type_length]      = &musvg_read_binary_length,
-    [musvg_type_color]       = &musvg_read_binary_color,
-    [musvg_type_transform]   = &musvg_read_binary_transform,
-    [musvg_type_dasharray]   = &musvg_read_binary_dasharray,
-    [musvg_type_float]       = &musvg_read_binary_float,
-    [musvg_type_viewbox]     = &musvg_read_binary_viewbox,
-    [musvg_type_aspectratio] = &musvg_read_binary_aspectratio,
-    [musvg_type_path]        = &musvg_read_binary_path,
-    [musvg_type_points]      = &musvg_read_binary_points,
-};
+/*
+ * svgv, svgb and svgd input is untrusted, so each body is checked in one
+ * pass over its bytes before anything is decoded: lengths against the end
+ * of the input, enums, units, types and opcodes against their ranges,
+ * string and class indices against the tables, vf128 float encodings and
+ * the nesting depth. the decode pass that follows does not check reads.
+ * errors are returned as negated musvg_error_t values.
+ */
 
-static const musvg_attr_buf_fn musvg_binary_emitters[] = {
-    [musvg_type_enum]        = &musvg_write_binary_enum,
-    [musvg_type_id]          = &musvg_write_binary_id,
-    [musvg_type_length]      = &musvg_write_binary_length,
-    [musvg_type_color]       = &musvg_write_binary_color,
-    [musvg_type_transform]   = &musvg_write_binary_transform,
-    [musvg_type_dasharray]   = &musvg_write_binary_dasharray,
-    [musvg_type_float]       = &musvg_write_binary_float,
-    [musvg_type_viewbox]     = &musvg_write_binary_viewbox,
-    [musvg_type_aspectratio] = &musvg_write_binary_aspectratio,
-    [musvg_type_path]        = &musvg_write_binary_path,
-    [musvg_type_points]      = &musvg_write_binary_points,
-};
+typedef struct musvg_validator musvg_validator;
 
-static const musvg_attr_buf_fn musvg_text_emitters[] = {
-    [musvg_type_enum]        = &musvg_write_text_enum,
-    [musvg_type_id]          = &musvg_write_text_id,
-    [musvg_type_length]      = &musvg_write_text_length,
-    [musvg_type_color]       = &musvg_write_text_color,
-    [musvg_type_transform]   = &musvg_write_text_transform,
-    [musvg_type_dasharray]   = &musvg_write_text_dasharray,
-    [musvg_type_float]       = &musvg_write_text_float,
-    [musvg_type_viewbox]     = &musvg_write_text_viewbox,
-    [musvg_type_aspectratio] = &musvg_write_text_aspectratio,
-    [musvg_type_path]        = &musvg_write_text_path,
-    [musvg_type_points]      = &musvg_write_text_points,
+struct musvg_validator
+{
+    const char *c;             /* cursor */
+    const char *end;           /* end of input */
+    size_t strings;            /* string table entries */
+    size_t classes;            /* class table entries */
+    int ieee;                  /* floats are IEEE 754, otherwise vf128 */
+    int grid;                  /* svgd grid coded paths and points */
 };
 
-// SVG attribute parsing
+static void musvg_validator_init(musvg_parser *p, musvg_validator *v,
+    const char *data, size_t len)
+{
+    v->c = data;
+    v->end = data + len;
+    v->strings = p->string_table ? array_buffer_count(&p->string_table->refs) : 0;
+    v->classes = p->class_table ? array_buffer_count(&p->class_table->classes) : 0;
+    v->ieee = musvg_f32_read_fixed(p);
+    v->grid = p->grid_digits >= 0;
+}
 
-static void musvg_parse_style(musvg_parser* p, musvg_index node_idx, const char* str);
+static int musvg_check_byte(musvg_validator *v, uint limit, uint *value)
+{
+    if (v->c == v->end) return -musvg_error_truncated;
+    *value = (unsigned char)*v->c++;
+    return *value <= limit ? 0 : -musvg_error_value;
+}
 
-static int musvg_parse_attr(musvg_parser* p, musvg_index node_idx,
-    const char* name, const char* value)
+/* at most eight bytes, the last without a continuation bit */
+static int musvg_check_leb(musvg_validator *v, ullong *value)
 {
-    if (strcmp(name, "style") == 0) {
-        musvg_parse_style(p, node_idx, value);
-    } else {
-        for (size_t attr = 0; attr < array_size(musvg_attribute_names); attr++) {
-            const char *attr_name = musvg_attribute_names[attr];
-            if (attr_name && strcmp(name, attr_name) == 0) {
-                musvg_attr_str_fn fn = musvg_text_parsers[musvg_attr_types[attr]];
-                debugf("musvg_parse_attr: %s := %s\n", name, value);
-                return fn(p, value, node_idx, as_attr(attr));
-            }
-        }
+    const char *next = mu_cur_get_leb(v->c, v->end, value);
+    if (!next) {
+        return v->end - v->c < mu_leb_max_length
+            ? -musvg_error_truncated : -musvg_error_invalid;
     }
-    return 1;
+    v->c = next;
+    return 0;
 }
 
-static int musvg_parse_name_value(musvg_parser* p, musvg_index node_idx,
-    const char* start, const char* end)
+static int musvg_check_string(musvg_validator *v)
 {
-    const char* str;
-    const char* val;
-    char name[128];
-    char value[384];
-    int n;
-
-    str = start;
-    while (str < end && *str != ':') ++str;
+    ullong idx;
+    int ret = musvg_check_leb(v, &idx);
+    return ret < 0 ? ret : idx < v->strings ? 0 : -musvg_error_string;
+}
 
-    val = str;
+static int musvg_check_floats(musvg_validator *v, ullong count)
+{
+    if (v->ieee) {
+        if ((ullong)(v->end - v->c) / sizeof(float) < count) return -musvg_error_truncated;
+        v->c += sizeof(float) * count;
+        return 0;
+    }
+    size_t len = mu_vf128_f32_check_vec(v->c, v->end - v->c, count);
+    if (len || count == 0) {
+        v->c += len;
+        return 0;
+    }
+    /* find the float that failed, it is truncated if its prefix
+     * announces more bytes than remain */
+    while ((len = mu_vf128_f32_check(v->c, v->end - v->c)) > 0) v->c += len;
+    const unsigned char pre = v->c < v->end ? (unsigned char)*v->c : 0;
+    const size_t need = 1 + ((pre >> 4) & 3) + (pre & 15);
+    return v->c == v->end || need > (size_t)(v->end - v->c)
+        ? -musvg_error_truncated : -musvg_error_float;
+}
+
+/* floats, or grid coded varints for svgd */
+static int musvg_check_values(musvg_validator *v, uint mode, ullong count)
+{
+    ullong n;
+    int ret = 0;
+    if (mode == musvg_grid_mode_float) return musvg_check_floats(v, count);
+    for (ullong k = 0; k < count && ret == 0; k++) ret = musvg_check_leb(v, &n);
+    return ret;
+}
 
-    // Right Trim
-    while (str > start &&  (*str == ':' || musvg_isspace(*str))) --str;
-    ++str;
+static int musvg_check_points(musvg_validator *v)
+{
+    ullong count;
+    uint mode = musvg_grid_mode_float;
+    int ret = musvg_check_leb(v, &count);
+    if (ret == 0 && v->grid) ret = musvg_check_byte(v, musvg_grid_mode_float, &mode);
+    return ret < 0 ? ret : musvg_check_values(v, mode, count);
+}
 
-    n = (int)(str - start);
-    if (n >= sizeof(name)) n = sizeof(name) - 1;
-    if (n) memcpy(name, start, n);
-    name[n] = 0;
+static int musvg_check_path(musvg_validator *v)
+{
+    ullong ops, count;
+    uint code, mode = musvg_grid_mode_float;
+    int ret = musvg_check_leb(v, &ops);
+    if (ret == 0 && v->grid) ret = musvg_check_byte(v, musvg_grid_mode_float, &mode);
+    for (ullong j = 0; j < ops && ret == 0; j++) {
+        if ((ret = musvg_check_byte(v, musvg_path_curveto_quadratic_smooth_rel, &code)) == 0 &&
+            (ret = musvg_check_leb(v, &count)) == 0) {
+            /* each command has the arguments its opcode takes */
+            ret = count == musvg_path_opcode_arg_count(code)
+                ? musvg_check_values(v, mode, count) : -musvg_error_count;
+        }
+    }
+    return ret;
+}
 
-    while (val < end && (*val == ':' || musvg_isspace(*val))) ++val;
+static int musvg_check_attr(musvg_validator *v, musvg_attr attr)
+{
+    uint b;
+    int ret;
+    switch (musvg_attr_types[attr]) {
+    case musvg_type_enum:
+        /* style is split into its properties and has no binary form */
+        if (!musvg_type_info_enum[attr].names) return -musvg_error_attr;
+        return musvg_check_byte(v, enum_modulus(attr) - 1, &b);
+    case musvg_type_id:
+        return musvg_check_string(v);
+    case musvg_type_length:
+        if ((ret = musvg_check_floats(v, 1)) < 0) return ret;
+        return musvg_check_byte(v, musvg_unit_limit, &b);
+    case musvg_type_color:
+        if ((ret = musvg_check_byte(v, musvg_color_type_url, &b)) < 0) return ret;
+        if (b == musvg_color_type_url) return musvg_check_string(v);
+        if (b != musvg_color_type_rgba) return 0;
+        if (v->end - v->c < 4) return -musvg_error_truncated;
+        v->c += 4;
+        return 0;
+    case musvg_type_transform:
+        if ((ret = musvg_check_byte(v, musvg_transform_skew_y, &b)) < 0) return ret;
+        if (b == musvg_transform_matrix) return musvg_check_floats(v, 6);
+        if ((ret = musvg_check_byte(v, array_size(((musvg_transform*)0)->args), &b)) < 0) {
+            return ret == -musvg_error_value ? -musvg_error_count : ret;
+        }
+        return musvg_check_floats(v, b);
+    case musvg_type_dasharray:
+        if ((ret = musvg_check_byte(v, array_size(((musvg_dasharray*)0)->dashes), &b)) < 0) {
+            return ret == -musvg_error_value ? -musvg_error_count : ret;
+        }
+        return musvg_check_floats(v, b);
+    case musvg_type_float:
+        return musvg_check_floats(v, 1);
+    case musvg_type_viewbox:
+        return musvg_check_floats(v, 4);
+    case musvg_type_aspectratio:
+        if ((ret = musvg_check_byte(v, musvg_align_none, &b)) < 0 ||
+            (ret = musvg_check_byte(v, musvg_align_none, &b)) < 0) return ret;
+        return musvg_check_byte(v, musvg_crop_none, &b);
+    case musvg_type_path:
+        return musvg_check_path(v);
+    case musvg_type_points:
+        return musvg_check_points(v);
+    }
+    return -musvg_error_attr;
+}
 
-    n = (int)(end - val);
-    if (n >= sizeof(value)) n = sizeof(value) - 1;
-    if (n) memcpy(value, val, n);
-    value[n] = 0;
+/*
+ * checks the nodes from the read marker up to where musvg_parse_binary
+ * stops: the end of the input, or the close of the root element when a
+ * footer follows. nesting starts at the depth of the parser. whole is
+ * set to the length of the node records that were checked completely.
+ */
+static int musvg_validate_binary(musvg_parser *p, mu_buf *buf, size_t *whole)
+{
+    musvg_validator v;
+    uint depth = p->node_depth, element, attr;
+    const char *start = buf->data + buf->read_marker;
+    ullong idx;
+    int ret;
 
-    return musvg_parse_attr(p, node_idx, name, value);
+    musvg_validator_init(p, &v, start, mu_buf_avaiable_read(buf));
+    for (;;) {
+        *whole = v.c - start;
+        if (v.c == v.end) return 0;
+        if ((ret = musvg_check_byte(&v, musvg_element_limit, &element)) < 0) {
+            return -musvg_error_element;
+        }
+        if (element == musvg_element_none) {
+            if (depth == 0) return -musvg_error_depth;
+            if (--depth == 0) {
+                *whole = v.c - start;
+                return 0;
+            }
+            continue;
+        }
+        if (depth++ == musvg_max_depth) return -musvg_error_depth;
+        for (;;) {
+            if (v.c == v.end) return -musvg_error_truncated;
+            attr = (unsigned char)*v.c++;
+            if (attr == musvg_attr_none) break;
+            if (attr == musvg_binary_class) {
+                if ((ret = musvg_check_leb(&v, &idx)) < 0) return ret;
+                if (idx >= v.classes) return -musvg_error_class;
+                continue;
+            }
+            if (attr > musvg_attr_limit) return -musvg_error_attr;
+            if ((ret = musvg_check_attr(&v, as_attr(attr))) < 0) return ret;
+        }
+    }
 }
 
-static void musvg_parse_style(musvg_parser* p, musvg_index node_idx, const char* str)
+/* class lists hold presentation attributes in the node format */
+static int musvg_validate_classes(musvg_parser *p, musvg_class_table *t)
 {
-    const char *start, *end;
+    musvg_validator v;
+    int ret;
 
-    debugf("musvg_parse_style: [%s]\n", str);
+    for (size_t i = 0; i < array_buffer_count(&t->classes); i++) {
+        musvg_style_class *c = musvg_class_get(t, i);
+        musvg_validator_init(p, &v, t->lists->data + c->offset, c->length);
+        while (v.c < v.end) {
+            uint attr = (unsigned char)*v.c++;
+            if (attr > musvg_attr_limit || !musvg_attr_presentation[attr]) {
+                return -musvg_error_attr;
+            }
+            if ((ret = musvg_check_attr(&v, as_attr(attr))) < 0) return ret;
+        }
+    }
+    return 0;
+}
 
-    while (*str)
-    {
-        // Left Trim
-        while(*str && musvg_isspace(*str)) ++str;
-        start = str;
-        while(*str && *str != ';') ++str;
-        end = str;
+/* decodes nodes that musvg_validate_binary accepted */
+static void musvg_decode_binary(musvg_parser *p, mu_buf *buf)
+{
+    musvg_small element, attr;
 
-        // Right Trim
-        while (end > start &&  (*end == ';' || musvg_isspace(*end))) --end;
-        ++end;
+    while (mu_buf_avaiable_read(buf) > 0) {
+        mu_buf_read_unchecked_i8(buf, &element);
+        if (element == musvg_element_none) {
+            if (p->transcoder) musvg_transcode_close(p);
+            else musvg_stack_pop(p);
+            /* anything after the root element is a footer */
+            if (p->node_depth == 0) return;
+            continue;
+        }
+
+        musvg_index node_idx = p->transcoder
+            ? musvg_transcode_node_add(p, element) : musvg_node_add(p, element);
 
-        musvg_parse_name_value(p, node_idx, start, end);
-        if (*str) ++str;
+        for (;;) {
+            mu_buf_read_unchecked_i8(buf, &attr);
+            if (attr == musvg_attr_none) break;
+            if (attr == musvg_binary_class) {
+                musvg_read_binary_class(p, buf, node_idx);
+                continue;
+            }
+            musvg_attr_buf_fn read_fn = musvg_binary_parsers[musvg_attr_types[attr]];
+            read_fn(p, buf, node_idx, as_attr(attr));
+        }
+        if (p->transcoder) musvg_transcode_open(p, node_idx);
     }
 }
 
-// SVG emitters
+int musvg_parse_binary(musvg_parser *p, mu_buf *buf)
+{
+    size_t whole;
+    int ret = musvg_validate_binary(p, buf, &whole);
+    if (ret == 0) musvg_decode_binary(p, buf);
+    return ret;
+}
 
-void musvg_emit_text_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+/*
+ * streaming binary ingest
+ *
+ * bodies read from a buffer with a sync callback are checked and decoded
+ * a buffer at a time. the whole node records are decoded through a view
+ * that ends with them, so the decoder never reads past what was checked,
+ * and a record cut by the end of the buffer is moved to the front to be
+ * completed by the next read. the buffer grows when one record is larger
+ * than it. decoding stops at the close of the root element, so a footer
+ * index is not read.
+ */
+static int musvg_parse_binary_stream(musvg_parser *p, mu_buf *buf)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
-    mu_buf_write_format(buf, "node %s {\n",
-        musvg_element_names[node_type(p, node_idx)]);
-    musvg_index slots[64];
-    size_t sz = array_size(slots);
-    musvg_node_attr_slots(p, node_idx, slots, &sz);
-    for (size_t i = 0; i < sz; i++) {
-        musvg_attr attr = slot_type(p, slots[i]);
-        musvg_attr_buf_fn fn = musvg_text_emitters[musvg_attr_types[attr]];
-        for (int d = 0; d < depth + 1; d++) mu_buf_write_string(buf, "\t");
-        mu_buf_write_format(buf, "attr %s \"", musvg_attribute_names[attr]);
-        fn(p, buf, node_idx, attr);
-        mu_buf_write_string(buf, "\";\n");
+    size_t whole, pending;
+    int ret;
+
+    for (;;) {
+        ret = musvg_validate_binary(p, buf, &whole);
+        if (whole > 0) {
+            mu_buf *view = mu_buf_memory_new(buf->data + buf->read_marker, whole);
+            musvg_decode_binary(p, view);
+            mu_buf_destroy(view);
+            buf->read_marker += whole;
+            if (p->node_depth == 0) return ret;
+        }
+        if (ret < 0 && ret != -musvg_error_truncated) return ret;
+
+        pending = mu_buf_avaiable_read(buf);
+        memmove(buf->data, buf->data + buf->read_marker, pending);
+        buf->read_marker = 0;
+        buf->write_marker = pending;
+        if (pending == buf->buffer_size &&
+            mu_buf_resize(buf, buf->buffer_size * 2) < 0) return -musvg_error_invalid;
+        if (buf->sync(buf) < 0) return -musvg_error_io;
+        if (buf->write_marker == pending) return ret;
     }
 }
 
-void musvg_emit_text_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+static void musvg_binary_codec(musvg_parser* p, musvg_format_t format)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
-    mu_buf_write_string(buf, "};\n");
+    if (format == musvg_format_binary_ieee) {
+        p->f32_read = mu_ieee754_f32_read;
+        p->f32_read_vec = mu_ieee754_f32_read_vec;
+    } else {
+        p->f32_read = mu_vf128_f32_read;
+        p->f32_read_vec = mu_vf128_f32_read_vec;
+    }
 }
 
-void musvg_emit_xml_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+/*
+ * indexed bodies are decoded in parallel when there are worker threads.
+ * streamed bodies are decoded in order as the index is at the end.
+ */
+static int musvg_parse_binary_indexed(musvg_parser* p, mu_buf *buf, musvg_format_t format)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
-    mu_buf_write_i8(buf, '<');
-    mu_buf_write_string(buf, musvg_element_names[node_type(p, node_idx)]);
-    musvg_index slots[64];
-    size_t sz = array_size(slots);
-    musvg_node_attr_slots(p, node_idx, slots, &sz);
-    for (size_t i = 0; i < sz; i++) {
-        musvg_attr attr = slot_type(p, slots[i]);
-        musvg_attr_buf_fn fn = musvg_text_emitters[musvg_attr_types[attr]];
-        mu_buf_write_i8(buf, ' ');
-        mu_buf_write_string(buf, musvg_attribute_names[attr]);
-        mu_buf_write_string(buf, "=\"");
-        fn(p, buf, node_idx, attr);
-        mu_buf_write_i8(buf, '"');
+    musvg_subtree_index ix;
+    if (buf->sync) return musvg_parse_binary_stream(p, buf);
+    if (p->mule.num_threads < 2 || nodes_count(p) != 0 ||
+        musvg_subtree_index_read(buf, format, &ix) < 0) {
+        return musvg_parse_binary(p, buf);
     }
-    if (close) mu_buf_write_i8(buf, '/');
-    mu_buf_write_string(buf, ">\n\0");
+    int ret = ix.count > 0 && buf->read_marker == ix.body_offset
+        ? musvg_parse_binary_parallel(p, buf, &ix) : musvg_parse_binary(p, buf);
+    free(ix.subtrees);
+    return ret;
 }
 
-void musvg_emit_xml_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+/* decodes the header and tables, then the body that refers to them */
+static int musvg_parse_binary_body(musvg_parser* p, mu_buf *buf, musvg_format_t format)
+{
+    musvg_string_table t;
+    musvg_class_table ct;
+    musvg_string_table_init(&t);
+    musvg_class_table_init(&ct);
+    int ret = musvg_binary_tables_read(p, buf, format, &t, &ct);
+    if (ret == 0) {
+        p->string_table = &t;
+        p->class_table = &ct;
+        ret = musvg_validate_classes(p, &ct);
+        if (ret == 0) ret = musvg_parse_binary_indexed(p, buf, format);
+        p->class_table = NULL;
+        p->string_table = NULL;
+    }
+    musvg_class_table_destroy(&ct);
+    musvg_string_table_destroy(&t);
+    p->grid_digits = -1;
+    return ret;
+}
+
+int musvg_parse_binary_vf(musvg_parser* p, mu_buf *buf)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    if (close) return;
-    for (int d = 0; d < depth; d++) mu_buf_write_string(buf, "\t");
-    mu_buf_write_format(buf, "</%s>\n", musvg_element_names[node_type(p, node_idx)]);
+    musvg_binary_codec(p, musvg_format_binary_vf);
+    return musvg_parse_binary_body(p, buf, musvg_format_binary_vf);
 }
 
-void musvg_emit_binary_begin(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+int  musvg_parse_binary_ieee(musvg_parser* p, mu_buf *buf)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    mu_buf_write_i8(buf, (char)node_type(p, node_idx));
+    musvg_binary_codec(p, musvg_format_binary_ieee);
+    return musvg_parse_binary_body(p, buf, musvg_format_binary_ieee);
+}
 
-    musvg_index slots[64];
-    size_t sz = array_size(slots);
-    musvg_node_attr_slots(p, node_idx, slots, &sz);
-    for (size_t i = 0; i < sz; i++) {
-        musvg_attr attr = slot_type(p, slots[i]);
-        musvg_attr_buf_fn fn = musvg_binary_emitters[musvg_attr_types[attr]];
-        mu_buf_write_i8(buf, attr);
-        fn(p, buf, node_idx, attr);
+/*
+ * svgc sections are checked together in one pass before they are decoded,
+ * following the tree and attribute sections: values as in svgb with IEEE
+ * 754 floats, strings against their terminators, and op and point counts
+ * against the opcode and point sections.
+ */
+typedef struct musvg_column_checker musvg_column_checker;
+
+struct musvg_column_checker
+{
+    musvg_validator values;
+    musvg_validator counts;
+    musvg_validator strings;
+    const char *ops;           /* next opcode */
+    const char *ops_end;
+    size_t points;             /* points not yet claimed */
+};
+
+static int musvg_check_column_string(musvg_column_checker *k)
+{
+    const char *end = memchr(k->strings.c, 0, k->strings.end - k->strings.c);
+    if (!end) return -musvg_error_truncated;
+    k->strings.c = end + 1;
+    return 0;
+}
+
+static int musvg_check_column_points(musvg_column_checker *k, uint *count)
+{
+    if (k->counts.end - k->counts.c < 4) return -musvg_error_truncated;
+    *count = musvg_entropy_load(k->counts.c);
+    k->counts.c += 4;
+    if (*count > k->points) return -musvg_error_count;
+    k->points -= *count;
+    return 0;
+}
+
+static int musvg_check_column_attr(musvg_column_checker *k, musvg_attr attr)
+{
+    uint b, ops, count;
+    int ret;
+    switch (musvg_attr_types[attr]) {
+    case musvg_type_id:
+        return musvg_check_column_string(k);
+    case musvg_type_color:
+        if ((ret = musvg_check_byte(&k->values, musvg_color_type_url, &b)) < 0) return ret;
+        if (b == musvg_color_type_url) return musvg_check_column_string(k);
+        if (b != musvg_color_type_rgba) return 0;
+        if (k->values.end - k->values.c < 4) return -musvg_error_truncated;
+        k->values.c += 4;
+        return 0;
+    case musvg_type_path:
+        if (k->counts.end - k->counts.c < 4) return -musvg_error_truncated;
+        ops = musvg_entropy_load(k->counts.c);
+        k->counts.c += 4;
+        if (ops > (size_t)(k->ops_end - k->ops)) return -musvg_error_count;
+        for (uint j = 0; j < ops; j++) {
+            uint code = (unsigned char)*k->ops++;
+            if (code > musvg_path_curveto_quadratic_smooth_rel) return -musvg_error_value;
+            if ((ret = musvg_check_column_points(k, &count)) < 0) return ret;
+            /* each command has the arguments its opcode takes */
+            if (count != musvg_path_opcode_arg_count(code)) return -musvg_error_count;
+        }
+        return 0;
+    case musvg_type_points:
+        return musvg_check_column_points(k, &count);
+    default:
+        return musvg_check_attr(&k->values, attr);
     }
-    mu_buf_write_i8(buf, musvg_attr_none);
 }
 
-void musvg_emit_binary_end(musvg_parser *p, void *userdata, musvg_index node_idx, uint depth, uint close)
+static int musvg_validate_columns(musvg_parser* p, musvg_columns *c)
+{
+    musvg_column_checker k;
+    musvg_validator tree, attrs;
+    uint depth = p->node_depth, element, attr;
+    int ret;
+
+    mu_buf **b = c->buf;
+    musvg_validator_init(p, &tree, b[musvg_column_tree]->data, b[musvg_column_tree]->write_marker);
+    musvg_validator_init(p, &attrs, b[musvg_column_attrs]->data, b[musvg_column_attrs]->write_marker);
+    musvg_validator_init(p, &k.values, b[musvg_column_values]->data, b[musvg_column_values]->write_marker);
+    musvg_validator_init(p, &k.counts, b[musvg_column_counts]->data, b[musvg_column_counts]->write_marker);
+    musvg_validator_init(p, &k.strings, b[musvg_column_strings]->data, b[musvg_column_strings]->write_marker);
+    k.values.ieee = 1;
+    k.values.grid = 0;
+    k.ops = b[musvg_column_ops]->data;
+    k.ops_end = k.ops + b[musvg_column_ops]->write_marker;
+    k.points = b[musvg_column_points]->write_marker / sizeof(float);
+
+    while (tree.c < tree.end) {
+        if (musvg_check_byte(&tree, musvg_element_limit, &element) < 0) {
+            return -musvg_error_element;
+        }
+        if (element == musvg_element_none) {
+            if (depth-- == 0) return -musvg_error_depth;
+            continue;
+        }
+        if (depth++ == musvg_max_depth) return -musvg_error_depth;
+        for (;;) {
+            if (attrs.c == attrs.end) return -musvg_error_truncated;
+            attr = (unsigned char)*attrs.c++;
+            if (attr == musvg_attr_none) break;
+            if (attr > musvg_attr_limit) return -musvg_error_attr;
+            if ((ret = musvg_check_column_attr(&k, as_attr(attr))) < 0) return ret;
+        }
+    }
+    return 0;
+}
+
+/* decodes sections that musvg_validate_columns accepted */
+static int musvg_parse_columns(musvg_parser* p, musvg_columns *c)
+{
+    int ret = musvg_validate_columns(p, c);
+    if (ret < 0) return ret;
+
+    /* append the opcode and point sections in bulk */
+    musvg_cursor pts, ops;
+    size_t run, n;
+    mu_buf *ops_buf = c->buf[musvg_column_ops];
+    mu_buf *pts_buf = c->buf[musvg_column_points];
+    static_assert(sizeof(musvg_path_op) == 1, "opcodes are bytes");
+    musvg_cursor_init(&ops, &p->path_ops, sizeof(musvg_path_op));
+    for (size_t left = mu_buf_avaiable_read(ops_buf); left > 0; left -= n) {
+        char *v = (char*)musvg_cursor_run(&ops, &run);
+        n = run < left ? run : left;
+        assert(mu_buf_read_bytes(ops_buf, v, n) == n);
+        musvg_cursor_advance(&ops, n);
+    }
+    c->op_idx = musvg_cursor_commit(&ops);
+    musvg_cursor_init(&pts, &p->points, sizeof(float));
+    for (size_t left = mu_buf_avaiable_read(pts_buf) / sizeof(float); left > 0; left -= n) {
+        float *v = (float*)musvg_cursor_run(&pts, &run);
+        n = run < left ? run : left;
+        assert(!mu_ieee754_f32_read_vec(pts_buf, v, n));
+        musvg_cursor_advance(&pts, n);
+    }
+    c->point_idx = musvg_cursor_commit(&pts);
+
+    p->f32_read = mu_ieee754_f32_read;
+    p->f32_read_vec = mu_ieee754_f32_read_vec;
+    p->columns = c;
+
+    mu_buf *tree = c->buf[musvg_column_tree];
+    mu_buf *attrs = c->buf[musvg_column_attrs];
+    mu_buf *values = c->buf[musvg_column_values];
+    musvg_small element, attr;
+    while (mu_buf_read_i8(tree, &element)) {
+        if (element == musvg_element_none) {
+            musvg_stack_pop(p);
+            continue;
+        }
+        musvg_index node_idx = musvg_node_add(p, element);
+        while (mu_buf_read_i8(attrs, &attr)) {
+            if (attr == musvg_attr_none) break;
+            musvg_attr_buf_fn read_fn = musvg_columnar_parsers[musvg_attr_types[attr]];
+            read_fn(p, values, node_idx, as_attr(attr));
+        }
+    }
+    p->columns = NULL;
+    return 0;
+}
+
+int musvg_parse_binary_columnar(musvg_parser* p, mu_buf *buf)
 {
-    mu_buf *buf = (mu_buf *)userdata;
-    mu_buf_write_i8(buf, musvg_element_none);
+    musvg_columns c = { 0 };
+    ullong len[musvg_column_count];
+    int ret = -musvg_error_truncated;
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (mu_leb_u64_read(buf, &len[i]) < 0) return -musvg_error_truncated;
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (len[i] > mu_buf_avaiable_read(buf)) goto out;
+        c.buf[i] = mu_buf_memory_new(buf->data + buf->read_marker, len[i]);
+        buf->read_marker += len[i];
+    }
+    ret = musvg_parse_columns(p, &c);
+
+out:
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (c.buf[i]) mu_buf_destroy(c.buf[i]);
+    }
+    return ret;
 }
 
-void musvg_visit_recurse(musvg_parser* p, void *userdata, musvg_index node_idx, uint d,
-    musvg_node_visit_fn begin_fn, musvg_node_visit_fn end_fn)
+int musvg_parse_binary_entropy(musvg_parser* p, mu_buf *buf)
 {
-    musvg_index down_idx, left_idx = node_idx;
-    llong count = 0, i = 0;
-    do {
-        count++;
-        left_idx = node_left(p, left_idx);
-    } while (left_idx);
-    musvg_index node_indices[count];
-    left_idx = node_idx;
-    do {
-        left_idx = node_left(p, (node_indices[i++] = left_idx));
-    } while (left_idx);
-    while (i-- > 0) {
-        left_idx = node_indices[i];
-        down_idx = node_down(p, left_idx);
-        int has_depth = !!down_idx;
-        if (begin_fn) begin_fn(p, userdata, left_idx, d, !has_depth);
-        if (has_depth) {
-            musvg_visit_recurse(p, userdata, down_idx, d + 1, begin_fn, end_fn);
+    musvg_columns c = { 0 };
+    ullong len[musvg_column_count], coded[musvg_column_count];
+    int ret = -musvg_error_truncated;
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (mu_leb_u64_read(buf, &len[i]) < 0) return -musvg_error_truncated;
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (mu_leb_u64_read(buf, &coded[i]) < 0) return -musvg_error_truncated;
+    }
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (coded[i] > mu_buf_avaiable_read(buf)) goto out;
+        /* the coded length bounds the decoded length before allocating */
+        if (len[i] > coded[i] * mu_rc_max_expansion) {
+            ret = -musvg_error_count;
+            goto out;
         }
-        if (end_fn) end_fn(p, userdata, left_idx, d, !has_depth);
+        c.buf[i] = mu_buf_new(len[i]);
+        if (!c.buf[i]->data && len[i] > 0) {
+            ret = -musvg_error_count;
+            goto out;
+        }
+        c.buf[i]->write_marker = len[i];
+        mu_buf *in = mu_buf_memory_new(buf->data + buf->read_marker, coded[i]);
+        int err = mu_rc_decode_bytes(in, c.buf[i]->data, len[i], musvg_entropy_lanes[i]);
+        mu_buf_destroy(in);
+        if (err < 0) goto out;
+        buf->read_marker += coded[i];
+    }
+    musvg_entropy_undelta(c.buf[musvg_column_points]->data, len[musvg_column_points]);
+    ret = musvg_parse_columns(p, &c);
+
+out:
+    for (size_t i = 0; i < musvg_column_count; i++) {
+        if (c.buf[i]) mu_buf_destroy(c.buf[i]);
     }
+    return ret;
 }
 
-void musvg_visit(musvg_parser* p, void *userdata, musvg_node_visit_fn begin_fn, musvg_node_visit_fn end_fn)
+int musvg_parse_binary_delta(musvg_parser* p, mu_buf *buf)
 {
-    /*
-     * currently we construct the entire output in memory, however, it will be
-     * possible to use the buffer size check callback to incrementally flush.
-     */
-    musvg_visit_recurse(p, userdata, 0, 0, begin_fn, end_fn);
+    musvg_binary_codec(p, musvg_format_binary_delta);
+    return musvg_parse_binary_body(p, buf, musvg_format_binary_delta);
 }
 
-void musvg_emit_text(musvg_parser* p, mu_buf *buf)
-{
-    musvg_visit(p, buf, musvg_emit_text_begin, musvg_emit_text_end);
+/*
+ * decodes the root element and one of its subtrees from an indexed file
+ * in a memory buffer into an empty parser. subtree nodes are numbered
+ * from one, and the index records their numbering in the document.
+ */
+int musvg_parse_subtree(musvg_parser* p, musvg_format_t format, mu_buf *buf, size_t subtree)
+{
+    musvg_subtree_index ix;
+    musvg_string_table t;
+    musvg_class_table ct;
+    int ret = -1;
+
+    if (musvg_subtree_index_read(buf, format, &ix) < 0) return -1;
+    musvg_string_table_init(&t);
+    musvg_class_table_init(&ct);
+    if (subtree < ix.count && nodes_count(p) == 0) {
+        musvg_subtree *s = ix.subtrees + subtree;
+        mu_buf *tables = mu_buf_memory_new(buf->data, ix.body_offset);
+        mu_buf *root = mu_buf_memory_new(buf->data + ix.body_offset,
+            ix.subtrees[0].offset - ix.body_offset);
+        mu_buf *tree = mu_buf_memory_new(buf->data + s->offset, s->length);
+        musvg_binary_codec(p, format);
+        p->string_table = &t;
+        p->class_table = &ct;
+        if (musvg_binary_tables_read(p, tables, format, &t, &ct) == 0 &&
+            mu_buf_avaiable_read(tables) == 0 &&
+            musvg_validate_classes(p, &ct) == 0 &&
+            musvg_parse_binary(p, root) == 0 && p->node_depth == 1 &&
+            musvg_parse_binary(p, tree) == 0 && p->node_depth == 1) {
+            musvg_stack_pop(p);
+            ret = 0;
+        }
+        p->class_table = NULL;
+        p->string_table = NULL;
+        p->grid_digits = -1;
+        mu_buf_destroy(tree);
+        mu_buf_destroy(root);
+        mu_buf_destroy(tables);
+    }
+    musvg_class_table_destroy(&ct);
+    musvg_string_table_destroy(&t);
+    free(ix.subtrees);
+    return ret;
 }
 
-void musvg_emit_xml(musvg_parser* p, mu_buf *buf)
+int musvg_subtree_count(musvg_format_t format, mu_buf *buf)
 {
-    musvg_visit(p, buf, musvg_emit_xml_begin, musvg_emit_xml_end);
+    musvg_subtree_index ix;
+    if (musvg_subtree_index_read(buf, format, &ix) < 0) return -1;
+    free(ix.subtrees);
+    return (int)ix.count;
 }
 
-void musvg_emit_binary_vf(musvg_parser* p, mu_buf *buf)
+int musvg_parse_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf)
 {
-    p->f32_write = mu_vf128_f32_write_byval;
-    p->f32_write_vec = mu_vf128_f32_write_vec;
-    musvg_visit(p, buf, musvg_emit_binary_begin, musvg_emit_binary_end);
+    switch (format) {
+    case musvg_format_xml:         return musvg_parse_svg_xml(p, buf);
+    case musvg_format_binary_vf:   return musvg_parse_binary_vf(p, buf);
+    case musvg_format_binary_ieee: return musvg_parse_binary_ieee(p, buf);
+    case musvg_format_binary_delta: return musvg_parse_binary_delta(p, buf);
+    case musvg_format_binary_columnar: return musvg_parse_binary_columnar(p, buf);
+    case musvg_format_image:       return musvg_parse_image(p, buf);
+    case musvg_format_binary_entropy: return musvg_parse_binary_entropy(p, buf);
+    default: return -1;
+    }
 }
 
-void musvg_emit_binary_ieee(musvg_parser* p, mu_buf *buf)
+/*
+ * maps a regular file for a single parse, returning an empty span for
+ * pipes, empty files or when mapping fails. the kernel is told the parse
+ * reads the whole file front to back.
+ */
+static musvg_span musvg_map_fd(int fd)
 {
-    p->f32_write = mu_ieee754_f32_write_byval;
-    p->f32_write_vec = mu_ieee754_f32_write_vec;
-    musvg_visit(p, buf, musvg_emit_binary_begin, musvg_emit_binary_end);
+    musvg_span span = { NULL, 0 };
+#ifndef _WIN32
+    struct stat st;
+    void *data;
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return span;
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return span;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    madvise(data, st.st_size, MADV_WILLNEED);
+    span.data = (char*)data;
+    span.size = st.st_size;
+#endif
+    return span;
 }
 
-int musvg_emit_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf)
+static void musvg_unmap_span(musvg_span span)
 {
-    switch (format) {
-    case musvg_format_text:        musvg_emit_text(p, buf);        break;
-    case musvg_format_xml:         musvg_emit_xml(p, buf);         break;
-    case musvg_format_binary_vf:   musvg_emit_binary_vf(p, buf);   break;
-    case musvg_format_binary_ieee: musvg_emit_binary_ieee(p, buf); break;
-    default: break;
-    }
-    return 0;
+#ifndef _WIN32
+    munmap(span.data, span.size);
+#endif
 }
 
-int musvg_emit_file(musvg_parser* p, musvg_format_t format, const char *filename)
+/*
+ * regular files are decoded straight from a mapping, except that XML is
+ * streamed when there is one thread as only the parallel parser needs
+ * the whole document in memory.
+ */
+int musvg_parse_file(musvg_parser* p, musvg_format_t format, const char *filename)
 {
     if (strcmp(filename,"-") == 0) {
-        return musvg_emit_fd(p, format, fileno(stdout));
+        return musvg_parse_fd(p, format, fileno(stdin));
     }
 
-    mu_buf *buf = mu_buffered_writer_new(filename);
-    int ret = musvg_emit_buffer(p, format, buf);
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -musvg_error_io;
+    int streamed = format == musvg_format_xml && p->mule.num_threads < 2;
+    musvg_span span = streamed ? (musvg_span){ NULL, 0 } : musvg_map_fd(fd);
+    if (!span.data) {
+        int ret = musvg_parse_fd(p, format, fd);
+        close(fd);
+        return ret;
+    }
+    close(fd);
+
+    mu_buf *buf = mu_buf_memory_new(span.data, span.size);
+    int ret = musvg_parse_buffer(p, format, buf);
     mu_buf_destroy(buf);
+    musvg_unmap_span(span);
     return ret;
 }
 
-int musvg_emit_fd(musvg_parser* p, musvg_format_t format, int fd)
+/* XML, svgv, svgb and svgd are decoded as they are read, other formats are read whole */
+int musvg_parse_fd(musvg_parser* p, musvg_format_t format, int fd)
 {
-    mu_buf *buf = mu_buffered_writer_fd(fd);
-    int ret = musvg_emit_buffer(p, format, buf);
+    if (format == musvg_format_xml || format == musvg_format_binary_vf ||
+        format == musvg_format_binary_ieee || format == musvg_format_binary_delta) {
+        mu_buf *buf = mu_buffered_reader_fd(fd);
+        int ret = mu_buf_resize(buf, musvg_read_block_size) < 0
+            ? -musvg_error_io : musvg_parse_buffer(p, format, buf);
+        mu_buf_set_fd(buf, -1);
+        mu_buf_destroy(buf);
+        return ret;
+    }
+
+    musvg_span span = musvg_read_fd(fd);
+    mu_buf *buf = mu_buf_memory_new(span.data, span.size);
+    int ret = musvg_parse_buffer(p, format, buf);
     mu_buf_destroy(buf);
+    free(span.data);
     return ret;
 }
 
-// SVG XML element callbacks
+// SVG streaming transcoder
+
+/*
+ * converts between XML, text, svgv, svgb and svgd without building the
+ * document. nodes are decoded one at a time into the parser as usual and
+ * written to the output once their attributes are read. when a node
+ * closes, everything allocated since its start is released, so memory
+ * follows the depth of the tree rather than the size of the document.
+ * an XML start tag waits for the next event to know if it is empty.
+ *
+ * binary output starts with a header holding the svgd grid digits, then
+ * the string table, so XML input, and any input to svgd without a
+ * precision, is read twice: a scan pass gathers the strings and the
+ * coarsest grid and the second pass writes the nodes. input that cannot seek is first
+ * spooled to a temporary file. binary input otherwise supplies its own
+ * string table. style classes and the subtree index are not written.
+ */
 
-static void musvg_start_element(void* ud, const char* el, const char** a)
+typedef struct musvg_transcode_mark musvg_transcode_mark;
+
+struct musvg_transcode_mark
 {
-    musvg_parser* p = (musvg_parser*)ud;
+    size_t nodes, slots, points, path_ops, path_points;
+    size_t storage, strings;
+};
 
-    debugf("musvg_start_element: %s\n", el);
+struct musvg_transcoder
+{
+    mu_buf *out;               /* output, or NULL in the scan pass */
+    musvg_format_t format;     /* output format */
+    musvg_node_visit_fn begin_fn;
+    musvg_node_visit_fn end_fn;
+    musvg_string_table strings; /* output string table */
+    int grid_digits;           /* output svgd grid digits or -1 */
+    int scanned;               /* strings gathered by a scan pass */
+    int header;                /* binary header written */
+    int error;                 /* first error found while writing nodes */
+    musvg_index pending;       /* node with an unwritten XML start tag, plus one */
+    size_t keep_storage;       /* storage and strings below these are kept */
+    size_t keep_strings;
+    musvg_transcode_mark marks[musvg_max_depth]; /* allocations at each node start */
+};
 
-    for (size_t i = 0; i < array_size(musvg_element_names); i++) {
-        const char *name = musvg_element_names[i];
-        if (name && strcmp(el, name) == 0) {
-            musvg_index node_idx = musvg_node_add(p, i);
-            for (uint i = 0; a[i]; i += 2)
-            {
-                if (!musvg_parse_attr(p, node_idx, a[i], a[i + 1]))
-                {
-                    // todo
-                }
-            }
-            return;
-        }
-    }
+static int musvg_transcode_binary(musvg_format_t format)
+{
+    return format == musvg_format_binary_vf || format == musvg_format_binary_ieee ||
+           format == musvg_format_binary_delta;
 }
 
-static void musvg_end_element(void* ud, const char* el)
+static int musvg_transcode_formats(musvg_format_t in_format, musvg_format_t out_format)
 {
-    musvg_parser* p = (musvg_parser*)ud;
-
-    debugf("musvg_end_element: %s\n", el);
+    return (in_format == musvg_format_xml || musvg_transcode_binary(in_format)) &&
+           (out_format == musvg_format_xml || out_format == musvg_format_text ||
+            musvg_transcode_binary(out_format));
+}
 
-    for (size_t i = 0; i < array_size(musvg_element_names); i++) {
-        const char *name = musvg_element_names[i];
-        if (name && strcmp(el, name) == 0) {
-            musvg_stack_pop(p);
-            return;
+/* interns a string in the output table, doubling its slots at half full */
+static void musvg_transcode_intern(musvg_parser *p, musvg_index str)
+{
+    musvg_string_table *t = &p->transcoder->strings;
+    size_t count = array_buffer_count(&t->refs);
+    if (!t->slots || count * 2 >= t->mask + 1) {
+        size_t size = t->slots ? (t->mask + 1) * 2 : 16;
+        free(t->slots);
+        t->slots = (musvg_index*)calloc(size, sizeof(musvg_index));
+        t->mask = size - 1;
+        for (size_t i = 0; i < count; i++) {
+            const char *s = fetch_string(p, musvg_string_table_ref(t, i));
+            size_t h = (size_t)musvg_string_hash(s, strlen(s)) & t->mask;
+            while (t->slots[h]) h = (h + 1) & t->mask;
+            t->slots[h] = i + 1;
         }
     }
+    musvg_string_table_intern(p, t, str);
+    if (array_buffer_count(&t->refs) > count) musvg_transcode_keep(p);
 }
 
-static void musvg_content(void* ud, const char* s)
+/* the header with the svgd grid digits and the string table */
+static void musvg_transcode_header(musvg_parser *p)
 {
-    // empty
+    musvg_transcoder *t = p->transcoder;
+    t->header = 1;
+    if (!musvg_transcode_binary(t->format)) return;
+    if (!t->scanned && p->string_table) {
+        for (size_t i = 0; i < array_buffer_count(&p->string_table->refs); i++) {
+            musvg_transcode_intern(p, musvg_string_table_ref(p->string_table, i));
+        }
+    }
+    mu_buf *tables = mu_resizable_buf_new();
+    musvg_binary_header_write(tables, t->format, t->grid_digits, 0);
+    musvg_string_table_write(p, tables, &t->strings);
+    musvg_write_pieces(t->out, tables->data, tables->write_marker);
+    mu_buf_destroy(tables);
 }
 
-// SVG parsers
-
-int musvg_parse_svg_xml(musvg_parser* p, mu_buf *buf)
+/* emitters see the output string table and grid in place of the input ones */
+static void musvg_transcode_emit(musvg_parser *p, musvg_node_visit_fn fn,
+    musvg_index node_idx, uint close)
 {
-    /* copy the source buffer due to xml parse modifying the
-     * buffer to allow in-place zero-termination of attributes.
-     * also make it look like we read from the source buffer. */
-    mu_buf *tmp = mu_buf_new(buf->write_marker + 1);
-    mu_buf_write_bytes(tmp, buf->data, buf->write_marker);
-    mu_buf_write_i8(buf, 0);
-    int ret = musvg_parse_xml(tmp->data, musvg_start_element,
-                              musvg_end_element, musvg_content, p);
-    buf->read_marker = buf->write_marker;
-    mu_buf_destroy(tmp);
-    return ret;
+    musvg_transcoder *t = p->transcoder;
+    musvg_string_table *strings = p->string_table;
+    musvg_class_table *classes = p->class_table;
+    int grid_digits = p->grid_digits;
+
+    if (!t->header) musvg_transcode_header(p);
+    p->string_table = &t->strings;
+    p->class_table = NULL;
+    p->grid_digits = t->grid_digits;
+    fn(p, t->out, node_idx, p->node_depth - 1, close);
+    p->string_table = strings;
+    p->class_table = classes;
+    p->grid_digits = grid_digits;
 }
 
-int musvg_parse_binary(musvg_parser *p, mu_buf *buf)
+/* gathers the strings of a node and the grid that its points need */
+static void musvg_transcode_scan(musvg_parser *p, musvg_index node_idx)
 {
-    musvg_small element, attr;
-
-    for (;;) {
-        if (!mu_buf_read_i8(buf, &element)) return 0;
-        element = element % (musvg_element_limit + 1);
-        if (element == musvg_element_none) {
-            musvg_stack_pop(p);
-            continue;
-        }
-
-        musvg_index node_idx = musvg_node_add(p, element);
-
-        for (;;) {
-            if (!mu_buf_read_i8(buf, &attr)) return -1;
-            attr = attr % (musvg_attr_limit + 1);
-            if (attr == musvg_attr_none) break;
+    musvg_transcoder *t = p->transcoder;
+    musvg_transcode_mark *m = t->marks + p->node_depth - 1;
+    musvg_index slots[64];
+    size_t sz = array_size(slots);
 
-            musvg_attr_buf_fn read_fn = musvg_binary_parsers[musvg_attr_types[attr]];
-            int ret = read_fn(p, buf, node_idx, as_attr(attr));
-        }
+    musvg_node_attr_slots(p, node_idx, slots, &sz);
+    for (size_t i = 0; i < sz; i++) {
+        musvg_index str = musvg_slot_string(p, slots[i]);
+        if (str) musvg_transcode_intern(p, str);
+    }
+    if (t->format == musvg_format_binary_delta && p->grid_precision < 0 &&
+        points_count(p) > m->points) {
+        t->grid_digits = musvg_grid_digits(p, m->points, t->grid_digits);
     }
+}
 
-    musvg_hash_sum(p);
+static void musvg_transcode_fail(musvg_parser *p, int error)
+{
+    assert(p->transcoder);
+    if (!p->transcoder->error) p->transcoder->error = error;
+}
 
-    return 0;
+static void musvg_transcode_keep(musvg_parser *p)
+{
+    p->transcoder->keep_storage = storage_size(p);
+    p->transcoder->keep_strings = strings_size(p);
 }
 
-int musvg_parse_binary_vf(musvg_parser* p, mu_buf *buf)
+/* adds a node, recording where its allocations start */
+static musvg_index musvg_transcode_node_add(musvg_parser *p, musvg_element type)
 {
-    p->f32_read = mu_vf128_f32_read;
-    p->f32_read_vec = mu_vf128_f32_read_vec;
-    return musvg_parse_binary(p, buf);
+    musvg_transcoder *t = p->transcoder;
+    if (t->pending) {
+        musvg_transcode_emit(p, t->begin_fn, t->pending - 1, 0);
+        t->pending = 0;
+    }
+    if (p->node_depth == musvg_max_depth) abort();
+    musvg_transcode_mark m = {
+        nodes_count(p), slots_count(p), points_count(p),
+        path_ops_count(p), path_points_count(p),
+        storage_size(p), strings_size(p)
+    };
+    t->marks[p->node_depth] = m;
+    return musvg_node_add(p, type);
 }
 
-int  musvg_parse_binary_ieee(musvg_parser* p, mu_buf *buf)
+/* writes a node once its attributes are read */
+static void musvg_transcode_open(musvg_parser *p, musvg_index node_idx)
 {
-    p->f32_read = mu_ieee754_f32_read;
-    p->f32_read_vec = mu_ieee754_f32_read_vec;
-    return musvg_parse_binary(p, buf);
+    musvg_transcoder *t = p->transcoder;
+    if (!t->out) {
+        musvg_transcode_scan(p, node_idx);
+    } else if (t->format == musvg_format_xml) {
+        t->pending = node_idx + 1;
+    } else {
+        musvg_transcode_emit(p, t->begin_fn, node_idx, 0);
+    }
 }
 
-int musvg_parse_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf)
+/* writes the end of the innermost node and releases its allocations */
+static void musvg_transcode_close(musvg_parser *p)
 {
-    switch (format) {
-    case musvg_format_xml:         return musvg_parse_svg_xml(p, buf);
-    case musvg_format_binary_vf:   return musvg_parse_binary_vf(p, buf);
-    case musvg_format_binary_ieee: return musvg_parse_binary_ieee(p, buf);
-    default: return -1;
+    musvg_transcoder *t = p->transcoder;
+    if (p->node_depth == 0) abort();
+    musvg_index node_idx = p->node_stack[p->node_depth - 1];
+    if (t->out) {
+        uint close = t->pending == node_idx + 1;
+        if (close) {
+            musvg_transcode_emit(p, t->begin_fn, node_idx, 1);
+            t->pending = 0;
+        }
+        musvg_transcode_emit(p, t->end_fn, node_idx, close);
     }
+    musvg_stack_pop(p);
+
+    musvg_transcode_mark *m = t->marks + p->node_depth;
+    vec_truncate(&p->nodes, m->nodes);
+    vec_truncate(&p->slots, m->slots);
+    vec_truncate(&p->points, m->points);
+    vec_truncate(&p->path_ops, m->path_ops);
+    vec_truncate(&p->path_points, m->path_points);
+    storage_buffer_truncate(&p->storage,
+        m->storage > t->keep_storage ? m->storage : t->keep_storage);
+    storage_buffer_truncate(&p->strings,
+        m->strings > t->keep_strings ? m->strings : t->keep_strings);
+    p->node_stack[p->node_depth] = 0;
+    if (p->node_depth > 0) node_set_down(p, p->node_stack[p->node_depth - 1], 0);
+}
+
+/* one pass over the input, closing elements that are left open at its end */
+static int musvg_transcode_pass(musvg_parser *p, musvg_format_t in_format, int fd)
+{
+    mu_buf *buf = mu_buffered_reader_fd(fd);
+    int ret = mu_buf_resize(buf, musvg_read_block_size) < 0
+        ? -musvg_error_io : musvg_parse_buffer(p, in_format, buf);
+    mu_buf_set_fd(buf, -1);
+    mu_buf_destroy(buf);
+    while (ret == 0 && p->node_depth > 0) musvg_transcode_close(p);
+    return ret;
 }
 
-int musvg_parse_file(musvg_parser* p, musvg_format_t format, const char *filename)
+/* copies input that cannot seek to a temporary file for the second pass */
+static FILE* musvg_transcode_spool(int fd)
 {
-    if (strcmp(filename,"-") == 0) {
-        return musvg_parse_fd(p, format, fileno(stdin));
+    FILE *spool = tmpfile();
+    char *block = (char*)malloc(musvg_read_block_size);
+    ssize_t n = 0;
+    while (spool && (n = read(fd, block, musvg_read_block_size)) > 0) {
+        if (fwrite(block, 1, n, spool) != (size_t)n) n = -1;
+        if (n < 0) break;
     }
+    free(block);
+    if (spool && (n < 0 || fflush(spool) != 0)) {
+        fclose(spool);
+        spool = NULL;
+    }
+    return spool;
+}
 
-    musvg_span span = musvg_read_file(filename);
-    mu_buf *buf = mu_buf_memory_new(span.data, span.size);
-    int ret = musvg_parse_buffer(p, format, buf);
-    mu_buf_destroy(buf);
-    free(span.data);
+/*
+ * transcodes from in_fd to out_fd. like musvg_emit_fd, the output
+ * descriptor is closed, and -musvg_error_io is returned if the output
+ * could not be written. returns -musvg_error_format before using either
+ * descriptor when a format cannot be streamed.
+ */
+int musvg_transcode_fd(musvg_parser* p, musvg_format_t in_format, int in_fd,
+                       musvg_format_t out_format, int out_fd)
+{
+    if (!musvg_transcode_formats(in_format, out_format)) return -musvg_error_format;
+
+    musvg_transcoder *t = (musvg_transcoder*)calloc(1, sizeof(musvg_transcoder));
+    int scan = musvg_transcode_binary(out_format) && (in_format == musvg_format_xml ||
+        (out_format == musvg_format_binary_delta && p->grid_precision < 0));
+    off_t start = lseek(in_fd, 0, SEEK_CUR);
+    FILE *spool = NULL;
+    int fd = in_fd, ret = 0;
+
+    musvg_string_table_init(&t->strings);
+    t->format = out_format;
+    t->grid_digits = out_format != musvg_format_binary_delta ? -1
+        : p->grid_precision < 0 ? 0 : p->grid_precision;
+    p->transcoder = t;
+
+    if (scan) {
+        if (start < 0) {
+            if (!(spool = musvg_transcode_spool(in_fd))) ret = -musvg_error_io;
+            else fd = fileno(spool);
+            start = 0;
+        }
+        if (ret == 0 && lseek(fd, start, SEEK_SET) < 0) ret = -musvg_error_io;
+        if (ret == 0) ret = musvg_transcode_pass(p, in_format, fd);
+        if (ret == 0 && lseek(fd, start, SEEK_SET) < 0) ret = -musvg_error_io;
+        t->scanned = 1;
+    }
+
+    switch (out_format) {
+    case musvg_format_text:
+        t->begin_fn = musvg_emit_text_begin;
+        t->end_fn = musvg_emit_text_end;
+        break;
+    case musvg_format_xml:
+        t->begin_fn = musvg_emit_xml_begin;
+        t->end_fn = musvg_emit_xml_end;
+        break;
+    default:
+        t->begin_fn = musvg_emit_binary_begin;
+        t->end_fn = musvg_emit_binary_end;
+        break;
+    }
+    if (out_format == musvg_format_binary_ieee) {
+        p->f32_write = mu_ieee754_f32_write_byval;
+        p->f32_write_vec = mu_ieee754_f32_write_vec;
+    } else {
+        p->f32_write = mu_vf128_f32_write_byval;
+        p->f32_write_vec = mu_vf128_f32_write_vec;
+    }
+    t->out = musvg_writer_fd(p, out_fd);
+    if (ret == 0) ret = musvg_transcode_pass(p, in_format, fd);
+    if (ret == 0 && !t->header) musvg_transcode_header(p);
+    if (ret == 0) ret = t->error;
+    if (mu_buf_destroy(t->out) < 0 && ret == 0) ret = -musvg_error_io;
+
+    p->transcoder = NULL;
+    musvg_string_table_destroy(&t->strings);
+    free(t);
+    if (spool) fclose(spool);
     return ret;
 }
 
-int musvg_parse_fd(musvg_parser* p, musvg_format_t format, int fd)
+int musvg_transcode_file(musvg_parser* p, musvg_format_t in_format, const char *in_filename,
+                         musvg_format_t out_format, const char *out_filename)
 {
-    musvg_span span = musvg_read_fd(fd);
-    mu_buf *buf = mu_buf_memory_new(span.data, span.size);
-    int ret = musvg_parse_buffer(p, format, buf);
-    mu_buf_destroy(buf);
-    free(span.data);
+    if (!musvg_transcode_formats(in_format, out_format)) return -musvg_error_format;
+
+    int in_stdin = strcmp(in_filename, "-") == 0;
+    int in_fd = in_stdin ? fileno(stdin) : open(in_filename, O_RDONLY);
+    if (in_fd < 0) return -musvg_error_io;
+    int out_fd = strcmp(out_filename, "-") == 0 ? fileno(stdout)
+        : open(out_filename, O_CREAT|O_TRUNC|O_WRONLY, 0666);
+    int ret = out_fd < 0 ? -musvg_error_io
+        : musvg_transcode_fd(p, in_format, in_fd, out_format, out_fd);
+    if (!in_stdin) close(in_fd);
     return ret;
 }
 
@@ -2936,9 +7473,19 @@ int musvg_parse_fd(musvg_parser* p, musvg_format_t format, int fd)
 
 void musvg_hash_work_fn(void *arg, size_t thr_idx, size_t item_idx);
 
-musvg_parser* musvg_parser_create()
+static void musvg_work_fn(void *arg, size_t thr_idx, size_t item_idx)
+{
+    musvg_parser *p = (musvg_parser*)arg;
+    if (p->chunks) {
+        /* work items are numbered from one after mule_reset */
+        musvg_parse_chunk(p->chunks + item_idx - 1);
+    } else {
+        musvg_hash_work_fn(arg, thr_idx, item_idx);
+    }
+}
+
+static void musvg_parser_init(musvg_parser *p)
 {
-    musvg_parser* p = (musvg_parser*)malloc(sizeof(musvg_parser));
     memset(p,0,sizeof(musvg_parser));
 
     points_init(p);
@@ -2960,14 +7507,15 @@ musvg_parser* musvg_parser_create()
     assert(storage_size(p) == 1);
     assert(strings_size(p) == 1);
 
-    mule_init(&p->mule, 1, musvg_hash_work_fn, p);
-    mule_start(&p->mule);
-
-    return p;
+    p->grid_digits = -1;
+    p->grid_precision = -1;
+    p->write_buffer_size = musvg_write_buffer_size;
+    p->write_buffers = musvg_write_buffers;
 }
 
-void musvg_parser_destroy(musvg_parser *p)
+static void musvg_parser_fini(musvg_parser *p)
 {
+    if (p->image.data) musvg_image_unmap(p);
     points_destroy(p);
     path_ops_destroy(p);
     path_points_destroy(p);
@@ -2976,12 +7524,90 @@ void musvg_parser_destroy(musvg_parser *p)
     slots_destroy(p);
     storage_destroy(p);
     strings_destroy(p);
+}
+
+musvg_parser* musvg_parser_create()
+{
+    musvg_parser* p = (musvg_parser*)malloc(sizeof(musvg_parser));
+    musvg_parser_init(p);
+
+    mule_init(&p->mule, 1, musvg_work_fn, p);
+    mule_start(&p->mule);
+
+    return p;
+}
+
+musvg_parser* musvg_parser_open_image(const char *filename)
+{
+    musvg_span image;
+#ifndef _WIN32
+    struct stat st;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0) return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    image.size = st.st_size;
+    image.data = (char*)mmap(NULL, image.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image.data == (char*)MAP_FAILED) return NULL;
+#else
+    image = musvg_read_file(filename);
+#endif
+
+    musvg_parser* p = musvg_parser_create();
+    if (musvg_image_map(p, image) < 0) {
+        musvg_image_release(image);
+        musvg_parser_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+void musvg_parser_destroy(musvg_parser *p)
+{
+    musvg_parser_fini(p);
 
     mule_destroy(&p->mule);
 
     free(p);
 }
 
+void musvg_parser_set_threads(musvg_parser *p, size_t num_threads)
+{
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > mumule_max_threads) num_threads = mumule_max_threads;
+    if (num_threads == p->mule.num_threads) return;
+
+    mule_destroy(&p->mule);
+    mule_init(&p->mule, num_threads, musvg_work_fn, p);
+    mule_start(&p->mule);
+}
+
+void musvg_parser_set_precision(musvg_parser *p, int digits)
+{
+    if (digits > musvg_grid_max_digits) digits = musvg_grid_max_digits;
+    p->grid_precision = digits < 0 ? -1 : digits;
+}
+
+void musvg_parser_set_index(musvg_parser *p, int enabled)
+{
+    p->subtree_index = !!enabled;
+}
+
+void musvg_parser_set_classes(musvg_parser *p, int enabled)
+{
+    p->style_classes = !!enabled;
+}
+
+void musvg_parser_set_write_buffers(musvg_parser *p, size_t size, size_t count)
+{
+    p->write_buffer_size = size ? size : musvg_write_buffer_size;
+    p->write_buffers = count;
+}
+
 // SVG parser stats
 
 static void print_stats_titles()
@@ -3023,6 +7649,24 @@ static void print_summary_totals(musvg_parser *p)
         "totals", "", "", "", size, capacity);
 }
 
+/* the high water mark of the process, including input buffers and mappings */
+static void print_peak_rss()
+{
+#ifndef _WIN32
+    /* ru_maxrss is in bytes on macOS and kilobytes elsewhere */
+#if defined(__APPLE__)
+    const size_t unit = 1;
+#else
+    const size_t unit = 1024;
+#endif
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        printf("%-15s %5s %10s %10s %10s %10zu\n",
+            "peak_rss", "", "", "", "", (size_t)ru.ru_maxrss * unit);
+    }
+#endif
+}
+
 void musvg_parser_stats(musvg_parser* p)
 {
     print_stats_titles();
@@ -3037,7 +7681,7 @@ void musvg_parser_stats(musvg_parser* p)
     print_storage_stats(&p->strings, "strings");
     //print_array_stats(&p->brushes, sizeof(musvg_brush), "brushes");
     print_stats_lines();
-    print_summary_totals(p);
+    print_summary_totals(p);    print_peak_rss();
 }
 
 // dump
@@ -3092,47 +7736,43 @@ void musvg_parser_types()
 
 // file io helper functions
 
-musvg_span musvg_read_file(const char* filename)
+/*
+ * regular files are read with one call sized by fstat, pipes in blocks
+ * that double as they fill. the span is terminated but its size is not.
+ */
+musvg_span musvg_read_fd(int fd)
 {
-    FILE* fp;
-    musvg_span span;
+    musvg_span span = { NULL, 0 };
+    size_t capacity = musvg_read_block_size;
+    struct stat st;
+    ssize_t nread;
 
-    assert((fp = fopen(filename, "rb")));
-    assert(!fseek(fp, 0, SEEK_END));
-    assert((span.size = ftell(fp)));
-    assert(!fseek(fp, 0, SEEK_SET));
-    assert((span.data = (char*)malloc(span.size + 1)));
-    assert(fread(span.data, 1, span.size, fp) == span.size);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        capacity = (size_t)st.st_size + 1;
+    }
+    assert((span.data = (char*)malloc(capacity)));
+    for (;;) {
+        if (capacity - span.size < 2) {
+            assert((span.data = (char*)realloc(span.data, capacity *= 2)));
+        }
+        nread = read(fd, span.data + span.size, capacity - span.size - 1);
+        if (nread < 0 && errno == EINTR) continue;
+        if (nread <= 0) break;
+        span.size += nread;
+    }
     span.data[span.size] = '\0';
-    assert(!fclose(fp));
 
     return span;
 }
 
-musvg_span musvg_read_fd(int fd)
+musvg_span musvg_read_file(const char* filename)
 {
-    FILE* fp;
     musvg_span span;
-    mu_buf *buf;
-    char temp[4096];
-    size_t nread;
-
-    buf = mu_resizable_buf_new();
-    buf->retain = 1; /* keep the buffer */
-    assert((fp = fdopen(fd, "rb")));
-
-    do {
-        nread = fread(temp, 1, sizeof(temp), fp);
-        if (nread > 1) {
-            assert(mu_buf_write_bytes(buf, temp, nread) == nread);
-        }
-    } while (nread > 0);
-
-    mu_buf_write_i8(buf, 0);
+    int fd;
 
-    span.data = buf->data;
-    span.size = buf->write_marker;
-    mu_buf_destroy(buf);
+    assert((fd = open(filename, O_RDONLY)) >= 0);
+    span = musvg_read_fd(fd);
+    assert(!close(fd));
 
     return span;
 }
@@ -3189,15 +7829,22 @@ int musvg_node_attr_slots(musvg_parser *p, musvg_index node_idx, musvg_index *sl
 
 int musvg_attr_value_set_value(musvg_parser *p, musvg_index node_idx, musvg_attr attr, const char *value, size_t len)
 {
-    musvg_index storage = find_attr(p, node_idx, attr);
-    if (storage == 0) {
+    musvg_index slot_idx = node_attr(p, node_idx);
+    while (slot_idx && slot_type(p, slot_idx) != attr) slot_idx = slot_left(p, slot_idx);
+    if (slot_idx == 0) {
         /* node attribute offset entries must all be adjacent so if the last
          * entry on the node is not the last entry in the array then we need
          * to copy all the attribute map entries. */
         return -1;
     }
+    /* values decoded from a style class are shared between nodes,
+     * so the slot is given its own copy before it is replaced */
+    const musvg_type_meta *meta = &musvg_type_storage[musvg_attr_types[attr]];
+    musvg_index storage = storage_alloc(p, meta->size, meta->align);
+    memcpy(storage_get(p, storage), storage_get(p, slot_storage(p, slot_idx)), meta->size);
+    slots_get(p, slot_idx)->storage = mnu_int48_set(storage);
     musvg_attr_str_fn fn = musvg_text_parsers[musvg_attr_types[attr]];
-    int ret = fn(p, value, node_idx, attr);
+    int ret = fn(p, value, len, node_idx, attr);
     return 0;
 }
 
@@ -62,6 +62,7 @@ typedef llong musvg_index;
 #ifndef __cplusplus
 typedef enum musvg_path_opcode_t musvg_path_opcode_t;
 typedef enum musvg_format_t musvg_format_t;
+typedef enum musvg_error_t musvg_error_t;
 typedef enum musvg_brush_t musvg_brush_t;
 typedef enum musvg_spread_t musvg_spread_t;
 typedef enum musvg_linejoin_t musvg_linejoin_t;
@@ -107,6 +108,26 @@ enum musvg_format_t {
     musvg_format_xml,
     musvg_format_binary_vf,
     musvg_format_binary_ieee,
+    musvg_format_binary_delta,
+    musvg_format_binary_columnar,
+    musvg_format_image,
+    musvg_format_binary_entropy,
+};
+enum musvg_error_t {
+    musvg_error_none,
+    musvg_error_invalid,       /* malformed input */
+    musvg_error_truncated,     /* input ends inside a record */
+    musvg_error_element,       /* element out of range */
+    musvg_error_attr,          /* attribute out of range or not allowed */
+    musvg_error_value,         /* enum, unit, type or opcode out of range */
+    musvg_error_count,         /* count larger than its array */
+    musvg_error_string,        /* string index out of range */
+    musvg_error_class,         /* class index out of range */
+    musvg_error_float,         /* float encoding out of range */
+    musvg_error_depth,         /* nesting too deep or closed too often */
+    musvg_error_io,            /* file cannot be opened, read or written */
+    musvg_error_format,        /* format, version or stream not supported */
+    musvg_error_limit = musvg_error_format
 };
 enum musvg_element {
     musvg_element_none,
@@ -393,7 +414,7 @@ enum musvg_type_t
     musvg_type_points,
 };
 
-typedef musvg_small (*parse_enum_fn)(const char* units);
+typedef musvg_small (*parse_enum_fn)(const char* str, size_t len);
 
 struct musvg_typeinfo_enum
 {
@@ -429,12 +450,21 @@ struct musvg_brush
 typedef struct mu_buf mu_buf;
 
 musvg_parser* musvg_parser_create();
+musvg_parser* musvg_parser_open_image(const char *filename);
 void musvg_parser_destroy(musvg_parser* p);
+void musvg_parser_set_threads(musvg_parser* p, size_t num_threads);
+void musvg_parser_set_precision(musvg_parser* p, int digits);
+void musvg_parser_set_index(musvg_parser* p, int enabled);
+void musvg_parser_set_classes(musvg_parser* p, int enabled);
+void musvg_parser_set_write_buffers(musvg_parser* p, size_t size, size_t count);
 void musvg_parser_stats(musvg_parser* p);
 void musvg_parser_dump(musvg_parser* p);
 void musvg_parser_types();
 
 musvg_small musvg_parse_format(const char *format);
+const char* musvg_error_name(int err);
+musvg_small musvg_parse_element_name(const char *name, size_t len);
+musvg_small musvg_parse_attr_name(const char *name, size_t len);
 
 int musvg_emit_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf);
 int musvg_emit_file(musvg_parser* p, musvg_format_t format, const char *filename);
@@ -444,6 +474,18 @@ int musvg_parse_buffer(musvg_parser* p, musvg_format_t format, mu_buf *buf);
 int musvg_parse_file(musvg_parser* p, musvg_format_t format, const char *filename);
 int musvg_parse_fd(musvg_parser* p, musvg_format_t format, int fd);
 
+/* streaming transcoder api */
+
+int musvg_transcode_file(musvg_parser* p, musvg_format_t in_format, const char *in_filename,
+                         musvg_format_t out_format, const char *out_filename);
+int musvg_transcode_fd(musvg_parser* p, musvg_format_t in_format, int in_fd,
+                       musvg_format_t out_format, int out_fd);
+
+/* indexed binary subtree api */
+
+int musvg_subtree_count(musvg_format_t format, mu_buf *buf);
+int musvg_parse_subtree(musvg_parser* p, musvg_format_t format, mu_buf *buf, size_t subtree);
+
 typedef void (*musvg_node_visit_fn)(musvg_parser *, void *, musvg_index, uint depth, uint close);
 void musvg_visit(musvg_parser* p, void *userdata, musvg_node_visit_fn begin_fn, musvg_node_visit_fn end_fn);
 
@@ -95,6 +95,27 @@ static void mu_vec_destroy(mu_vec *mv)
 	}
 }
 
+/*
+ * points the extents of an empty vector at a contiguous array that is
+ * owned by the caller, such as a memory mapped file. the last extent
+ * may be partial so a mapped vector must not grow. mu_vec_unmap must
+ * be used in place of mu_vec_destroy to release the vector.
+ */
+static void mu_vec_map(mu_vec *mv, size_t stride, void *data, size_t count)
+{
+	memset(mv, 0, sizeof(mu_vec));
+	for (mu_index_t extent = 0; _mu_vec_extent_base(extent) < (mu_index_t)count; extent++) {
+		mv->extents[extent] = (char*)data + _mu_vec_extent_base(extent) * stride;
+	}
+	mv->capacity = count;
+	mv->count = count;
+}
+
+static void mu_vec_unmap(mu_vec *mv)
+{
+	memset(mv, 0, sizeof(mu_vec));
+}
+
 static size_t mu_vec_count(mu_vec *mv)
 {
     return mv->count;
@@ -123,6 +144,22 @@ static void* mu_vec_get(mu_vec *mv, size_t stride, size_t idx)
     return (char*)extent_mem + (idx - base) * stride;
 }
 
+/*
+ * returns a pointer to element idx, allocating its extent if needed,
+ * and the number of contiguous elements from idx to the end of the
+ * extent. used to write runs of elements in place before committing
+ * them with mu_vec_alloc.
+ */
+static void* mu_vec_span(mu_vec *mv, size_t stride, size_t idx, size_t *count)
+{
+	mu_index_t extent = _mu_vec_extent_num(idx);
+	_mu_vec_ensure_extents(mv, stride, extent, extent);
+	mu_index_t base = _mu_vec_extent_base(extent);
+	void *extent_mem = atomic_load((_Atomic(void*)*)(mv->extents + extent));
+	*count = _mu_vec_extent_size(extent) - (idx - base);
+	return (char*)extent_mem + (idx - base) * stride;
+}
+
 static void mu_vec_set(mu_vec *mv, size_t stride, size_t idx, void *ptr)
 {
     size_t extent = _mu_vec_extent_num(idx);
@@ -170,3 +207,12 @@ static size_t mu_vec_add_relaxed(mu_vec *mv, size_t stride, void *ptr)
     mu_vec_set(mv, stride, idx, ptr);
     return idx;
 }
+
+/*
+ * drops the elements from count to the end. extents stay allocated so
+ * a vector that is truncated and refilled does not allocate again.
+ */
+static void mu_vec_truncate(mu_vec *mv, size_t count)
+{
+    if (count < mv->count) mv->count = count;
+}
@@ -16,16 +16,20 @@ typedef struct mu_vec mu_vec;
 static void mu_vec_init(mu_vec *mv, size_t stride, size_t capacity);
 static void mu_vec_resize(mu_vec *mv, size_t stride, size_t count);
 static void mu_vec_destroy(mu_vec *mv);
+static void mu_vec_map(mu_vec *mv, size_t stride, void *data, size_t count);
+static void mu_vec_unmap(mu_vec *mv);
 static size_t mu_vec_count(mu_vec *mv);
 static size_t mu_vec_size(mu_vec *mv, size_t stride);
 static size_t mu_vec_capacity(mu_vec *mv, size_t stride);
 static int mu_vec_linear(mu_vec *mv, size_t idx, size_t count);
 static void* mu_vec_get(mu_vec *mv, size_t stride, size_t idx);
+static void* mu_vec_span(mu_vec *mv, size_t stride, size_t idx, size_t *count);
 static void mu_vec_set(mu_vec *mv, size_t stride, size_t idx, void *ptr);
 static size_t mu_vec_alloc_atomic(mu_vec *mv, size_t stride, size_t count);
 static size_t mu_vec_alloc_relaxed(mu_vec *mv, size_t stride, size_t count);
 static size_t mu_vec_add_atomic(mu_vec *mv, size_t stride, void *ptr);
 static size_t mu_vec_add_relaxed(mu_vec *mv, size_t stride, void *ptr);
+static void mu_vec_truncate(mu_vec *mv, size_t count);
 
 #include "muvec.c"
 
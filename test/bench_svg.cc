@@ -18,6 +18,8 @@
 
 using namespace std::chrono;
 
+#define array_size(arr) ((sizeof(arr)/sizeof(arr[0])))
+
 typedef signed long long llong;
 typedef unsigned long long ullong;
 
@@ -41,7 +43,7 @@ static void _millisleep(llong sleep_ms)
 }
 
 struct bench_result { const char *name; llong count; double t; llong size; };
-struct bench_info { const char *name; const char *path; musvg_format_t format; };
+struct bench_info { const char *name; const char *path; musvg_format_t format; size_t threads; };
 typedef bench_result (*bench_fn)(llong count, bench_info *info);
 struct benchmark { bench_fn fn; bench_info info; };
 
@@ -65,10 +67,466 @@ static bench_result bench_parse(llong count, bench_info *info)
     return bench_result { info->name, count, t, (llong)span.size * count };
 }
 
+/* maps the image in place, so the cost is independent of document size */
+static bench_result bench_open_image(llong count, bench_info *info)
+{
+    musvg_span span = musvg_read_file(info->path);
+    free(span.data);
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        musvg_parser *p = musvg_parser_open_image(info->path);
+        assert(p);
+        musvg_parser_destroy(p);
+    }
+    auto et = high_resolution_clock::now();
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)span.size * count };
+}
+
+/* the document with the children of the root element repeated so that
+ * it is large enough to be split by the parallel parser */
+static musvg_span bench_large_document(const char *path, size_t repeat)
+{
+    musvg_span span = musvg_read_file(path);
+    char *root = strstr(span.data, "<svg");
+    char *end = strstr(span.data, "</svg>");
+    assert(root && end);
+    char *begin = strchr(root, '>') + 1;
+    size_t prefix = begin - span.data, body = end - begin;
+    size_t suffix = span.size - (end - span.data);
+    musvg_span large = { (char*)malloc(prefix + body * repeat + suffix), 0 };
+    memcpy(large.data, span.data, prefix);
+    large.size = prefix;
+    for (size_t i = 0; i < repeat; i++, large.size += body) {
+        memcpy(large.data + large.size, begin, body);
+    }
+    memcpy(large.data + large.size, end, suffix);
+    large.size += suffix;
+    free(span.data);
+    return large;
+}
+
+static bench_result bench_parse_threads(llong count, bench_info *info)
+{
+    musvg_span span = bench_large_document(info->path, 32);
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        mu_buf *buf = mu_buf_memory_new(span.data, span.size);
+        musvg_parser *p = musvg_parser_create();
+        musvg_parser_set_threads(p, info->threads);
+        assert(!musvg_parse_buffer(p, info->format, buf));
+        musvg_parser_destroy(p);
+        mu_buf_destroy(buf);
+    }
+    auto et = high_resolution_clock::now();
+
+    free(span.data);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)span.size * count };
+}
+
+/* color keywords spread over the table, in the hex, rgb() and keyword
+ * forms, to isolate the cost of color parsing */
+static const char* bench_colors[] = {
+    "red", "cornflowerblue", "darkslategrey", "lightgoldenrodyellow",
+    "papayawhip", "yellowgreen", "black", "mediumspringgreen", "tan",
+    "navajowhite", "steelblue", "white", "darkorange", "orchid",
+};
+
+static musvg_span bench_color_document(size_t count)
+{
+    mu_buf *buf = mu_resizable_buf_new();
+    mu_buf_write_string(buf, "<svg width=\"100\" height=\"100\">\n");
+    for (size_t i = 0; i < count; i++) {
+        const char *name = bench_colors[i % array_size(bench_colors)];
+        uint c = (uint)(i * 2654435761u);
+        switch (i & 3) {
+        case 0: mu_buf_write_format(buf, "<rect fill=\"%s\" stroke=\"#%03x\"/>\n",
+            name, c & 0xfff); break;
+        case 1: mu_buf_write_format(buf, "<rect fill=\"#%06x\" stroke=\"%s\"/>\n",
+            c & 0xffffff, name); break;
+        case 2: mu_buf_write_format(buf, "<rect fill=\"rgb(%u, %u, %u)\" stroke=\"%s\"/>\n",
+            c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, name); break;
+        case 3: mu_buf_write_format(buf, "<rect fill=\"%s\" stroke=\"rgb(%u%%,%u%%,%u%%)\"/>\n",
+            name, c % 101, (c >> 8) % 101, (c >> 16) % 101); break;
+        }
+    }
+    mu_buf_write_string(buf, "</svg>\n");
+    musvg_span span = { (char*)malloc(buf->write_marker), buf->write_marker };
+    memcpy(span.data, buf->data, span.size);
+    mu_buf_destroy(buf);
+    return span;
+}
+
+/* Inkscape style exports carry presentation attributes in style= */
+static musvg_span bench_style_document(size_t count)
+{
+    mu_buf *buf = mu_resizable_buf_new();
+    mu_buf_write_string(buf, "<svg width=\"100\" height=\"100\">\n");
+    for (size_t i = 0; i < count; i++) {
+        mu_buf_write_format(buf, "<rect x=\"%zu\" y=\"%zu\" width=\"10\" height=\"10\" "
+            "style=\"fill:%s;fill-opacity:1;fill-rule:nonzero;stroke:#%06x;"
+            "stroke-width:0.26458332;stroke-linecap:round;stroke-linejoin:miter;"
+            "stroke-miterlimit:4;stroke-dasharray:none;stroke-opacity:1\"/>\n",
+            i % 97, i % 89, bench_colors[i % array_size(bench_colors)],
+            (uint)(i * 2654435761u) & 0xffffff);
+    }
+    mu_buf_write_string(buf, "</svg>\n");
+    musvg_span span = { (char*)malloc(buf->write_marker), buf->write_marker };
+    memcpy(span.data, buf->data, span.size);
+    mu_buf_destroy(buf);
+    return span;
+}
+
+/* shapes painted with a handful of gradients, referenced by url() */
+static musvg_span bench_gradient_document(size_t count)
+{
+    mu_buf *buf = mu_resizable_buf_new();
+    mu_buf_write_string(buf, "<svg width=\"100\" height=\"100\">\n<defs>\n");
+    for (size_t i = 0; i < 8; i++) {
+        mu_buf_write_format(buf, "<linearGradient id=\"gradient-%zu\">"
+            "<stop offset=\"0\" stop-color=\"%s\"/><stop offset=\"1\" stop-color=\"%s\"/>"
+            "</linearGradient>\n", i, bench_colors[i], bench_colors[i + 1]);
+    }
+    mu_buf_write_string(buf, "</defs>\n");
+    for (size_t i = 0; i < count; i++) {
+        uint c = (uint)(i * 2654435761u);
+        mu_buf_write_format(buf, "<rect x=\"%zu\" y=\"%zu\" width=\"10\" height=\"10\" "
+            "fill=\"url(#gradient-%u)\" stroke=\"url(#gradient-%u)\"/>\n",
+            i % 97, i % 89, c & 7, (c >> 8) & 7);
+    }
+    mu_buf_write_string(buf, "</svg>\n");
+    musvg_span span = { (char*)malloc(buf->write_marker), buf->write_marker };
+    memcpy(span.data, buf->data, span.size);
+    mu_buf_destroy(buf);
+    return span;
+}
+
+/* converts an XML document to another format */
+static musvg_span bench_convert(musvg_span xml, musvg_format_t format, int classes)
+{
+    mu_buf *in = mu_buf_memory_new(xml.data, xml.size);
+    mu_buf *out = mu_resizable_buf_new();
+    musvg_parser *p = musvg_parser_create();
+    musvg_parser_set_classes(p, classes);
+    assert(!musvg_parse_buffer(p, musvg_format_xml, in));
+    assert(!musvg_emit_buffer(p, format, out));
+    musvg_span span = { (char*)malloc(out->write_marker), out->write_marker };
+    memcpy(span.data, out->data, span.size);
+    musvg_parser_destroy(p);
+    mu_buf_destroy(out);
+    mu_buf_destroy(in);
+    free(xml.data);
+    return span;
+}
+
+static bench_result bench_parse_span(llong count, bench_info *info, musvg_span span)
+{
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        mu_buf *buf = mu_buf_memory_new(span.data, span.size);
+        musvg_parser *p = musvg_parser_create();
+        assert(!musvg_parse_buffer(p, info->format, buf));
+        musvg_parser_destroy(p);
+        mu_buf_destroy(buf);
+    }
+    auto et = high_resolution_clock::now();
+
+    free(span.data);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)span.size * count };
+}
+
+static bench_result bench_parse_colors(llong count, bench_info *info)
+{
+    return bench_parse_span(count, info, bench_color_document(4096));
+}
+
+static bench_result bench_parse_style(llong count, bench_info *info)
+{
+    return bench_parse_span(count, info, bench_style_document(4096));
+}
+
+static bench_result bench_parse_gradients(llong count, bench_info *info)
+{
+    return bench_parse_span(count, info,
+        bench_convert(bench_gradient_document(4096), info->format, 0));
+}
+
+static bench_result bench_parse_classes(llong count, bench_info *info)
+{
+    return bench_parse_span(count, info,
+        bench_convert(musvg_read_file(info->path), info->format, 1));
+}
+
+/* the large document converted to an indexed binary file */
+static bench_result bench_parse_indexed(llong count, bench_info *info)
+{
+    musvg_span span = bench_large_document(info->path, 32);
+    mu_buf *in = mu_buf_memory_new(span.data, span.size);
+    mu_buf *out = mu_resizable_buf_new();
+    musvg_parser *q = musvg_parser_create();
+    assert(!musvg_parse_buffer(q, musvg_format_xml, in));
+    musvg_parser_set_index(q, 1);
+    assert(!musvg_emit_buffer(q, info->format, out));
+    musvg_parser_destroy(q);
+    mu_buf_destroy(in);
+    free(span.data);
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        mu_buf *buf = mu_buf_memory_new(out->data, out->write_marker);
+        musvg_parser *p = musvg_parser_create();
+        musvg_parser_set_threads(p, info->threads);
+        assert(!musvg_parse_buffer(p, info->format, buf));
+        musvg_parser_destroy(p);
+        mu_buf_destroy(buf);
+    }
+    auto et = high_resolution_clock::now();
+
+    llong size = (llong)out->write_marker;
+    mu_buf_destroy(out);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, size * count };
+}
+
+static bench_result bench_emit(llong count, bench_info *info)
+{
+    musvg_span span = musvg_read_file(info->path);
+    mu_buf *in = mu_buf_memory_new(span.data, span.size);
+    musvg_parser *p = musvg_parser_create();
+    assert(!musvg_parse_buffer(p, musvg_format_xml, in));
+
+    llong size = 0;
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        mu_buf *buf = mu_resizable_buf_new();
+        assert(!musvg_emit_buffer(p, info->format, buf));
+        size += (llong)buf->write_marker;
+        mu_buf_destroy(buf);
+    }
+    auto et = high_resolution_clock::now();
+
+    musvg_parser_destroy(p);
+    mu_buf_destroy(in);
+    free(span.data);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, size };
+}
+
+/* whole files copied into memory, or mapped by musvg_parse_file */
+static bench_result bench_parse_file(llong count, bench_info *info, int mapped)
+{
+    struct stat sb;
+    assert(!stat(info->path, &sb));
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        musvg_parser *p = musvg_parser_create();
+        if (mapped) {
+            assert(!musvg_parse_file(p, info->format, info->path));
+        } else {
+            musvg_span span = musvg_read_file(info->path);
+            mu_buf *in = mu_buf_memory_new(span.data, span.size);
+            assert(!musvg_parse_buffer(p, info->format, in));
+            mu_buf_destroy(in);
+            free(span.data);
+        }
+        musvg_parser_destroy(p);
+    }
+    auto et = high_resolution_clock::now();
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)sb.st_size * count };
+}
+
+static bench_result bench_parse_file_read(llong count, bench_info *info) { return bench_parse_file(count, info, 0); }
+static bench_result bench_parse_file_map(llong count, bench_info *info) { return bench_parse_file(count, info, 1); }
+
+/* the 32x document written to a file, inline or from the writer thread */
+static bench_result bench_emit_file(llong count, bench_info *info, size_t buffers)
+{
+    musvg_span span = bench_large_document(info->path, 32);
+    mu_buf *in = mu_buf_memory_new(span.data, span.size);
+    musvg_parser *p = musvg_parser_create();
+    assert(!musvg_parse_buffer(p, musvg_format_xml, in));
+    musvg_parser_set_write_buffers(p, 0, buffers);
+
+    struct stat sb;
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        assert(!musvg_emit_file(p, info->format, "test/output/bench-emit.out"));
+    }
+    auto et = high_resolution_clock::now();
+    assert(!stat("test/output/bench-emit.out", &sb));
+    llong size = (llong)sb.st_size * count;
+
+    musvg_parser_destroy(p);
+    mu_buf_destroy(in);
+    free(span.data);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, size };
+}
+
+static bench_result bench_emit_file_inline(llong count, bench_info *info) { return bench_emit_file(count, info, 0); }
+static bench_result bench_emit_file_async(llong count, bench_info *info) { return bench_emit_file(count, info, 2); }
+
+/* the 32x document converted through the node graph or by the streaming
+ * transcoder, which reads the XML twice to gather the string table */
+static bench_result bench_transcode(llong count, bench_info *info, int stream)
+{
+    const char *path = "test/output/bench-transcode.out";
+    struct stat sb;
+    assert(!stat(info->path, &sb));
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        musvg_parser *p = musvg_parser_create();
+        if (stream) {
+            assert(!musvg_transcode_file(p, musvg_format_xml, info->path, info->format, path));
+        } else {
+            assert(!musvg_parse_file(p, musvg_format_xml, info->path));
+            assert(!musvg_emit_file(p, info->format, path));
+        }
+        musvg_parser_destroy(p);
+    }
+    auto et = high_resolution_clock::now();
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)sb.st_size * count };
+}
+
+static bench_result bench_transcode_graph(llong count, bench_info *info) { return bench_transcode(count, info, 0); }
+static bench_result bench_transcode_stream(llong count, bench_info *info) { return bench_transcode(count, info, 1); }
+
+/* varints sized like path counts and string indices: mostly one byte,
+ * with a tail of two and three byte values and the odd large value */
+static mu_buf* bench_varint_buffer(int vlu, size_t count)
+{
+    mu_buf *buf = mu_resizable_buf_new();
+    uint x = 0x9e3779b9;
+    for (size_t i = 0; i < count; i++) {
+        x = x * 1664525u + 1013904223u;
+        u64 v = (x >> 28) < 12 ? (x >> 8) & 0x7f : (x >> 28) < 15 ? (x >> 8) & 0xfffff : x;
+        assert(!(vlu ? mu_vlu_u64_write(buf, &v) : mu_leb_u64_write(buf, &v)));
+    }
+    return buf;
+}
+
+static bench_result bench_varint(llong count, bench_info *info, int vlu, int vec)
+{
+    const size_t n = 65536;
+    mu_buf *buf = bench_varint_buffer(vlu, n);
+    u64 *values = (u64*)malloc(n * sizeof(u64));
+
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count; i++) {
+        mu_buf *in = mu_buf_memory_new(buf->data, buf->write_marker);
+        if (vec) {
+            assert(!(vlu ? mu_vlu_u64_read_vec : mu_leb_u64_read_vec)(in, values, n));
+        } else {
+            for (size_t j = 0; j < n; j++) {
+                assert(!(vlu ? mu_vlu_u64_read : mu_leb_u64_read)(in, values + j));
+            }
+        }
+        mu_buf_destroy(in);
+    }
+    auto et = high_resolution_clock::now();
+
+    llong size = (llong)buf->write_marker * count;
+    free(values);
+    mu_buf_destroy(buf);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, size };
+}
+
+static bench_result bench_decode_leb(llong count, bench_info *info) { return bench_varint(count, info, 0, 0); }
+static bench_result bench_decode_vlu(llong count, bench_info *info) { return bench_varint(count, info, 1, 0); }
+static bench_result bench_decode_leb_vec(llong count, bench_info *info) { return bench_varint(count, info, 0, 1); }
+static bench_result bench_decode_vlu_vec(llong count, bench_info *info) { return bench_varint(count, info, 1, 1); }
+
+/* element and attribute names as they appear in tiger.svg, plus names
+ * that are not recognised, to isolate the cost of name resolution */
+static const char* bench_names[] = {
+    "svg", "width", "height", "viewBox", "xmlns", "xmlns:xlink", "g",
+    "transform", "fill", "stroke", "stroke-width", "path", "d", "g",
+    "fill", "path", "d", "g", "stroke", "stroke-width", "path", "d",
+    "rect", "x", "y", "rx", "ry", "circle", "cx", "cy", "r", "style",
+    "linearGradient", "id", "x1", "y1", "x2", "y2", "stop", "offset",
+    "stop-color", "stop-opacity", "gradientUnits", "stroke-linecap",
+    "stroke-linejoin", "stroke-miterlimit", "fill-rule", "fill-opacity",
+    "sodipodi:nodetypes", "inkscape:label", "text", "version",
+};
+
+static bench_result bench_names_lookup(llong count, bench_info *info)
+{
+    size_t lens[array_size(bench_names)], size = 0;
+    for (size_t j = 0; j < array_size(bench_names); j++) {
+        size += (lens[j] = strlen(bench_names[j]));
+    }
+
+    llong sum = 0;
+    auto st = high_resolution_clock::now();
+    for (llong i = 0; i < count * 1000; i++) {
+        for (size_t j = 0; j < array_size(bench_names); j++) {
+            const char *name = bench_names[j];
+            sum += musvg_parse_element_name(name, lens[j]);
+            sum += musvg_parse_attr_name(name, lens[j]);
+        }
+    }
+    auto et = high_resolution_clock::now();
+    assert(sum > 0);
+
+    double t = (double)duration_cast<nanoseconds>(et - st).count();
+    return bench_result { info->name, count, t, (llong)size * count * 1000 };
+}
+
 static benchmark benchmarks[] = {
     { &bench_parse, { "parse-svg-xml",      "test/output/tiger.svg" , musvg_format_xml         } },
     { &bench_parse, { "parse-svgv-vf128",   "test/output/tiger.svgv", musvg_format_binary_vf   } },
-    { &bench_parse, { "parse-svgb-ieee754", "test/output/tiger.svgb", musvg_format_binary_ieee } }
+    { &bench_parse, { "parse-svgb-ieee754", "test/output/tiger.svgb", musvg_format_binary_ieee } },
+    { &bench_parse, { "parse-svgd-delta",   "test/output/tiger.svgd", musvg_format_binary_delta } },
+    { &bench_parse, { "parse-svgc-columnar", "test/output/tiger.svgc", musvg_format_binary_columnar } },
+    { &bench_parse, { "parse-svgi-image",   "test/output/tiger.svgi", musvg_format_image       } },
+    { &bench_open_image, { "open-svgi-image", "test/output/tiger.svgi", musvg_format_image       } },
+    { &bench_names_lookup, { "lookup-names",    nullptr,                  musvg_format_none        } },
+    { &bench_emit,  { "emit-svg-xml",       "test/output/tiger.svg" , musvg_format_xml         } },
+    { &bench_parse_threads, { "parse-xml-32x-1t", "test/output/tiger.svg", musvg_format_xml, 1 } },
+    { &bench_parse_threads, { "parse-xml-32x-2t", "test/output/tiger.svg", musvg_format_xml, 2 } },
+    { &bench_parse_threads, { "parse-xml-32x-4t", "test/output/tiger.svg", musvg_format_xml, 4 } },
+    { &bench_parse_threads, { "parse-xml-32x-8t", "test/output/tiger.svg", musvg_format_xml, 8 } },
+    { &bench_parse_indexed, { "parse-svgb-32x-1t", "test/output/tiger.svg", musvg_format_binary_ieee, 1 } },
+    { &bench_parse_indexed, { "parse-svgb-32x-4t", "test/output/tiger.svg", musvg_format_binary_ieee, 4 } },
+    { &bench_parse_colors, { "parse-colors-xml",  nullptr,                  musvg_format_xml         } },
+    { &bench_parse_style,  { "parse-style-xml",   nullptr,                  musvg_format_xml         } },
+    { &bench_parse, { "parse-svgr-entropy", "test/output/tiger.svgr", musvg_format_binary_entropy } },
+    { &bench_emit,  { "emit-svgr-entropy",  "test/output/tiger.svg" , musvg_format_binary_entropy } },
+    { &bench_emit,  { "emit-svgc-columnar", "test/output/tiger.svg" , musvg_format_binary_columnar } },
+    { &bench_parse_gradients, { "parse-grads-svgb", nullptr,                musvg_format_binary_ieee } },
+    { &bench_parse_classes, { "parse-svgb-classes", "test/output/tiger.svg", musvg_format_binary_ieee } },
+    { &bench_decode_leb,     { "decode-leb-64k",     nullptr,                  musvg_format_none        } },
+    { &bench_decode_vlu,     { "decode-vlu-64k",     nullptr,                  musvg_format_none        } },
+    { &bench_decode_leb_vec, { "decode-leb-vec-64k", nullptr,                  musvg_format_none        } },
+    { &bench_decode_vlu_vec, { "decode-vlu-vec-64k", nullptr,                  musvg_format_none        } },
+    { &bench_emit,  { "emit-svgb-ieee754",  "test/output/tiger.svg" , musvg_format_binary_ieee } },
+    { &bench_emit,  { "emit-svgv-vf128",    "test/output/tiger.svg" , musvg_format_binary_vf   } },
+    { &bench_emit_file_inline, { "emit-xml-32x-file-inline", "test/output/tiger.svg", musvg_format_xml } },
+    { &bench_emit_file_async,  { "emit-xml-32x-file-async",  "test/output/tiger.svg", musvg_format_xml } },
+    { &bench_parse_file_read, { "parse-svgb-32x-file-read", "test/output/tiger-32x.svgb", musvg_format_binary_ieee } },
+    { &bench_parse_file_map,  { "parse-svgb-32x-file-map",  "test/output/tiger-32x.svgb", musvg_format_binary_ieee } },
+    { &bench_transcode_graph,  { "xml-svgb-32x-graph",  "test/output/tiger-32x.svg", musvg_format_binary_ieee } },
+    { &bench_transcode_stream, { "xml-svgb-32x-stream", "test/output/tiger-32x.svg", musvg_format_binary_ieee } },
+    { &bench_transcode_graph,  { "xml-xml-32x-graph",   "test/output/tiger-32x.svg", musvg_format_xml } },
+    { &bench_transcode_stream, { "xml-xml-32x-stream",  "test/output/tiger-32x.svg", musvg_format_xml } },
 };
 
 static const char* format_unit(llong count)
@@ -105,8 +563,6 @@ static const char* format_comma(llong count)
     return buf;
 }
 
-#define array_size(arr) ((sizeof(arr)/sizeof(arr[0])))
-
 static void print_header(const char *prefix)
 {
     printf("%s%-24s %7s %7s %7s %7s %9s\n",
@@ -185,6 +641,33 @@ static void run_benchmark(size_t n, llong repeat, llong count, llong pause_ms)
     }
 }
 
+/* compressed svgr size relative to the svgv and svgb forms of the inputs */
+static const char* ratio_names[] = {
+    "tiger", "path", "colors", "style", "gradient-radial", "xform-matrix",
+};
+
+static llong file_size(const char *name, const char *ext)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "test/output/%s.%s", name, ext);
+    musvg_span span = musvg_read_file(path);
+    free(span.data);
+    return (llong)span.size;
+}
+
+static void print_ratios()
+{
+    printf("%-24s %9s %9s %9s %7s %7s\n",
+        "input", "svgv", "svgb", "svgr", "v/r", "b/r");
+    for (size_t i = 0; i < array_size(ratio_names); i++) {
+        llong v = file_size(ratio_names[i], "svgv");
+        llong b = file_size(ratio_names[i], "svgb");
+        llong r = file_size(ratio_names[i], "svgr");
+        printf("%-24s %9lld %9lld %9lld %7.2f %7.2f\n", ratio_names[i],
+            v, b, r, (double)v / r, (double)b / r);
+    }
+}
+
 #if defined(_WIN32)
 # define strtok_r strtok_s
 #endif
@@ -218,6 +701,8 @@ int main(int argc, char **argv)
             if (pause_ms > 0 && n > 0) _millisleep(pause_ms);
             run_benchmark(n, repeat, count, pause_ms);
         }
+        puts("");
+        print_ratios();
     } else {
         char *save, *comp = strtok_r(argv[1], ",", &save);
         while (comp) {
@@ -5,7 +5,7 @@ in=test/input
 out=test/output
 test -d ${out} || mkdir ${out}
 
-for name in tiger path ellipse circle line rect polygon polyline \
+for name in tiger path ellipse circle line rect polygon polyline colors style \
 	    gradient-href gradient-linear gradient-radial \
       xform-matrix xform-rotate xform-scale xform-translate;
 do
@@ -40,9 +40,375 @@ do
   diff ${out}/${name}.svg ${out}/${name}.svgb.svg > /dev/null
   r3=$?
 
-  if [ "$r1" -eq "0" -a "$r2" -eq "0" -a "$r3" -eq "0" ]; then
+  ${musvgtool} -i xml                    -o svgd                       \
+               -if ${in}/${name}.svg     -of ${out}/${name}.svgd
+  ${musvgtool} -i svgd                   -o text                       \
+               -if ${out}/${name}.svgd   -of ${out}/${name}.svgd.text
+  ${musvgtool} -i svgd                   -o xml                        \
+               -if ${out}/${name}.svgd   -of ${out}/${name}.svgd.svg
+
+  diff ${out}/${name}.svg ${out}/${name}.svgd.svg > /dev/null
+  r4=$?
+
+  ${musvgtool} -i xml                    -o svgc                       \
+               -if ${in}/${name}.svg     -of ${out}/${name}.svgc
+  ${musvgtool} -i svgc                   -o text                       \
+               -if ${out}/${name}.svgc   -of ${out}/${name}.svgc.text
+  ${musvgtool} -i svgc                   -o xml                        \
+               -if ${out}/${name}.svgc   -of ${out}/${name}.svgc.svg
+
+  diff ${out}/${name}.svg ${out}/${name}.svgc.svg > /dev/null
+  r5=$?
+
+  ${musvgtool} -i xml                    -o svgi                       \
+               -if ${in}/${name}.svg     -of ${out}/${name}.svgi
+  ${musvgtool} -i svgi                   -o text                       \
+               -if ${out}/${name}.svgi   -of ${out}/${name}.svgi.text
+  ${musvgtool} -i svgi                   -o xml                        \
+               -if ${out}/${name}.svgi   -of ${out}/${name}.svgi.svg
+  ${musvgtool} -i svgi                   -o xml                        \
+               -if - < ${out}/${name}.svgi -of ${out}/${name}.svgi.pipe.svg
+
+  diff ${out}/${name}.svg ${out}/${name}.svgi.svg > /dev/null &&
+  diff ${out}/${name}.svg ${out}/${name}.svgi.pipe.svg > /dev/null
+  r6=$?
+
+  ${musvgtool} -i xml                    -o svgr                       \
+               -if ${in}/${name}.svg     -of ${out}/${name}.svgr
+  ${musvgtool} -i svgr                   -o text                       \
+               -if ${out}/${name}.svgr   -of ${out}/${name}.svgr.text
+  ${musvgtool} -i svgr                   -o xml                        \
+               -if ${out}/${name}.svgr   -of ${out}/${name}.svgr.svg
+
+  diff ${out}/${name}.svg ${out}/${name}.svgr.svg > /dev/null
+  r7=$?
+
+  if [ "$r1" -eq "0" -a "$r2" -eq "0" -a "$r3" -eq "0" -a "$r4" -eq "0" -a "$r5" -eq "0" -a "$r6" -eq "0" -a "$r7" -eq "0" ]; then
     echo "round-trip ${name}.svg: PASS"
   else
     echo "round-trip ${name}.svg: FAIL"
   fi
 done
+
+# parallel parse of a document large enough to be split into chunks
+name=tiger-32x
+{
+  sed -n '1,6p' ${in}/tiger.svg
+  for i in $(seq 32); do sed '1,6d;/<\/svg>/d' ${in}/tiger.svg; done
+  echo '</svg>'
+} > ${out}/${name}.svg
+
+${musvgtool} -j 1 -i xml -o text -if ${out}/${name}.svg -of ${out}/${name}.1.text
+${musvgtool} -j 4 -i xml -o text -if ${out}/${name}.svg -of ${out}/${name}.4.text
+
+if diff ${out}/${name}.1.text ${out}/${name}.4.text > /dev/null; then
+  echo "parallel ${name}.svg: PASS"
+else
+  echo "parallel ${name}.svg: FAIL"
+fi
+
+# parallel decode of binary files with a subtree index
+for fmt in svgv svgb svgd;
+do
+  ${musvgtool} -n -i xml -o ${fmt} -if ${out}/${name}.svg -of ${out}/${name}.${fmt}
+  ${musvgtool} -j 4 -i ${fmt} -o text -if ${out}/${name}.${fmt} -of ${out}/${name}.${fmt}.4.text
+
+  if diff ${out}/${name}.1.text ${out}/${name}.${fmt}.4.text > /dev/null; then
+    echo "parallel ${name}.${fmt}: PASS"
+  else
+    echo "parallel ${name}.${fmt}: FAIL"
+  fi
+done
+
+# style class tables, decoded serially and in parallel
+for fmt in svgv svgb svgd;
+do
+  ${musvgtool} -c -i xml -o ${fmt} -if ${in}/tiger.svg -of ${out}/tiger.classes.${fmt}
+  ${musvgtool} -i ${fmt} -o xml -if ${out}/tiger.classes.${fmt} -of ${out}/tiger.classes.${fmt}.svg
+  ${musvgtool} -c -n -i xml -o ${fmt} -if ${out}/${name}.svg -of ${out}/${name}.classes.${fmt}
+  ${musvgtool} -j 4 -i ${fmt} -o text -if ${out}/${name}.classes.${fmt} -of ${out}/${name}.classes.${fmt}.4.text
+
+  if diff ${out}/tiger.svg ${out}/tiger.classes.${fmt}.svg > /dev/null &&
+     diff ${out}/${name}.1.text ${out}/${name}.classes.${fmt}.4.text > /dev/null; then
+    echo "classes tiger.${fmt}: PASS"
+  else
+    echo "classes tiger.${fmt}: FAIL"
+  fi
+done
+
+# XML streamed from a pipe in small writes, with a tag larger than the
+# read buffer, matches XML parsed from memory
+name=long-path
+{
+  echo '<svg width="100" height="100">'
+  printf '<path d="M0,0'
+  seq 1 30000 | awk '{ printf " L%d,%d", $1, $1 % 97 }'
+  echo '"/>'
+  echo '</svg>'
+} > ${out}/${name}.svg
+
+for src in ${in}/tiger.svg ${out}/${name}.svg;
+do
+  base=$(basename ${src} .svg)
+  ${musvgtool} -j 2 -i xml -o text -if ${src} -of ${out}/${base}.memory.text
+  dd if=${src} bs=7 2> /dev/null | \
+    ${musvgtool} -i xml -o text -if - -of ${out}/${base}.stream.text
+
+  if diff ${out}/${base}.memory.text ${out}/${base}.stream.text > /dev/null; then
+    echo "stream ${base}.svg: PASS"
+  else
+    echo "stream ${base}.svg: FAIL"
+  fi
+done
+
+# binary files read from a pipe match those read from a mapping
+for fmt in svgv svgb svgd;
+do
+  cat ${out}/tiger.${fmt} | ${musvgtool} -i ${fmt} -o text -if - \
+                                         -of ${out}/tiger.${fmt}.pipe.text
+
+  if diff ${out}/tiger.${fmt}.text ${out}/tiger.${fmt}.pipe.text > /dev/null; then
+    echo "pipe tiger.${fmt}: PASS"
+  else
+    echo "pipe tiger.${fmt}: FAIL"
+  fi
+done
+
+# binary files streamed from a pipe in small writes match those read
+# from a mapping, and the input side of a pipe parse stays bounded, so
+# its peak RSS is below that of a parse that maps the whole file
+name=many-paths
+{
+  echo '<svg width="100" height="100">'
+  seq 1 20000 | awk '{ printf "<path d=\"M%d,0", $1;
+                       for (i = 1; i <= 20; i++) printf " L%d.%d,%d", $1 + i, i, i * 7 % 97;
+                       printf "\"/>\n" }'
+  echo '</svg>'
+} > ${out}/${name}.svg
+
+for fmt in svgv svgb svgd;
+do
+  ${musvgtool} -n -i xml -o ${fmt} -if ${out}/${name}.svg -of ${out}/${name}.${fmt}
+  file_rss=$(${musvgtool} -s -i ${fmt} -o text -if ${out}/${name}.${fmt} \
+             -of ${out}/${name}.${fmt}.file.text | awk '/^peak_rss/ { print $2 }')
+  dd if=${out}/tiger.${fmt} bs=7 2> /dev/null | \
+    ${musvgtool} -i ${fmt} -o text -if - -of ${out}/tiger.${fmt}.stream.text
+  pipe_rss=$(cat ${out}/${name}.${fmt} | \
+             ${musvgtool} -s -i ${fmt} -o text -if - -of ${out}/${name}.${fmt}.pipe.text | \
+             awk '/^peak_rss/ { print $2 }')
+
+  if diff ${out}/tiger.${fmt}.text ${out}/tiger.${fmt}.stream.text > /dev/null &&
+     diff ${out}/${name}.${fmt}.file.text ${out}/${name}.${fmt}.pipe.text > /dev/null &&
+     [ -n "${pipe_rss}" ] && [ "${pipe_rss}" -lt "${file_rss}" ]; then
+    echo "stream ${name}.${fmt}: PASS"
+  else
+    echo "stream ${name}.${fmt}: FAIL"
+  fi
+done
+
+# transcoding without a document graph writes the same bytes as the
+# graph path, from files and from pipes, and its peak RSS is lower
+for fmt in svgv svgb svgd;
+do
+  ${musvgtool} -S -i xml -o ${fmt} -if ${in}/tiger.svg -of ${out}/tiger.transcode.${fmt}
+  cat ${out}/tiger.${fmt} | ${musvgtool} -S -i ${fmt} -o xml -if - \
+                                         -of ${out}/tiger.${fmt}.transcode.svg
+  graph_rss=$(${musvgtool} -s -i xml -o ${fmt} -if ${out}/${name}.svg \
+              -of ${out}/${name}.graph.${fmt} | awk '/^peak_rss/ { print $2 }')
+  stream_rss=$(${musvgtool} -S -s -i xml -o ${fmt} -if ${out}/${name}.svg \
+               -of ${out}/${name}.transcode.${fmt} | awk '/^peak_rss/ { print $2 }')
+
+  if cmp -s ${out}/tiger.${fmt} ${out}/tiger.transcode.${fmt} &&
+     cmp -s ${out}/tiger.${fmt}.svg ${out}/tiger.${fmt}.transcode.svg &&
+     cmp -s ${out}/${name}.graph.${fmt} ${out}/${name}.transcode.${fmt} &&
+     [ -n "${stream_rss}" ] && [ "${stream_rss}" -lt "${graph_rss}" ]; then
+    echo "transcode tiger.${fmt}: PASS"
+  else
+    echo "transcode tiger.${fmt}: FAIL"
+  fi
+done
+
+# truncated binary files are rejected with an error rather than an abort
+for fmt in svgv svgb svgd;
+do
+  head -c 3000 ${out}/tiger.${fmt} > ${out}/tiger.truncated.${fmt}
+
+  ${musvgtool} -i ${fmt} -o text -if ${out}/tiger.truncated.${fmt} \
+              -of ${out}/tiger.truncated.${fmt}.text 2> /dev/null
+
+  if [ $? -eq 1 ]; then
+    echo "truncated tiger.${fmt}: PASS"
+  else
+    echo "truncated tiger.${fmt}: FAIL"
+  fi
+done
+
+# files without the header, or written for another format, are rejected
+for fmt in svgv svgb svgd;
+do
+  tail -c +9 ${out}/tiger.${fmt} > ${out}/tiger.headless.${fmt}
+  ${musvgtool} -i ${fmt} -o text -if ${out}/tiger.headless.${fmt} \
+              -of ${out}/tiger.headless.${fmt}.text 2> /dev/null
+  r1=$?
+  other=$([ ${fmt} = svgb ] && echo svgv || echo svgb)
+  ${musvgtool} -S -i ${other} -o text -if ${out}/tiger.${fmt} \
+              -of ${out}/tiger.headless.${fmt}.text 2> /dev/null
+  r2=$?
+
+  if [ $r1 -eq 1 -a $r2 -eq 1 ]; then
+    echo "headerless tiger.${fmt}: PASS"
+  else
+    echo "headerless tiger.${fmt}: FAIL"
+  fi
+done
+
+# an attribute code with no binary form is rejected before it is emitted
+for fmt in xml text;
+do
+  cp ${out}/tiger.svgb ${out}/tiger.corrupt.svgb
+  printf '\017' | dd of=${out}/tiger.corrupt.svgb bs=1 seek=11076 conv=notrunc 2> /dev/null
+  ${musvgtool} -i svgb -o ${fmt} -if ${out}/tiger.corrupt.svgb \
+              -of ${out}/tiger.corrupt.${fmt} 2> /dev/null
+  r1=$?
+  ${musvgtool} -S -i svgb -o ${fmt} -if ${out}/tiger.corrupt.svgb \
+              -of ${out}/tiger.corrupt.${fmt} 2> /dev/null
+  r2=$?
+
+  if [ $r1 -eq 1 -a $r2 -eq 1 ]; then
+    echo "corrupt tiger.svgb to ${fmt}: PASS"
+  else
+    echo "corrupt tiger.svgb to ${fmt}: FAIL"
+  fi
+done
+
+# numbers in a dash array are not truncated at a fixed token length
+zeros=$(printf '%070d' 0)
+printf '<svg width="10" height="10"><path d="M0,0 L1,1" stroke-dasharray="%s12 2"/></svg>\n' \
+  ${zeros} > ${out}/long-dash.svg
+${musvgtool} -i xml -o xml -if ${out}/long-dash.svg -of ${out}/long-dash.svg.svg
+
+if grep -q 'stroke-dasharray="12,2"' ${out}/long-dash.svg.svg; then
+  echo "long-dash.svg: PASS"
+else
+  echo "long-dash.svg: FAIL"
+fi
+
+# svgc sections are validated: an element code out of range after the
+# seven section lengths is rejected with an error rather than an abort
+hdr=$(od -An -tu1 -v -N 64 ${out}/tiger.svgc | tr -s ' ' '\n' | \
+      awk 'NF { n++; if ($1 < 128 && ++k == 7) { print n; exit } }')
+cp ${out}/tiger.svgc ${out}/tiger.corrupt.svgc
+printf '\377' | dd of=${out}/tiger.corrupt.svgc bs=1 seek=${hdr} conv=notrunc 2> /dev/null
+${musvgtool} -i svgc -o text -if ${out}/tiger.corrupt.svgc \
+            -of ${out}/tiger.corrupt.svgc.text 2> /dev/null
+
+if [ $? -eq 1 ]; then
+  echo "corrupt tiger.svgc: PASS"
+else
+  echo "corrupt tiger.svgc: FAIL"
+fi
+
+# images are checked before they are served: a root node with a sibling
+# link is rejected whether the image is mapped or read from a pipe
+nodes=$(od -An -tu8 -j24 -N8 ${out}/tiger.svgi | tr -d ' ')
+cp ${out}/tiger.svgi ${out}/tiger.corrupt.svgi
+printf '\001' | dd of=${out}/tiger.corrupt.svgi bs=1 seek=$((nodes + 4)) conv=notrunc 2> /dev/null
+${musvgtool} -i svgi -o text -if ${out}/tiger.corrupt.svgi \
+            -of ${out}/tiger.corrupt.svgi.text 2> /dev/null
+r1=$?
+cat ${out}/tiger.corrupt.svgi | ${musvgtool} -i svgi -o text -if - \
+            -of ${out}/tiger.corrupt.svgi.text 2> /dev/null
+r2=$?
+
+if [ $r1 -eq 1 -a $r2 -eq 1 ]; then
+  echo "corrupt tiger.svgi: PASS"
+else
+  echo "corrupt tiger.svgi: FAIL"
+fi
+
+# an svgr section length larger than its coded length can hold is
+# rejected before the section is allocated
+n=$(od -An -tu1 -v -N 16 ${out}/tiger.svgr | tr -s ' ' '\n' | \
+    awk 'NF { n++; if ($1 < 128) { print n; exit } }')
+{ printf '\377\377\377\377\377\377\377\177'; tail -c +$((n + 1)) ${out}/tiger.svgr; } \
+  > ${out}/tiger.corrupt.svgr
+${musvgtool} -i svgr -o text -if ${out}/tiger.corrupt.svgr \
+            -of ${out}/tiger.corrupt.svgr.text 2> /dev/null
+
+if [ $? -eq 1 ]; then
+  echo "corrupt tiger.svgr: PASS"
+else
+  echo "corrupt tiger.svgr: FAIL"
+fi
+
+# relative coordinates rounded to a precision do not drift along a path
+{
+  printf '<svg width="10" height="10"><path d="M0,0'
+  seq 1 1000 | awk '{ printf " l0.0004,0" }'
+  echo '"/></svg>'
+} > ${out}/drift.svg
+${musvgtool} -p 3 -i xml -o svgd -if ${out}/drift.svg -of ${out}/drift.svgd
+${musvgtool} -i svgd -o xml -if ${out}/drift.svgd -of ${out}/drift.svgd.svg
+end=$(sed -n 's/.*d="M0,0l\([^"]*\)".*/\1/p' ${out}/drift.svgd.svg | \
+      tr ' ' '\n' | awk -F, '{ x += $1 } END { printf "%.4f", x }')
+
+if [ "${end}" = "0.4000" ]; then
+  echo "drift.svgd: PASS"
+else
+  echo "drift.svgd: FAIL"
+fi
+
+# output that cannot be written is an error, with and without a writer thread
+if [ -w /dev/full ]; then
+  for w in 0 4;
+  do
+    ${musvgtool} -w ${w} -i xml -o svgb -if ${in}/tiger.svg -of /dev/full 2> /dev/null
+    r1=$?
+    ${musvgtool} -S -w ${w} -i xml -o svgb -if ${in}/tiger.svg -of /dev/full 2> /dev/null
+    r2=$?
+
+    if [ $r1 -eq 1 -a $r2 -eq 1 ]; then
+      echo "write /dev/full -w ${w}: PASS"
+    else
+      echo "write /dev/full -w ${w}: FAIL"
+    fi
+  done
+fi
+
+# point runs larger than the write buffers are written in pieces
+{
+  printf '<svg width="10" height="10"><polygon points="'
+  seq 1 100000 | awk '{ printf "%d,%d ", $1 % 997, $1 % 991 }'
+  echo '"/></svg>'
+} > ${out}/big-polygon.svg
+for w in 0 4;
+do
+  ${musvgtool} -w ${w} -i xml -o svgb -if ${out}/big-polygon.svg -of ${out}/big-polygon.svgb
+  r1=$?
+  ${musvgtool} -S -w ${w} -i xml -o svgb -if ${out}/big-polygon.svg -of ${out}/big-polygon.S.svgb
+  r2=$?
+  ${musvgtool} -i svgb -o xml -if ${out}/big-polygon.S.svgb -of ${out}/big-polygon.svgb.svg
+  r3=$?
+
+  if [ $r1 -eq 0 -a $r2 -eq 0 -a $r3 -eq 0 ] && \
+     cmp -s ${out}/big-polygon.svgb ${out}/big-polygon.S.svgb; then
+    echo "big-polygon.svgb -w ${w}: PASS"
+  else
+    echo "big-polygon.svgb -w ${w}: FAIL"
+  fi
+done
+
+# relative moves that take the pen off the grid are written as floats
+printf '<svg width="10" height="10"><path d="M0,0 l5e15,0 l5e15,0"/></svg>\n' \
+  > ${out}/far-pen.svg
+${musvgtool} -p 0 -i xml -o svgd -if ${out}/far-pen.svg -of ${out}/far-pen.svgd 2> /dev/null
+r1=$?
+${musvgtool} -S -p 0 -i xml -o svgd -if ${out}/far-pen.svg -of ${out}/far-pen.S.svgd 2> /dev/null
+r2=$?
+${musvgtool} -i svgd -o xml -if ${out}/far-pen.svgd -of ${out}/far-pen.svgd.svg
+
+if [ $r1 -eq 0 -a $r2 -eq 0 ] && grep -q 'd="M0,0l5e15,0 5e15,0"' ${out}/far-pen.svgd.svg; then
+  echo "far-pen.svgd: PASS"
+else
+  echo "far-pen.svgd: FAIL"
+fi
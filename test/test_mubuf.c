@@ -82,6 +82,336 @@ void t4()
     mu_buf_destroy(rbuf);
 }
 
+static uint32_t t5_bits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+void t5()
+{
+    enum { count = 4099 };
+    static float v[count], r1[count], r2[count];
+    float f;
+    mu_buf *sbuf, *vbuf, *rbuf, *wbuf;
+    uint32_t x = 0x9e3779b9;
+
+    const float special[] = {
+        0.0f, -0.0f, 0.5f, 1.0f, 1.5f, -2.0f, 3.75f, 0.0625f, 0.25f,
+        0.1f, -0.3f, 100.0f, 1024.0f, 1e-40f, -1e-45f, 1e30f,
+        _f32_inf(), -_f32_inf(), _f32_nan()
+    };
+    for (size_t i = 0; i < count; i++) {
+        x = x * 1664525u + 1013904223u;
+        switch (i % 4) {
+        case 0: v[i] = special[(x >> 8) % (sizeof(special) / sizeof(special[0]))]; break;
+        case 1: v[i] = (float)(x >> 12) / 16.0f - 32768.0f; break;
+        case 2: v[i] = (float)(int)(x >> 20) * 0.5f; break;
+        case 3: memcpy(v + i, &x, sizeof(x)); if (v[i] != v[i]) v[i] = 0.0f; break;
+        }
+    }
+
+    /* batch encoding is byte-identical to the scalar encoding */
+    sbuf = mu_resizable_buf_new();
+    vbuf = mu_resizable_buf_new();
+    for (size_t i = 0; i < count; i++) {
+        assert(mu_vf128_f32_write(sbuf, v + i) == 0);
+    }
+    assert(mu_vf128_f32_write_vec(vbuf, v, 5) == 0);
+    assert(mu_vf128_f32_write_vec(vbuf, v + 5, count - 5) == 0);
+    assert(sbuf->write_marker == vbuf->write_marker);
+    assert(memcmp(sbuf->data, vbuf->data, sbuf->write_marker) == 0);
+
+    /* batch decoding matches the scalar decoding bit for bit */
+    rbuf = mu_buf_memory_new(sbuf->data, sbuf->write_marker);
+    for (size_t i = 0; i < count; i++) {
+        assert(mu_vf128_f32_read(rbuf, r1 + i) == 0);
+    }
+    mu_buf_destroy(rbuf);
+    rbuf = mu_buf_memory_new(vbuf->data, vbuf->write_marker);
+    assert(mu_vf128_f32_read_vec(rbuf, r2, count - 7) == 0);
+    assert(mu_vf128_f32_read_vec(rbuf, r2 + count - 7, 7) == 0);
+    assert(mu_vf128_f32_read_vec(rbuf, &f, 1) < 0);
+    mu_buf_destroy(rbuf);
+    for (size_t i = 0; i < count; i++) {
+        assert(t5_bits(r1[i]) == t5_bits(r2[i]));
+    }
+
+    /* and through buffered file readers and writers */
+    wbuf = mu_buffered_writer_new("test/output/t5.dat");
+    assert(mu_vf128_f32_write_vec(wbuf, v, count) == 0);
+    mu_buf_destroy(wbuf);
+    rbuf = mu_buffered_reader_new("test/output/t5.dat");
+    assert(mu_vf128_f32_read_vec(rbuf, r2, count) == 0);
+    mu_buf_destroy(rbuf);
+    for (size_t i = 0; i < count; i++) {
+        assert(t5_bits(r1[i]) == t5_bits(r2[i]));
+    }
+
+    /* the checker accepts every encoding and rejects truncated ones */
+    {
+        const char *p = sbuf->data, *end = p + sbuf->write_marker;
+        size_t n;
+        for (size_t i = 0; i < count; i++) {
+            assert((n = mu_vf128_f32_check(p, end - p)) > 0);
+            assert(n == 1 || mu_vf128_f32_check(p, n - 1) == 0);
+            p += n;
+        }
+        assert(p == end);
+    }
+
+    /* mantissas that are zero or wider than needed are not accepted */
+    {
+        static const char zero[] = { (char)0x91, 0x05, 0x00 };
+        static const char bare[] = { (char)0x81, 0x00 };
+        static const char wide[] = { (char)0x92, 0x05, 0x01, 0x00 };
+        assert(mu_vf128_f32_check(zero, sizeof(zero)) == 0);
+        assert(mu_vf128_f32_check(bare, sizeof(bare)) == 0);
+        assert(mu_vf128_f32_check(wide, sizeof(wide)) == 0);
+        assert(mu_vf128_f32_check_vec(zero, sizeof(zero), 1) == 0);
+        assert(mu_vf128_f32_check_vec(bare, sizeof(bare), 1) == 0);
+        assert(mu_vf128_f32_check_vec(wide, sizeof(wide), 1) == 0);
+    }
+
+    /* a zero exponent byte with no mantissa is still a valid float */
+    {
+        static const char one[] = { (char)0x90, 0x00 };
+        assert(mu_vf128_f32_check(one, sizeof(one)) == sizeof(one));
+        assert(mu_vf128_f32_check_vec(one, sizeof(one), 1) == sizeof(one));
+    }
+
+    mu_buf_destroy(sbuf);
+    mu_buf_destroy(vbuf);
+}
+
+void t6()
+{
+    enum { count = 100003 };
+    static char v[count], r[count];
+    mu_buf *wbuf, *rbuf;
+    uint32_t x = 0x9e3779b9;
+
+    /* skewed bytes, four byte records and uniform noise */
+    for (size_t i = 0; i < count; i++) {
+        x = x * 1664525u + 1013904223u;
+        if (i < count / 3) v[i] = (x >> 28) < 12 ? 'a' : (char)(x >> 24);
+        else if (i < 2 * count / 3) v[i] = (i & 3) == 3 ? 0x42 : (char)(x >> 24);
+        else v[i] = (char)(x >> 24);
+    }
+
+    for (size_t lanes = 1; lanes <= 4; lanes *= 4) {
+        for (size_t len = 0; len < count; len = len * 3 + 1) {
+            wbuf = mu_resizable_buf_new();
+            assert(mu_rc_encode_bytes(wbuf, v, len, lanes) == 0);
+            rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker);
+            assert(mu_rc_decode_bytes(rbuf, r, len, lanes) == 0);
+            assert(rbuf->read_marker == rbuf->write_marker);
+            assert(memcmp(v, r, len) == 0);
+            mu_buf_destroy(rbuf);
+
+            /* truncated input is an error */
+            if (len > 0) {
+                rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker - 1);
+                assert(mu_rc_decode_bytes(rbuf, r, len, lanes) < 0);
+                mu_buf_destroy(rbuf);
+            }
+            mu_buf_destroy(wbuf);
+        }
+    }
+
+    /* constant input has the highest expansion that decoders must allow */
+    memset(v, 0, count);
+    wbuf = mu_resizable_buf_new();
+    assert(mu_rc_encode_bytes(wbuf, v, count, 1) == 0);
+    assert(wbuf->write_marker * mu_rc_max_expansion >= count);
+    mu_buf_destroy(wbuf);
+}
+
+void t7()
+{
+    enum { count = 4099 };
+    static u64 v[count], r[count];
+    mu_buf *wbuf, *rbuf;
+    u64 x = 0x9e3779b97f4a7c15ull;
+
+    /* every length, so the word decoders see each terminator position */
+    for (size_t i = 0; i < count; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        v[i] = (x >> 8) >> (x % 56);
+    }
+    v[0] = 0;
+    v[1] = (1ull << 56) - 1;
+
+    for (int vlu = 0; vlu < 2; vlu++) {
+        wbuf = mu_resizable_buf_new();
+        for (size_t i = 0; i < count; i++) {
+            assert((vlu ? mu_vlu_u64_write : mu_leb_u64_write)(wbuf, v + i) == 0);
+        }
+
+        /* single values, then batches, ending in the bytewise tail */
+        rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker);
+        for (size_t i = 0; i < count; i++) {
+            assert((vlu ? mu_vlu_u64_read : mu_leb_u64_read)(rbuf, r + i) == 0);
+            assert(r[i] == v[i]);
+        }
+        assert((vlu ? mu_vlu_u64_read : mu_leb_u64_read)(rbuf, r) < 0);
+        mu_buf_destroy(rbuf);
+
+        memset(r, 0, sizeof(r));
+        rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker);
+        for (size_t i = 0; i < count; i += 1000) {
+            size_t n = count - i < 1000 ? count - i : 1000;
+            assert((vlu ? mu_vlu_u64_read_vec : mu_leb_u64_read_vec)(rbuf, r + i, n) == 0);
+        }
+        assert(rbuf->read_marker == rbuf->write_marker);
+        assert(memcmp(v, r, sizeof(v)) == 0);
+        mu_buf_destroy(rbuf);
+
+        /* truncated input is an error */
+        rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker - 1);
+        assert((vlu ? mu_vlu_u64_read_vec : mu_leb_u64_read_vec)(rbuf, r, count) < 0);
+        mu_buf_destroy(rbuf);
+        mu_buf_destroy(wbuf);
+    }
+}
+
+void t8()
+{
+    enum { count = 4099 };
+    static u64 v[count];
+    mu_buf *wbuf, *rbuf, *fbuf;
+    u64 x = 0x9e3779b97f4a7c15ull;
+    char *c;
+    const char *r;
+
+    for (size_t i = 0; i < count; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        v[i] = (x >> 8) >> (x % 56);
+    }
+
+    /* cursor writes match the checked writers byte for byte */
+    wbuf = mu_resizable_buf_new();
+    fbuf = mu_resizable_buf_new();
+    for (size_t i = 0; i < count; i++) {
+        assert((c = mu_buf_write_reserve(wbuf, 1 + 4 + 4 + mu_leb_max_length)));
+        c = mu_cur_put_i8(c, (int8_t)i);
+        c = mu_cur_put_i32(c, (int32_t)v[i]);
+        c = mu_cur_put_f32(c, (float)i / 3.0f);
+        mu_buf_write_commit(wbuf, mu_cur_put_leb(c, v[i]));
+        assert(mu_buf_write_i8(fbuf, (int8_t)i) == 1);
+        assert(mu_buf_write_i32(fbuf, (int32_t)v[i]) == 4);
+        assert(mu_ieee754_f32_write_byval(fbuf, (float)i / 3.0f) == 0);
+        assert(mu_leb_u64_write(fbuf, v + i) == 0);
+    }
+    assert(wbuf->write_marker == fbuf->write_marker);
+    assert(memcmp(wbuf->data, fbuf->data, wbuf->write_marker) == 0);
+
+    rbuf = mu_buf_memory_new(wbuf->data, wbuf->write_marker);
+    for (size_t i = 0; i < count; i++) {
+        int8_t b; int32_t w; float f; u64 u;
+        assert((r = mu_buf_read_reserve(rbuf, 1 + 4 + 4)));
+        r = mu_cur_get_i8(r, &b);
+        r = mu_cur_get_i32(r, &w);
+        r = mu_cur_get_f32(r, &f);
+        assert((r = mu_cur_get_leb(r, mu_buf_read_end(rbuf), &u)));
+        mu_buf_read_commit(rbuf, r);
+        assert(b == (int8_t)i && w == (int32_t)v[i]);
+        assert(f == (float)i / 3.0f && u == v[i]);
+    }
+    assert(mu_buf_read_reserve(rbuf, 1) == NULL);
+    mu_buf_destroy(rbuf);
+
+    /* truncated and overlong varints are errors, fixed buffers do not grow */
+    {
+        static const char leb[9] = { -1, -1, -1, -1, -1, -1, -1, -1, 1 };
+        u64 u;
+        assert(mu_cur_get_leb(leb, leb + 2, &u) == NULL);
+        assert(mu_cur_get_leb(leb, leb + 9, &u) == NULL);
+        assert(mu_cur_get_leb(leb + 7, leb + 9, &u) == leb + 9 && u == 255);
+    }
+    mu_buf_destroy(fbuf);
+    fbuf = mu_buf_new(4);
+    assert(mu_buf_write_reserve(fbuf, 4) != NULL);
+    assert(mu_buf_write_reserve(fbuf, 5) == NULL);
+    mu_buf_destroy(fbuf);
+    mu_buf_destroy(wbuf);
+}
+
+void t9()
+{
+    enum { count = 100003 };
+    static u64 v[count], r[count];
+    mu_buf *wbuf, *rbuf;
+    u64 x = 0x9e3779b97f4a7c15ull;
+
+    for (size_t i = 0; i < count; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        v[i] = (x >> 8) >> (x % 56);
+    }
+
+    /* small buffers so the writer thread falls behind and batches */
+    for (size_t buffers = 2; buffers <= 8; buffers *= 2) {
+        wbuf = mu_async_writer_new("test/output/t9.dat", 4096, buffers);
+        for (size_t i = 0; i < count; i++) {
+            assert(mu_leb_u64_write(wbuf, v + i) == 0);
+        }
+        assert(mu_buf_destroy(wbuf) == 0);
+
+        rbuf = mu_buffered_reader_new("test/output/t9.dat");
+        assert(mu_leb_u64_read_vec(rbuf, r, count) == 0);
+        assert(mu_buf_read_reserve(rbuf, 1) == NULL);
+        mu_buf_destroy(rbuf);
+        assert(memcmp(v, r, sizeof(v)) == 0);
+    }
+
+    /* an empty file is closed without writing */
+    wbuf = mu_async_writer_new("test/output/t9.dat", 0, 0);
+    assert(mu_buf_destroy(wbuf) == 0);
+    rbuf = mu_buffered_reader_new("test/output/t9.dat");
+    assert(mu_buf_read_reserve(rbuf, 1) == NULL);
+    mu_buf_destroy(rbuf);
+
+    /* failed writes are reported when the writer is closed */
+    wbuf = mu_async_writer_fd(open("test/output/t9.dat", O_RDONLY), 4096, 2);
+    for (size_t i = 0; i < count; i++) {
+        assert(mu_leb_u64_write(wbuf, v + i) == 0);
+    }
+    assert(mu_buf_destroy(wbuf) == -1);
+}
+
+void t10()
+{
+    mu_buf *wbuf, *rbuf;
+    static char v[20000], r[20000];
+
+    for (size_t i = 0; i < sizeof(v); i++) {
+        v[i] = (char)(i * 31 + (i >> 8));
+    }
+    wbuf = mu_buffered_writer_new("test/output/t10.dat");
+    for (size_t i = 0; i < sizeof(v); i += 1000) {
+        assert(mu_buf_write_bytes(wbuf, v + i, 1000) == 1000);
+    }
+    assert(mu_buf_destroy(wbuf) == 0);
+
+    /* reads larger than the reader buffer grow it up to the input */
+    rbuf = mu_buffered_reader_new("test/output/t10.dat");
+    assert(mu_buf_read_bytes(rbuf, r, 10) == 10);
+    assert(mu_buf_read_bytes(rbuf, r + 10, 12000) == 12000);
+    assert(mu_buf_read_reserve(rbuf, sizeof(r)) == NULL);
+    assert(mu_buf_read_bytes(rbuf, r + 12010, 7990) == 7990);
+    assert(mu_buf_read_reserve(rbuf, 1) == NULL);
+    mu_buf_destroy(rbuf);
+    assert(memcmp(v, r, sizeof(v)) == 0);
+
+    /* failed writes discard the output and are reported on close */
+    wbuf = mu_buffered_writer_fd(open("test/output/t10.dat", O_RDONLY));
+    for (size_t i = 0; i < sizeof(v); i += 1000) {
+        assert(mu_buf_write_bytes(wbuf, v + i, 1000) == 1000);
+    }
+    assert(mu_buf_destroy(wbuf) == -1);
+}
+
 int main(int argc, char **argv)
 {
     if (argc == 2 && strcmp(argv[1], "-v") == 0) {
@@ -92,4 +422,10 @@ int main(int argc, char **argv)
     t2();
     t3();
     t4();
+    t5();
+    t6();
+    t7();
+    t8();
+    t9();
+    t10();
 }
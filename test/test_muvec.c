@@ -10,7 +10,11 @@ typedef signed long long llong;
 #define t1_capacity(mv) mu_vec_capacity(&mv,sizeof(llong))
 #define t1_get(mv,idx) ((llong*)mu_vec_get(&mv,sizeof(llong),idx))
 #define t1_alloc(mv,count) mu_vec_alloc_relaxed(&mv,sizeof(llong),count)
+#define t1_span(mv,idx,count) ((llong*)mu_vec_span(&mv,sizeof(llong),idx,count))
 #define t1_destroy(mv) mu_vec_destroy(&mv)
+#define t1_map(mv,data,count) mu_vec_map(&mv,sizeof(llong),data,count)
+#define t1_unmap(mv) mu_vec_unmap(&mv)
+#define t1_truncate(mv,count) mu_vec_truncate(&mv,count)
 
 
 void t1(size_t count)
@@ -30,7 +34,75 @@ void t1(size_t count)
     t1_destroy(mv);
 }
 
+void t2(size_t count)
+{
+    mu_vec mv;
+    size_t run = 0;
+    llong *p = NULL;
+
+    t1_init(mv);
+    for (size_t i = 0; i < count; i++) {
+        if (run == 0) {
+            p = t1_span(mv, i, &run);
+            assert(run > 0 && mu_vec_linear(&mv, i, run));
+        }
+        *p++ = i;
+        run--;
+    }
+    assert(t1_count(mv) == 0);
+    assert(t1_alloc(mv, count) == 0);
+    for (size_t i = 0; i < count; i++) {
+        llong *p = t1_get(mv, i);
+        assert(*p == i);
+    }
+    t1_destroy(mv);
+}
+
+void t3(size_t count)
+{
+    mu_vec mv;
+    llong *data = malloc(count * sizeof(llong));
+
+    for (size_t i = 0; i < count; i++) {
+        data[i] = i;
+    }
+    t1_map(mv, data, count);
+    assert(t1_count(mv) == count);
+    for (size_t i = 0; i < count; i++) {
+        llong *p = t1_get(mv, i);
+        assert(p == data + i && *p == i);
+    }
+    t1_unmap(mv);
+    free(data);
+}
+
+void t4(size_t count)
+{
+    mu_vec mv;
+
+    t1_init(mv);
+    assert(t1_alloc(mv, count) == 0);
+    llong *half = t1_get(mv, count / 2);
+    for (size_t i = 0; i < count; i++) {
+        *t1_get(mv, i) = i;
+    }
+    t1_truncate(mv, count / 2);
+    assert(t1_count(mv) == count / 2);
+    t1_truncate(mv, count);
+    assert(t1_count(mv) == count / 2);
+    assert(t1_alloc(mv, count - count / 2) == count / 2);
+    assert(t1_get(mv, count / 2) == half);
+    for (size_t i = 0; i < count; i++) {
+        assert(*t1_get(mv, i) == i);
+    }
+    t1_destroy(mv);
+}
+
 int main(int argc, char **argv)
 {
     t1(1024*1024);
+    t2(1024*1024);
+    t3(1000*1000);
+    t3(1);
+    t4(1000);
 }